@@ -0,0 +1,151 @@
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include "tpm_async.hpp"
+
+/*
+ * 비동기 클라이언트 API (aclient.c, tpm_async.hpp) 로 한 스레드에서 키 교환 C 개를 동시에 돌린다.
+ * 서버는 fork 한 자식 프로세스의 evserver. 콜백 API 와 코루틴 API 를 각각 잰다.
+ *   ./build/bench/bench_aclient [total] [C]
+ */
+
+#define MAX_ROUNDS 20000
+
+struct load {
+    tpm_aclient *ac;
+    sockaddr_in peer;
+    tpm_sync_opts opts;
+    unsigned long total, started, done, failed;
+    tpm_lat lat;
+};
+
+/* ---- 콜백 ---- */
+
+static void start_next(load *ld);
+
+static void on_key(void *arg, int err, const uint8_t *key, const tpm_sync_result *res) {
+    load *ld = static_cast<load *>(arg);
+    (void)key;
+    if (err == 0) {
+        ld->done++;
+        tpm_lat_add(&ld->lat, res->elapsed_ns);
+    } else {
+        ld->failed++;
+    }
+    start_next(ld);
+}
+
+static void start_next(load *ld) {
+    while (ld->started < ld->total) {
+        ld->started++;
+        if (tpm_aclient_start(ld->ac, &ld->peer, &ld->opts, on_key, ld) == 0) return;
+        ld->failed++;
+    }
+}
+
+static void run_callbacks(load *ld, int conc) {
+    for (int i = 0; i < conc; i++) start_next(ld);
+    while (tpm_aclient_pending(ld->ac) > 0)
+        if (tpm_aclient_poll(ld->ac, -1) < 0) ErrorHandling("tpm_aclient_poll");
+}
+
+/* ---- 코루틴 ---- */
+
+// 결과를 기다리는 쪽이 없는 최소 task: 만들자마자 돌고, 끝나면 스스로 사라진다
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static detached worker(load *ld) {
+    while (ld->started < ld->total) {
+        ld->started++;
+        tpm::key_result r = co_await tpm::exchange(ld->ac, ld->peer, ld->opts);
+        if (r.ok()) {
+            ld->done++;
+            tpm_lat_add(&ld->lat, r.sync.elapsed_ns);
+        } else {
+            ld->failed++;
+        }
+    }
+}
+
+static void run_coroutines(load *ld, int conc) {
+    for (int i = 0; i < conc; i++) worker(ld);
+    while (tpm_aclient_pending(ld->ac) > 0)
+        if (tpm_aclient_poll(ld->ac, -1) < 0) ErrorHandling("tpm_aclient_poll");
+}
+
+static void run_case(const tpm_hello_info *params, const char *api, int coro, unsigned long total, int conc) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t alen = sizeof(addr);
+    int lfd = tpm_listen_tcp(&addr, SOMAXCONN);
+    if (lfd < 0 || getsockname(lfd, (sockaddr *)&addr, &alen) < 0) ErrorHandling("listen");
+
+    tpm_evserver_cfg cfg = {};
+    cfg.params = *params;
+    cfg.opts = { 2, TPM_DEFAULT_WINDOW, 0, 0, MAX_ROUNDS, 0, { 0, 0, 0 } };
+    cfg.threads = 1;
+    cfg.max_sessions = total;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) ErrorHandling("fork");
+    if (pid == 0) {
+        tpm_evserver_stats st;
+        uint64_t seed;
+        if (tpm_random_bytes(&seed, sizeof(seed)) == 0) tpm_rand_seed(seed);
+        int r = tpm_evserver_run(lfd, &cfg, &st);
+        _exit(r < 0);
+    }
+    close(lfd);
+
+    load ld = {};
+    ld.ac = tpm_aclient_new();
+    if (ld.ac == nullptr) ErrorHandling("tpm_aclient_new");
+    ld.peer = addr;
+    ld.total = total;
+    uint64_t t0 = tpm_now_ns();
+    if (coro) run_coroutines(&ld, conc);
+    else run_callbacks(&ld, conc);
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+    tpm_aclient_free(ld.ac);
+    waitpid(pid, nullptr, 0);
+
+    printf("  %-10s %-14s C=%-5d %6lu keys  %6.2f s  %7.0f keys/s  p50 %8.2f ms  p99 %8.2f ms  (failed %lu)\n",
+           api, (params->flags & TPM_F_DUPLEX) ? "duplex+seeded" : "lockstep", conc, ld.done, sec, ld.done / sec,
+           tpm_lat_pct(&ld.lat, 0.50) * 1e-6, tpm_lat_pct(&ld.lat, 0.99) * 1e-6, ld.failed);
+    tpm_lat_free(&ld.lat);
+}
+
+int main(int argc, char **argv) {
+    unsigned long total = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    int conc = argc > 2 ? atoi(argv[2]) : 500;
+    rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    tpm_hello_info params = { RULE_RANDOM_WALK, { 3, 4, 3 }, 0, 0, 0, 0 };
+    printf("K=%d N=%d L=%d rule=%s, loopback, one client thread, server in a separate process\n",
+           params.shape.K, params.shape.N, params.shape.L, tpm_rule_get(params.rule)->name);
+    static const uint16_t flags[] = { 0, TPM_F_DUPLEX | TPM_F_SEEDED };
+    for (uint16_t f : flags) {
+        params.flags = f;
+        run_case(&params, "callback", 0, total, conc);
+        run_case(&params, "coroutine", 1, total, conc);
+    }
+    return 0;
+}
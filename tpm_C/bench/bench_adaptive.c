@@ -0,0 +1,57 @@
+#include <math.h>
+#include "tpm.h"
+
+/*
+ * query 규칙에서 고정 H 와 H 조절기 (qctl.c) 를 같은 seed 의 시행들로 비교한다.
+ * H 는 무작위 가중치의 국소장 표준편차 sigma (tpm_field_sd) 의 배수로 잡는다.
+ * 시행마다 A-B 동기화 라운드 (tpm_sim_run_stats) 와, 같은 시행에 기하 공격자 하나를 붙였을 때
+ * A-B 가 동기화되는 라운드에 공격자도 A 와 같았던 비율 (tpm_attack_run, chase 1) 을 낸다.
+ *   ./build/bench/bench_adaptive [trials]
+ */
+
+#define MAX_ROUNDS 20000
+
+static void row(const tpm_shape *sh, int H, int H_max, uint64_t trials) {
+    tpm_attack_cfg acfg = { { RULE_QUERY, *sh, H, MAX_ROUNDS, 0, H_max, { 0, 0, 0 } }, 1, 1, 0, 0, 0 };
+    tpm_sim_stats st = { 0 };
+    tpm_attack_stats at = { 0 };
+
+    if (tpm_sim_run_stats(&acfg.sim, 1, 0, trials, 0, &st) < 0) ErrorHandling("tpm_sim_run_stats");
+    if (tpm_attack_run(&acfg, 1, 0, trials, 0, &at) < 0) ErrorHandling("tpm_attack_run");
+
+    char label[32];
+    if (H_max > 0) {
+        tpm_qctl qc;
+        tpm_qctl_init(&qc, sh, H, H_max);
+        snprintf(label, sizeof(label), "adaptive %d..%d", qc.h_min, qc.h_max);
+    } else {
+        snprintf(label, sizeof(label), "fixed %d", H);
+    }
+    const tpm_stats *r = &st.rounds;
+    printf("  %-17s  mean %7.1f  p90 %6llu  p99 %6llu  failed %5llu | geometric broken %5.1f%%\n", label,
+           tpm_stats_mean(r), (unsigned long long)tpm_stats_quantile(r, 0.90),
+           (unsigned long long)tpm_stats_quantile(r, 0.99), (unsigned long long)(st.trials - st.synced),
+           at.synced ? 100.0 * at.broken / at.synced : 0.0);
+    tpm_sim_stats_free(&st);
+    tpm_attack_stats_free(&at);
+}
+
+int main(int argc, char **argv) {
+    const uint64_t trials = argc > 1 ? strtoull(argv[1], NULL, 10) : 2000;
+    static const tpm_shape shapes[] = { { 3, 16, 3 }, { 3, 16, 5 }, { 3, 100, 3 }, { 3, 100, 5 } };
+    static const double fixed[] = { 0.5, 1, 1.5, 2, 3 };
+    static const double caps[] = { 2, 3 };
+
+    printf("rule query, %llu trials per row (seed 1), max-rounds %d, all CPUs\n", (unsigned long long)trials,
+           MAX_ROUNDS);
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        const tpm_shape *sh = &shapes[i];
+        const double sigma = tpm_field_sd(sh);
+        printf("K=%d N=%d L=%d (sigma %.1f)\n", sh->K, sh->N, sh->L, sigma);
+        for (size_t j = 0; j < sizeof(fixed) / sizeof(fixed[0]); j++)
+            row(sh, (int)lround(fixed[j] * sigma), 0, trials);
+        for (size_t j = 0; j < sizeof(caps) / sizeof(caps[0]); j++)
+            row(sh, 0, (int)lround(caps[j] * sigma), trials);
+    }
+    return 0;
+}
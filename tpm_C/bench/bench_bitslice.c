@@ -0,0 +1,64 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * 비트 슬라이스 시뮬레이터 (bitslice.c) 를 스칼라 루프 (sim.c) 와 같은 seed 로 돌려
+ * 시행마다 (rounds, repulsive, synced) 가 같은지 보고, 한 스레드 처리량을 비교한다.
+ * 64 lane 과 256 lane 은 TPM_BITSLICE 환경 변수로 바꿔 가며 잰다.
+ *   ./build/bench/bench_bitslice [trials]
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double run(tpm_sim_cfg *cfg, int bitslice, uint64_t n, tpm_sim_trial *out) {
+    cfg->bitslice = bitslice;
+    double t0 = now_sec();
+    if (tpm_sim_run(cfg, 1, 0, n, 1, out) < 0) ErrorHandling("tpm_sim_run");
+    return now_sec() - t0;
+}
+
+static uint64_t mismatches(const tpm_sim_trial *a, const tpm_sim_trial *b, uint64_t n) {
+    uint64_t bad = 0;
+    for (uint64_t i = 0; i < n; i++)
+        if (a[i].rounds != b[i].rounds || a[i].repulsive != b[i].repulsive || a[i].synced != b[i].synced) bad++;
+    return bad;
+}
+
+static void bench(tpm_rule rule, int K, int N, int L, uint32_t max_rounds, uint64_t n) {
+    tpm_sim_cfg cfg = { rule, { K, N, L }, 0, max_rounds, 0, 0, { 0, 0, 0 } };
+    tpm_sim_trial *ref = malloc(n * sizeof(*ref)), *got = malloc(n * sizeof(*got));
+    if (ref == NULL || got == NULL) ErrorHandling("malloc");
+
+    double ts = run(&cfg, 0, n, ref);
+    printf("  %-6s K=%d N=%-3d L=%d  scalar %8.0f trials/s", tpm_rule_get(rule)->name, K, N, L, n / ts);
+
+    static const char *lanes[] = { "64", "256" };
+    for (int v = 0; v < 2; v++) {
+        setenv("TPM_BITSLICE", lanes[v], 1);
+        if (v == 1 && tpm_bitslice_lanes() != 256) continue;
+        memset(got, 0, n * sizeof(*got));
+        double tb = run(&cfg, 1, n, got);
+        uint64_t bad = mismatches(ref, got, n);
+        printf("  | %3s lanes %8.0f trials/s (x%.2f) %s", lanes[v], n / tb, ts / tb, bad ? "MISMATCH" : "ok");
+        if (bad) printf(" %llu", (unsigned long long)bad);
+    }
+    unsetenv("TPM_BITSLICE");
+    printf("\n");
+    free(ref);
+    free(got);
+}
+
+int main(int argc, char **argv) {
+    uint64_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 20000;
+
+    printf("one thread, default H, max-rounds 5000, %llu trials per case\n", (unsigned long long)n);
+    for (int r = 0; r < RULE_COUNT; r++) {
+        bench((tpm_rule)r, 3, 4, 3, 5000, n);
+        bench((tpm_rule)r, 3, 16, 4, 5000, n / 4);
+    }
+    return 0;
+}
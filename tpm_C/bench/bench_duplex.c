@@ -0,0 +1,193 @@
+#define _GNU_SOURCE
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include "tpm.h"
+
+/*
+ * lockstep 과 duplex 동기화 루프를 지연을 건 연결 위에서 비교한다.
+ * 서버·클라이언트 스레드 사이에 릴레이 스레드를 두고 방향마다 RTT/2 만큼 묶어 두었다 넘긴다.
+ *   ./build/bench/bench_duplex [trials]
+ * 라운드 수는 시행마다 다르므로 라운드당 시간(ms/iter)으로 비교한다.
+ */
+
+typedef struct chunk {
+    struct chunk *next;
+    double due;
+    size_t len;
+    uint8_t data[];
+} chunk;
+
+typedef struct {
+    int fd[2];          // [0]: 서버 쪽, [1]: 클라이언트 쪽
+    double delay;       // 편도 지연 (초)
+} relay_args;
+
+typedef struct {
+    int fd;
+    tpm_hello_info info;
+    tpm_sync_result res;
+    int ok;
+    double elapsed;
+} peer_args;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *relay_main(void *arg) {
+    relay_args *r = arg;
+    chunk *head[2] = { NULL, NULL }, **tail[2] = { &head[0], &head[1] };
+    int open_[2] = { 1, 1 }, shut[2] = { 0, 0 };
+    uint8_t buf[65536];
+
+    while (open_[0] || open_[1] || head[0] || head[1]) {
+        // 가장 먼저 도착할 조각까지만 기다린다
+        double next = -1, t = now_sec();
+        for (int d = 0; d < 2; d++)
+            if (head[d] && (next < 0 || head[d]->due < next)) next = head[d]->due;
+        struct timespec ts, *tsp = NULL;
+        if (next >= 0) {
+            double w = next > t ? next - t : 0;
+            ts.tv_sec = (time_t)w;
+            ts.tv_nsec = (long)((w - ts.tv_sec) * 1e9);
+            tsp = &ts;
+        }
+        struct pollfd pfd[2] = { { open_[0] ? r->fd[0] : -1, POLLIN, 0 }, { open_[1] ? r->fd[1] : -1, POLLIN, 0 } };
+        if (ppoll(pfd, 2, tsp, NULL) < 0 && errno != EINTR) break;
+
+        t = now_sec();
+        for (int d = 0; d < 2; d++) {
+            if (!(pfd[d].revents & (POLLIN | POLLHUP))) continue;
+            ssize_t n = read(r->fd[d], buf, sizeof(buf));
+            if (n <= 0) {
+                open_[d] = 0;
+                continue;
+            }
+            chunk *c = malloc(sizeof(*c) + n);
+            c->next = NULL;
+            c->due = t + r->delay;
+            c->len = n;
+            memcpy(c->data, buf, n);
+            *tail[d] = c;
+            tail[d] = &c->next;
+        }
+        // d 방향으로 들어온 조각은 반대쪽 fd 로 내보낸다
+        for (int d = 0; d < 2; d++) {
+            while (head[d] && head[d]->due <= t) {
+                chunk *c = head[d];
+                send(r->fd[d ^ 1], c->data, c->len, MSG_NOSIGNAL);
+                head[d] = c->next;
+                if (head[d] == NULL) tail[d] = &head[d];
+                free(c);
+            }
+            // 닫힌 방향은 남은 조각을 다 넘긴 뒤에 반대쪽에도 EOF 를 전한다
+            if (!open_[d] && head[d] == NULL && !shut[d]) {
+                shutdown(r->fd[d ^ 1], SHUT_WR);
+                shut[d] = 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *server_main(void *arg) {
+    peer_args *p = arg;
+    tpm_sync_opts opts = { 2, TPM_DEFAULT_WINDOW, 0, 0, 0, 0, { 0, 0, 0 } };
+    tpm_session *s = tpm_session_server(p->fd, &p->info, &opts);
+
+    if (s != NULL) {
+        while (tpm_session_state(s) == TPM_SESS_HANDSHAKE) tpm_session_step(s);
+        double t0 = now_sec();
+        p->ok = tpm_session_run(s) == TPM_SESS_DONE;
+        p->elapsed = now_sec() - t0;
+        p->res = *tpm_session_result(s);
+    }
+    shutdown(p->fd, SHUT_WR);
+    tpm_session_free(s);
+    return NULL;
+}
+
+static void *client_main(void *arg) {
+    peer_args *p = arg;
+    tpm_sync_opts opts = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    tpm_session *s = tpm_session_client(p->fd, &opts);
+    uint8_t tmp[256];
+
+    if (s == NULL) return NULL;
+    p->ok = tpm_session_run(s) == TPM_SESS_DONE;
+    p->res = *tpm_session_result(s);
+    shutdown(p->fd, SHUT_WR);
+    while (tpm_conn_read(tpm_session_conn(s), tmp, sizeof(tmp)) > 0) {}
+    tpm_session_free(s);
+    return NULL;
+}
+
+/* 한 번의 동기화. 성공하면 라운드 수를 돌려주고 *elapsed 에 서버 쪽 소요 시간을 넣는다. */
+static int run_once(const tpm_shape *shape, tpm_rule rule, uint16_t flags, double rtt, double *elapsed) {
+    int sp_s[2], sp_c[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sp_s) < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, sp_c) < 0)
+        ErrorHandling("socketpair");
+
+    relay_args ra = { { sp_s[1], sp_c[1] }, rtt / 2 };
+    peer_args srv = { .fd = sp_s[0], .info = { rule, *shape, flags, 0 } };
+    peer_args cli = { .fd = sp_c[0] };
+    pthread_t tr, ts, tc;
+    pthread_create(&tr, NULL, relay_main, &ra);
+    pthread_create(&ts, NULL, server_main, &srv);
+    pthread_create(&tc, NULL, client_main, &cli);
+    pthread_join(ts, NULL);
+    pthread_join(tc, NULL);
+    pthread_join(tr, NULL);
+    close(sp_s[0]); close(sp_s[1]); close(sp_c[0]); close(sp_c[1]);
+
+    if (!srv.ok || !cli.ok || srv.res.iterations != cli.res.iterations) return -1;
+    *elapsed = srv.elapsed;
+    return srv.res.iterations;
+}
+
+static void run_rtt(const tpm_shape *shape, tpm_rule rule, double rtt, int trials) {
+    static const struct { const char *name; uint16_t flags; } modes[] = {
+        { "lockstep",        0 },
+        { "lockstep+seeded", TPM_F_SEEDED },
+        { "duplex",          TPM_F_DUPLEX },
+        { "duplex+seeded",   TPM_F_DUPLEX | TPM_F_SEEDED },
+    };
+    double base = 0;
+
+    printf("\nK=%d N=%d L=%d rule=%s, RTT %.0f ms, %d trial(s)\n", shape->K, shape->N, shape->L,
+           tpm_rule_get(rule)->name, rtt * 1e3, trials);
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        long iters = 0;
+        double total = 0, el;
+        int fail = 0;
+        for (int t = 0; t < trials; t++) {
+            int it = run_once(shape, rule, modes[m].flags, rtt, &el);
+            if (it < 0) { fail = 1; break; }
+            iters += it;
+            total += el;
+        }
+        if (fail) {
+            printf("  %-16s FAILED\n", modes[m].name);
+            continue;
+        }
+        double per = total / iters * 1e3;
+        if (m == 0) base = per;
+        printf("  %-16s %6ld iters  %8.2f s  %7.3f ms/iter  (x%.2f)\n",
+               modes[m].name, iters, total, per, base / per);
+    }
+}
+
+int main(int argc, char **argv) {
+    int trials = argc > 1 ? atoi(argv[1]) : 3;
+    tpm_shape small = { 3, 4, 3 }, wide = { 3, 100, 3 };
+
+    signal(SIGPIPE, SIG_IGN);
+    run_rtt(&small, RULE_RANDOM_WALK, 0.001, trials);
+    run_rtt(&small, RULE_QUERY, 0.001, trials);
+    run_rtt(&wide, RULE_RANDOM_WALK, 0.001, trials);
+    run_rtt(&small, RULE_RANDOM_WALK, 0.020, 1);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * 유전 공격 무리 (genetic.c, 칸을 한 번 잡아 재사용) 를 개체마다 init_tpm / free_tpm 하는 단순한 구현과
+ * 같은 입력으로 돌려 처리량 (개체-라운드/s) 을 비교하고, 끝난 뒤 두 무리의 개체 수와 가중치가 같은지 본다.
+ *   ./build/bench/bench_genetic [rounds]
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* 개체마다 TPM 을 따로 할당하는 구현. 규칙은 genetic.c 와 같다. */
+typedef struct {
+    TPM **e;
+    uint32_t *fit;
+    int n, cap, variants;
+} naive_pop;
+
+static TPM *naive_clone(const TPM *src, tpm_rule rule) {
+    TPM *c = malloc(sizeof(*c));
+    if (c == NULL || init_tpm(c, &src->shape, rule) < 0) ErrorHandling("init_tpm");
+    memcpy(c->weights, src->weights, tpm_vec_len(&src->shape));
+    return c;
+}
+
+static void naive_drop(TPM *e) {
+    free_tpm(e);
+    free(e);
+}
+
+static void naive_mutate(naive_pop *p, tpm_rule rule, const int8_t *theta, int tau) {
+    const int n = p->n, K = p->e[0]->shape.K;
+    for (int i = 0; i < n; i++)
+        for (int v = 1; v < p->variants; v++) {
+            const int d = n + i * (p->variants - 1) + v - 1;
+            p->e[d] = naive_clone(p->e[i], rule);
+            p->fit[d] = p->fit[i];
+        }
+    for (int i = 0; i < n; i++)
+        for (int v = 0; v < p->variants; v++) {
+            TPM *e = p->e[v == 0 ? i : n + i * (p->variants - 1) + v - 1];
+            int prod = 1;
+            for (int k = 0; k < K - 1; k++) {
+                e->sigma[k] = v >> k & 1 ? -1 : 1;
+                prod *= e->sigma[k];
+            }
+            e->sigma[K - 1] = prod * tau;
+            e->tau = tau;
+            update_weights(e, theta);
+        }
+    p->n = n * p->variants;
+}
+
+static void naive_round(naive_pop *p, tpm_rule rule, const int8_t *x, const int8_t *theta, int tau) {
+    int keep = 0;
+    for (int i = 0; i < p->n; i++) {
+        calculate_tau(p->e[i], x);
+        p->fit[i] += p->e[i]->tau == tau;
+    }
+    if (p->n * p->variants <= p->cap) {
+        naive_mutate(p, rule, theta, tau);
+        return;
+    }
+    for (int i = 0; i < p->n; i++) keep += p->e[i]->tau == tau;
+    if (keep == 0) {
+        // 적합도가 큰 cap / variants 개 (같으면 앞) 를 칸 순서대로 남긴다
+        const int want = p->cap / p->variants;
+        char *sel = calloc((size_t)p->n, 1);
+        if (sel == NULL) ErrorHandling("calloc");
+        for (int c = 0; c < want; c++) {
+            int best = -1;
+            for (int i = 0; i < p->n; i++)
+                if (!sel[i] && (best < 0 || p->fit[i] > p->fit[best])) best = i;
+            sel[best] = 1;
+        }
+        int j = 0;
+        for (int i = 0; i < p->n; i++) {
+            if (!sel[i]) {
+                naive_drop(p->e[i]);
+                continue;
+            }
+            p->e[j] = p->e[i];
+            p->fit[j++] = p->fit[i];
+        }
+        free(sel);
+        p->n = j;
+        naive_mutate(p, rule, theta, tau);
+        return;
+    }
+    int j = 0;
+    for (int i = 0; i < p->n; i++) {
+        if (p->e[i]->tau != tau) {
+            naive_drop(p->e[i]);
+            continue;
+        }
+        p->e[j] = p->e[i];
+        p->fit[j++] = p->fit[i];
+    }
+    p->n = j;
+    for (int i = 0; i < p->n; i++) update_weights(p->e[i], theta);
+}
+
+static void bench(tpm_rule rule, const tpm_shape *sh, int cap, int rounds) {
+    const size_t len = tpm_vec_len(sh);
+    int8_t *x = malloc(len * rounds), *theta = malloc(len * rounds);
+    int *tau = malloc(rounds * sizeof(*tau));
+    TPM a;
+    if (x == NULL || theta == NULL || tau == NULL || init_tpm(&a, sh, rule) < 0) ErrorHandling("malloc");
+
+    // A 의 입력, theta, tau 를 미리 만든다 (두 구현이 같은 입력을 본다)
+    tpm_rand_seed(7);
+    tpm_randomize_weights(&a);
+    for (int r = 0; r < rounds; r++) {
+        generate_inputs(sh, x + len * r);
+        generate_inputs(sh, theta + len * r);
+        calculate_tau(&a, x + len * r);
+        tau[r] = a.tau;
+        update_weights(&a, theta + len * r);
+    }
+
+    tpm_genetic *g = tpm_genetic_new(sh, rule, cap);
+    naive_pop p = { calloc((size_t)cap, sizeof(TPM *)), calloc((size_t)cap, sizeof(uint32_t)), 1, cap,
+                    1 << (sh->K - 1) };
+    if (g == NULL || p.e == NULL || p.fit == NULL) ErrorHandling("malloc");
+
+    tpm_rand_seed(11);
+    tpm_genetic_reset(g);
+    p.e[0] = malloc(sizeof(TPM));
+    if (p.e[0] == NULL || init_tpm(p.e[0], sh, rule) < 0) ErrorHandling("init_tpm");
+    tpm_rand_seed(11);
+    tpm_randomize_weights(p.e[0]);
+
+    double work_pool = 0, work_naive = 0;
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        work_pool += tpm_genetic_size(g);
+        tpm_genetic_round(g, x + len * r, theta + len * r, tau[r]);
+    }
+    double t1 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        work_naive += p.n;
+        naive_round(&p, rule, x + len * r, theta + len * r, tau[r]);
+    }
+    double t2 = now_sec();
+
+    int bad = tpm_genetic_size(g) != p.n;
+    for (int i = 0; i < p.n && !bad; i++) bad = tpm_genetic_match(g, p.e[i]->weights) < 0;
+    printf("  %-6s K=%d N=%-3d L=%d cap %-5d  naive %7.2f M/s | pooled %7.2f M/s (x%.2f) %s\n",
+           tpm_rule_get(rule)->name, sh->K, sh->N, sh->L, cap, work_naive / (t2 - t1) * 1e-6,
+           work_pool / (t1 - t0) * 1e-6, (t2 - t1) / (t1 - t0), bad || work_pool != work_naive ? "MISMATCH" : "ok");
+
+    for (int i = 0; i < p.n; i++) naive_drop(p.e[i]);
+    free(p.e);
+    free(p.fit);
+    tpm_genetic_free(g);
+    free_tpm(&a);
+    free(x);
+    free(theta);
+    free(tau);
+}
+
+int main(int argc, char **argv) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : 4000;
+    static const tpm_shape shapes[] = { { 3, 4, 3 }, { 3, 16, 4 }, { 3, 100, 3 } };
+    static const int caps[] = { 256, 4096 };
+
+    printf("one thread, network-rounds per second (%d rounds per case)\n", rounds);
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++)
+        for (int r = 0; r < RULE_COUNT; r++)
+            for (size_t c = 0; c < sizeof(caps) / sizeof(caps[0]); c++)
+                bench((tpm_rule)r, &shapes[i], caps[c], rounds);
+    return 0;
+}
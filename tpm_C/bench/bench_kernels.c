@@ -0,0 +1,78 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * hidden unit 한 줄 커널 (dot / update_row) 을 N 별로 측정하고
+ * 모든 SIMD 커널 결과가 scalar 기준 구현과 같은지 확인한다.
+ *   ./build/bench/bench_kernels [rounds]
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill_weights(int8_t *w, int n, int L) {
+    for (int i = 0; i < n; i++) w[i] = (int8_t)((int)tpm_rand_below(2 * L + 1) - L);
+}
+
+static void fill_pm1(int8_t *x, int n) {
+    for (int i = 0; i < n; i++) x[i] = (int8_t)((int)(tpm_rand64() & 1) * 2 - 1);
+}
+
+static int verify(const tpm_simd_ops *ops, int n, int L) {
+    int8_t *w = malloc(n), *x = malloc(n), *ref = malloc(n), *got = malloc(n);
+    int ok = 1;
+
+    for (int trial = 0; trial < 64 && ok; trial++) {
+        fill_weights(w, n, L);
+        fill_pm1(x, n);
+        if (ops->dot(w, x, n) != tpm_simd_scalar.dot(w, x, n)) ok = 0;
+        for (int dir = 0; dir < 2 && ok; dir++) {
+            memcpy(ref, w, n);
+            memcpy(got, w, n);
+            tpm_simd_scalar.update_row[dir](ref, x, n, L);
+            ops->update_row[dir](got, x, n, L);
+            if (memcmp(ref, got, n) != 0) ok = 0;
+        }
+    }
+    free(w); free(x); free(ref); free(got);
+    return ok;
+}
+
+static void bench(const tpm_simd_ops *ops, int n, int L, long rounds) {
+    int8_t *w = malloc(n), *x = malloc(n);
+    volatile int sink = 0;
+    fill_weights(w, n, L);
+    fill_pm1(x, n);
+
+    double t0 = now_sec();
+    for (long r = 0; r < rounds; r++) sink += ops->dot(w, x, n);
+    double t1 = now_sec();
+    for (long r = 0; r < rounds; r++) ops->update_row[r & 1](w, x, n, L);
+    double t2 = now_sec();
+
+    printf("  %-7s N=%-6d dot %8.1f ns  update %8.1f ns  %s\n", ops->name, n,
+           (t1 - t0) * 1e9 / rounds, (t2 - t1) * 1e9 / rounds,
+           verify(ops, n, L) ? "ok" : "MISMATCH");
+    free(w); free(x);
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    static const int sizes[] = { 4, 100, 1000, 10000 };
+    long rounds = argc > 1 ? atol(argv[1]) : 200000;
+
+    tpm_rand_seed(1);
+    printf("selected: %s\n", tpm_simd_select()->name);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            const tpm_simd_ops *ops = tpm_simd_get(names[i]);
+            if (ops == NULL) continue;
+            bench(ops, sizes[s], 6, rounds / (sizes[s] / 100 + 1));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * 3/4/3 커널 두 가지를 같은 입력으로 잰다.
+ *   3/4/3      : 빌드 때 만든 표를 찾는 커널 (lib/lutgen.c, 기본으로 고른다)
+ *   3/4/3-loop : K/N/L 을 상수로 박아 펼친 곱셈 루프 (이전 기본)
+ *   generic    : K/N/L 을 실행 중에 읽는 루프
+ * 한 라운드는 calc_tau 만, 또는 calc_tau 뒤 update 다. 먼저 모든 커널의 sigma, tau, 가중치가
+ * 루프 커널과 같은지 두 방향 (+theta, -theta) 모두 확인한다.
+ *   ./build/bench/bench_lut [rounds]
+ */
+
+#define ROWS 4096   // 미리 뽑아 둔 입력 줄 수 (2 의 거듭제곱)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int verify(const tpm_kernel *kern, const tpm_kernel *ref, const int8_t *x, long rounds) {
+    static const tpm_shape sh = { 3, 4, 3 };
+    const size_t len = tpm_vec_len(&sh);
+    TPM a, b;
+    int ok = 1;
+
+    if (init_tpm(&a, &sh, RULE_RANDOM_WALK) < 0 || init_tpm(&b, &sh, RULE_RANDOM_WALK) < 0)
+        ErrorHandling("init_tpm");
+    for (int dir = 0; dir < 2; dir++) {
+        memcpy(b.weights, a.weights, len);
+        for (long r = 0; r < rounds && ok; r++) {
+            const int8_t *in = x + (size_t)(r & (ROWS - 1)) * len;
+            const int8_t *th = x + (size_t)((r * 7 + 1) & (ROWS - 1)) * len;
+            kern->calc_tau(&a, in);
+            ref->calc_tau(&b, in);
+            kern->update[dir](&a, th);
+            ref->update[dir](&b, th);
+            if (a.tau != b.tau || memcmp(a.sigma, b.sigma, sh.K * sizeof(int)) != 0 ||
+                memcmp(a.weights, b.weights, len) != 0)
+                ok = 0;
+        }
+    }
+    free_tpm(&a);
+    free_tpm(&b);
+    return ok;
+}
+
+static void bench(const tpm_kernel *kern, const int8_t *x, long rounds, int ok) {
+    static const tpm_shape sh = { 3, 4, 3 };
+    const size_t len = tpm_vec_len(&sh);
+    TPM t;
+    volatile int sink = 0;
+
+    if (init_tpm(&t, &sh, RULE_RANDOM_WALK) < 0) ErrorHandling("init_tpm");
+    double t0 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        kern->calc_tau(&t, x + (size_t)(r & (ROWS - 1)) * len);
+        sink += t.tau;
+    }
+    double t1 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        kern->calc_tau(&t, x + (size_t)(r & (ROWS - 1)) * len);
+        kern->update[0](&t, x + (size_t)((r * 7 + 1) & (ROWS - 1)) * len);
+    }
+    double t2 = now_sec();
+
+    printf("  %-11s  calc_tau %6.1f ns  calc_tau+update %6.1f ns  %s\n", kern->name, (t1 - t0) * 1e9 / rounds,
+           (t2 - t1) * 1e9 / rounds, ok ? "ok" : "MISMATCH");
+    free_tpm(&t);
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    static const char *names[] = { "3/4/3", "3/4/3-loop", "generic" };
+    static const tpm_shape sh = { 3, 4, 3 };
+    const long rounds = argc > 1 ? atol(argv[1]) : 20000000;
+    int8_t *x = malloc(ROWS * tpm_vec_len(&sh));
+    if (x == NULL) ErrorHandling("malloc");
+
+    tpm_rand_seed(1);
+    for (int i = 0; i < ROWS; i++) generate_inputs(&sh, x + i * tpm_vec_len(&sh));
+    const tpm_kernel *ref = tpm_kernel_get("3/4/3-loop");
+
+    printf("K=3 N=4 L=3, one thread, %ld rounds per row, selected: %s\n", rounds, tpm_kernel_select(&sh)->name);
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const tpm_kernel *kern = tpm_kernel_get(names[i]);
+        tpm_rand_seed(2);
+        int ok = verify(kern, ref, x, 1000000);
+        tpm_rand_seed(3);
+        bench(kern, x, rounds, ok);
+    }
+    free(x);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <limits.h>
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * 공격자 M 개를 TPM 구조체 M 개로 돌리는 루프 (attack.c 와 같은 기하 공격) 와
+ * 묶음 엔진 (majority.c) 의 기하 공격, 다수결 공격 처리량을 공격자-라운드/s 로 잰다.
+ * 기하 공격은 같은 입력을 주고 끝난 뒤 공격자마다 가중치가 같은지 본다.
+ *   ./build/bench/bench_majority [rounds]
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* attack.c 의 geometric_step 과 같다 */
+static void geometric_step(TPM *e, const int8_t *x, const int8_t *theta, int tau) {
+    calculate_tau(e, x);
+    if (e->tau != tau) {
+        const int N = e->shape.N;
+        int best = 0, best_h = INT_MAX;
+        for (int k = 0; k < e->shape.K; k++) {
+            int h = abs(e->simd->dot(e->weights + (size_t)k * N, x + (size_t)k * N, N));
+            if (h < best_h) {
+                best_h = h;
+                best = k;
+            }
+        }
+        e->sigma[best] = -e->sigma[best];
+        e->tau = tau;
+    }
+    update_weights(e, theta);
+}
+
+/* 라운드마다 A 의 입력, theta, tau 를 미리 만들어 둔다 (세 경로가 같은 입력을 본다) */
+typedef struct {
+    int8_t *x, *theta;
+    int *tau;
+} script;
+
+static void make_script(const tpm_shape *sh, tpm_rule rule, int rounds, script *s) {
+    const size_t len = tpm_vec_len(sh);
+    TPM a;
+    s->x = malloc(len * rounds);
+    s->theta = malloc(len * rounds);
+    s->tau = malloc(rounds * sizeof(*s->tau));
+    if (s->x == NULL || s->theta == NULL || s->tau == NULL || init_tpm(&a, sh, rule) < 0) ErrorHandling("malloc");
+    tpm_rand_seed(7);
+    tpm_randomize_weights(&a);
+    for (int r = 0; r < rounds; r++) {
+        int8_t *x = s->x + len * r, *theta = s->theta + len * r;
+        generate_inputs(sh, x);
+        generate_inputs(sh, theta);
+        calculate_tau(&a, x);
+        s->tau[r] = a.tau;
+        update_weights(&a, theta);
+    }
+    free_tpm(&a);
+}
+
+static void bench(tpm_rule rule, const tpm_shape *sh, int M, int rounds, const script *s) {
+    const size_t len = tpm_vec_len(sh);
+    TPM *e = calloc((size_t)M, sizeof(*e));
+    tpm_majority *geo = tpm_majority_new(sh, rule, M, 0), *maj = tpm_majority_new(sh, rule, M, 1);
+    int8_t *w = malloc(len);
+    if (e == NULL || geo == NULL || maj == NULL || w == NULL) ErrorHandling("malloc");
+    for (int m = 0; m < M; m++)
+        if (init_tpm(&e[m], sh, rule) < 0) ErrorHandling("init_tpm");
+
+    tpm_rand_seed(11);
+    for (int m = 0; m < M; m++) tpm_randomize_weights(&e[m]);
+    tpm_rand_seed(11);
+    tpm_majority_randomize(geo);
+    tpm_rand_seed(11);
+    tpm_majority_randomize(maj);
+
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++)
+        for (int m = 0; m < M; m++) geometric_step(&e[m], s->x + len * r, s->theta + len * r, s->tau[r]);
+    double t1 = now_sec();
+    for (int r = 0; r < rounds; r++) tpm_majority_round(geo, s->x + len * r, s->theta + len * r, s->tau[r]);
+    double t2 = now_sec();
+    for (int r = 0; r < rounds; r++) tpm_majority_round(maj, s->x + len * r, s->theta + len * r, s->tau[r]);
+    double t3 = now_sec();
+
+    int bad = 0;
+    for (int m = 0; m < M; m++) {
+        tpm_majority_get(geo, m, w);
+        bad += memcmp(w, e[m].weights, len) != 0;
+    }
+    double ops = (double)M * rounds;
+    printf("  %-6s M=%-5d  TPM x M %8.2f M/s | SoA geometric %8.2f M/s (x%.2f) %s | SoA majority %8.2f M/s (x%.2f)\n",
+           tpm_rule_get(rule)->name, M, ops / (t1 - t0) * 1e-6, ops / (t2 - t1) * 1e-6, (t1 - t0) / (t2 - t1),
+           bad ? "MISMATCH" : "ok", ops / (t3 - t2) * 1e-6, (t1 - t0) / (t3 - t2));
+
+    for (int m = 0; m < M; m++) free_tpm(&e[m]);
+    free(e);
+    tpm_majority_free(geo);
+    tpm_majority_free(maj);
+    free(w);
+}
+
+int main(int argc, char **argv) {
+    const int total = argc > 1 ? atoi(argv[1]) : 1 << 22;    // 공격자-라운드 수
+    static const tpm_shape shapes[] = { { 3, 4, 3 }, { 3, 16, 4 } };
+    static const int Ms[] = { 1, 16, 128, 1024 };
+
+    printf("one thread, attacker-rounds per second (%d per case)\n", total);
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        const tpm_shape *sh = &shapes[i];
+        printf("K=%d N=%d L=%d\n", sh->K, sh->N, sh->L);
+        for (int r = 0; r < RULE_COUNT; r++) {
+            for (size_t j = 0; j < sizeof(Ms) / sizeof(Ms[0]); j++) {
+                int rounds = total / Ms[j];
+                script s;
+                make_script(sh, (tpm_rule)r, rounds, &s);
+                bench((tpm_rule)r, sh, Ms[j], rounds, &s);
+                free(s.x);
+                free(s.theta);
+                free(s.tau);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * int8 커널과 비트 평면(popcount) 커널을 같은 입력열로 돌려
+ * 라운드(calc_tau + update) 당 시간과 결과 일치 여부를 비교한다.
+ *   ./build/bench/bench_packed [rounds]
+ */
+
+#define POOL 64
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_shape(tpm_shape shape, tpm_rule rule, long rounds) {
+    TPM a, b;
+    size_t len = tpm_vec_len(&shape), blen = tpm_bits_len(&shape);
+    int8_t *x = malloc(len * POOL), *t = malloc(len * POOL);
+    uint64_t *xb = malloc(blen * POOL * sizeof(uint64_t)), *tb = malloc(blen * POOL * sizeof(uint64_t));
+
+    init_tpm(&a, &shape, rule);
+    init_tpm(&b, &shape, rule);
+    memcpy(b.weights, a.weights, len);
+    tpm_enable_packed(&b);
+
+    for (int i = 0; i < POOL; i++) {
+        generate_input_bits(&shape, xb + i * blen);
+        generate_input_bits(&shape, tb + i * blen);
+        tpm_unpack_bits(&shape, xb + i * blen, x + i * len);
+        tpm_unpack_bits(&shape, tb + i * blen, t + i * len);
+    }
+
+    // 일치 확인: 같은 입력에서 tau 와 갱신 후 가중치가 같아야 한다
+    int ok = 1;
+    for (long r = 0; r < 4 * POOL && ok; r++) {
+        int i = (int)(r % POOL);
+        calculate_tau(&a, x + i * len);
+        calculate_tau_bits(&b, xb + i * blen);
+        if (a.tau != b.tau) ok = 0;
+        update_weights(&a, t + i * len);
+        update_weights_bits(&b, tb + i * blen);
+    }
+    tpm_sync_weights(&b);
+    if (memcmp(a.weights, b.weights, len) != 0) ok = 0;
+
+    double t0 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        int i = (int)(r % POOL);
+        calculate_tau(&a, x + i * len);
+        update_weights(&a, t + i * len);
+    }
+    double t1 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        int i = (int)(r % POOL);
+        calculate_tau_bits(&b, xb + i * blen);
+        update_weights_bits(&b, tb + i * blen);
+    }
+    double t2 = now_sec();
+
+    printf("  %d/%d/%d %-6s int8(%s) %9.1f ns  packed %9.1f ns  input %6zu B -> %5zu B  %s\n",
+           shape.K, shape.N, shape.L, a.ops->name, a.simd->name,
+           (t1 - t0) * 1e9 / rounds, (t2 - t1) * 1e9 / rounds,
+           len, blen * sizeof(uint64_t), ok ? "ok" : "MISMATCH");
+
+    free_tpm(&a);
+    free_tpm(&b);
+    free(x); free(t); free(xb); free(tb);
+}
+
+int main(int argc, char **argv) {
+    static const tpm_shape shapes[] = { { 3, 4, 3 }, { 3, 100, 3 }, { 2, 70, 5 }, { 3, 1000, 6 }, { 3, 10000, 6 } };
+    long rounds = argc > 1 ? atol(argv[1]) : 100000;
+
+    tpm_rand_seed(1);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        long r = rounds / (shapes[s].N / 100 + 1);
+        run_shape(shapes[s], RULE_RANDOM_WALK, r);
+        run_shape(shapes[s], RULE_ANTI_HEBBIAN, r);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <time.h>
+#include "tpm.h"
+
+/*
+ * query 입력 만들기 비용과 적중률을 N 마다 잰다.
+ *   search    : 이전 방식. 고른 hidden unit 하나에서 임의 위치를 뒤집고 h 를 다시 계산하기를 200 번까지,
+ *               못 맞추면 고른 입력으로 되돌린다.
+ *   construct : generate_query_inputs (unit 마다 1 .. 2H-1 에서 뽑은 목표에 |w| 별 개수로 바로 맞춘다)
+ * 적중률은 |h| 가 목표 범위 (search 는 H±1, construct 는 0 .. 2H) 안인 hidden unit 의 비율이다.
+ * H 는 N, L 마다 tpm_query_H 로 정한다.
+ *   ./build/bench/bench_query [calls]
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void search_query_inputs(const TPM *tpm, int8_t *x, int H) {
+    const int N = tpm->shape.N;
+    generate_inputs(&tpm->shape, x);
+
+    int target_k = (int)tpm_rand_below((uint32_t)tpm->shape.K);
+    const int8_t *w = tpm->weights + (size_t)target_k * N;
+    int8_t *xk = x + (size_t)target_k * N;
+    int max_iter = 200;
+
+    while (max_iter--) {
+        int h = 0;
+        for (int n = 0; n < N; n++)
+            h += w[n] * xk[n];
+
+        if (abs(abs(h) - H) <= 1)
+            return;
+
+        int n = (int)tpm_rand_below((uint32_t)N);
+        xk[n] = -xk[n];
+    }
+
+    generate_inputs(&tpm->shape, x);
+}
+
+static double hits(const TPM *tpm, const int8_t *x, int lo, int hi) {
+    const int N = tpm->shape.N;
+    int hit = 0;
+    for (int k = 0; k < tpm->shape.K; k++) {
+        int h = 0;
+        for (int n = 0; n < N; n++) h += tpm->weights[(size_t)k * N + n] * x[(size_t)k * N + n];
+        hit += abs(h) >= lo && abs(h) <= hi;
+    }
+    return (double)hit / tpm->shape.K;
+}
+
+typedef void (*query_fn)(const TPM *tpm, int8_t *x, int H);
+
+/* calls 번 만들어 걸린 시간을 돌려준다. hit 이 있으면 (시간과 따로) |h| 가 lo .. hi 인 비율을 더한다. */
+static double run(query_fn fn, TPM *a, int8_t *x, int H, int calls, double *hit, int lo, int hi) {
+    tpm_rand_seed(3);
+    double t0 = now_sec();
+    for (int i = 0; i < calls; i++) {
+        if ((i & 63) == 0) tpm_randomize_weights(a);
+        fn(a, x, H);
+        if (hit != NULL) *hit += hits(a, x, lo, hi);
+    }
+    return now_sec() - t0;
+}
+
+static void bench(int N, int L, int calls) {
+    const tpm_shape sh = { 3, N, L };
+    const int H = tpm_query_H(&sh);
+    TPM a;
+    int8_t *x = tpm_alloc_vec(&sh);
+    if (x == NULL || init_tpm(&a, &sh, RULE_QUERY) < 0) ErrorHandling("init_tpm");
+
+    double hs = 0, hc = 0;
+    double ts = run(search_query_inputs, &a, x, H, calls, NULL, 0, 0);
+    double tc = run(generate_query_inputs, &a, x, H, calls, NULL, 0, 0);
+    run(search_query_inputs, &a, x, H, calls, &hs, H - 1, H + 1);
+    run(generate_query_inputs, &a, x, H, calls, &hc, 0, 2 * H);
+
+    printf("  N=%-5d L=%d H=%-3d  search %9.0f ns/call hit %5.1f%% | construct %7.0f ns/call hit %5.1f%% (x%.1f)\n",
+           N, L, H, ts / calls * 1e9, 100 * hs / calls, tc / calls * 1e9, 100 * hc / calls, ts / tc);
+    free_tpm(&a);
+    free(x);
+}
+
+int main(int argc, char **argv) {
+    const int calls = argc > 1 ? atoi(argv[1]) : 20000;
+    static const int Ns[] = { 4, 16, 100, 1000, 10000 };
+
+    printf("K=3, one thread, %d calls per case (N >= 1000: a tenth)\n", calls);
+    for (size_t i = 0; i < sizeof(Ns) / sizeof(Ns[0]); i++) {
+        const int N = Ns[i], c = N >= 1000 ? calls / 10 : calls;
+        bench(N, 3, c);
+        bench(N, 5, c);
+    }
+    return 0;
+}
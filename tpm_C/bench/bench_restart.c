@@ -0,0 +1,71 @@
+#include "tpm.h"
+
+/*
+ * 늦은 교환을 끊는 정책 (restart.c) 마다 같은 seed 의 시행을 돌려 라운드 분포를 비교한다.
+ * 분위는 실패한 시행까지 모두 넣어 센다 (실패한 시행은 멈춘 라운드). 그래서 정책이 없을 때
+ * 갇힌 시행이 0.1% 를 넘으면 p999 는 max-rounds 가 된다. mean 은 실패까지 넣은 평균, 곧 드는 일의 양이다.
+ *   ./build/bench/bench_restart [trials]
+ */
+
+#define MAX_ROUNDS 20000
+
+typedef struct {
+    const char *name;
+    tpm_restart_policy policy;
+} policy_case;
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void row(const tpm_sim_cfg *base, const policy_case *pc, uint64_t trials, tpm_sim_trial *t, uint32_t *r) {
+    tpm_sim_cfg cfg = *base;
+    cfg.policy = pc->policy;
+    if (tpm_sim_run(&cfg, 1, 0, trials, 0, t) < 0) ErrorHandling("tpm_sim_run");
+
+    uint64_t failed = 0, restarts = 0, work = 0;
+    for (uint64_t i = 0; i < trials; i++) {
+        r[i] = t[i].rounds;
+        failed += !t[i].synced;
+        restarts += t[i].restarts;
+        work += t[i].rounds;
+    }
+    qsort(r, trials, sizeof(*r), cmp_u32);
+    printf("  %-22s  failed %5llu  mean %8.1f  p50 %5u  p99 %6u  p999 %6u  max %6u  restarts/trial %.3f\n",
+           pc->name, (unsigned long long)failed, (double)work / trials, r[trials / 2], r[trials * 99 / 100],
+           r[trials * 999 / 1000], r[trials - 1], (double)restarts / trials);
+}
+
+int main(int argc, char **argv) {
+    const uint64_t trials = argc > 1 ? strtoull(argv[1], NULL, 10) : 20000;
+    static const tpm_sim_cfg shapes[] = {
+        { RULE_RANDOM_WALK, { 3, 4, 3 }, 0, MAX_ROUNDS, 0, 0, { 0, 0, 0 } },
+        { RULE_ANTI_HEBBIAN, { 3, 4, 3 }, 0, MAX_ROUNDS, 0, 0, { 0, 0, 0 } },
+        { RULE_QUERY, { 3, 16, 3 }, 26, MAX_ROUNDS, 0, 0, { 0, 0, 0 } },
+    };
+    static const policy_case policies[] = {
+        { "none", { 0, 0, 0 } },
+        { "max-repulsive 2000", { 2000, 0, 0 } },
+        { "restart 400", { 0, 400, 0 } },
+        { "restart 1000", { 0, 1000, 0 } },
+        { "restart 100 luby", { 0, 100, 1 } },
+        { "restart 300 luby", { 0, 300, 1 } },
+    };
+    tpm_sim_trial *t = malloc(trials * sizeof(*t));
+    uint32_t *r = malloc(trials * sizeof(*r));
+    if (t == NULL || r == NULL || trials == 0) ErrorHandling("malloc");
+
+    printf("%llu trials per row (seed 1), max-rounds %d, rounds over all trials\n", (unsigned long long)trials,
+           MAX_ROUNDS);
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        const tpm_sim_cfg *s = &shapes[i];
+        printf("%s K=%d N=%d L=%d", tpm_rule_get(s->rule)->name, s->shape.K, s->shape.N, s->shape.L);
+        if (s->rule == RULE_QUERY) printf(" H=%d", s->H);
+        printf("\n");
+        for (size_t j = 0; j < sizeof(policies) / sizeof(policies[0]); j++) row(s, &policies[j], trials, t, r);
+    }
+    free(t);
+    free(r);
+    return 0;
+}
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "tpm.h"
+
+/*
+ * 다중 세션 서버의 처리량과 동기화 시간 분포 (epoll: evserver.c, io_uring: uring.c).
+ * 서버는 fork 한 자식 프로세스에서 돌리고, 부모는 epoll 로 동시 연결 C 개를 유지하며
+ * 세션이 끝날 때마다 새 연결을 연다. 시간은 connect 부터 DONE 까지 (클라이언트 기준).
+ *   ./build/bench/bench_sessions [sessions-per-client-slot] [C] [threads] [epoll|uring]
+ * C 를 주면 그 동시 연결 수만 잰다. threads 는 epoll 서버 워커 수 (기본: 온라인 CPU 수).
+ * 백엔드를 주지 않으면 둘 다 잰다. 서버 줄의 syscalls/round 는 서버 프로세스가 부른 시스템 콜 수다.
+ */
+
+#define RAMP 512            // 루프 한 번에 새로 여는 연결 수 (listen backlog 넘침 방지)
+#define MAX_ROUNDS 20000    // 이보다 길면 갱신이 멈춘 세션으로 보고 실패 처리
+
+typedef struct {
+    int conc;
+    unsigned long total;
+    unsigned long started, done, failed;
+    unsigned long active, peak;
+    uint64_t rounds;
+    tpm_lat lat;
+} load;
+
+static tpm_session **slots;
+static int nslots;
+
+static int open_client(int epfd, const struct sockaddr_in *addr, load *ld) {
+    static const tpm_sync_opts opts = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    if (fd >= nslots || (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0 && errno != EINPROGRESS)) {
+        close(fd);
+        return -1;
+    }
+    // 연결이 끝나기 전에 만들어도 된다. 클라이언트는 HELLO 를 받기 전엔 보낼 것이 없다.
+    slots[fd] = tpm_session_client(fd, &opts);
+    struct epoll_event e = { .events = EPOLLIN, .data.fd = fd };
+    if (slots[fd] == NULL || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &e) < 0) {
+        tpm_session_free(slots[fd]);
+        slots[fd] = NULL;
+        close(fd);
+        return -1;
+    }
+    ld->started++;
+    if (++ld->active > ld->peak) ld->peak = ld->active;
+    return 0;
+}
+
+static void close_client(int epfd, int fd, load *ld) {
+    tpm_session *s = slots[fd];
+    if (tpm_session_state(s) == TPM_SESS_DONE) {
+        ld->done++;
+        ld->rounds += (uint64_t)tpm_session_result(s)->iterations;
+        tpm_lat_add(&ld->lat, tpm_session_result(s)->elapsed_ns);
+    } else {
+        ld->failed++;
+    }
+    ld->active--;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    tpm_session_free(s);
+    slots[fd] = NULL;
+}
+
+static void drive(const struct sockaddr_in *addr, load *ld) {
+    struct epoll_event events[256];
+    int epfd = epoll_create1(0);
+    if (epfd < 0) ErrorHandling("epoll_create1");
+
+    while (ld->done + ld->failed < ld->total) {
+        for (int i = 0; i < RAMP && ld->active < (unsigned long)ld->conc && ld->started < ld->total; i++) {
+            if (open_client(epfd, addr, ld) < 0) {
+                ld->started++;
+                ld->failed++;
+            }
+        }
+        int n = epoll_wait(epfd, events, (int)(sizeof(events) / sizeof(events[0])), 1000);
+        if (n < 0 && errno != EINTR) ErrorHandling("epoll_wait");
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            tpm_session *s = slots[fd];
+            if (s == NULL) continue;
+            if (events[i].events & EPOLLOUT) tpm_session_flush(s);
+            tpm_session_on_readable(s);
+            if (tpm_session_state(s) >= TPM_SESS_DONE) {
+                close_client(epfd, fd, ld);
+                continue;
+            }
+            struct epoll_event e = { .events = EPOLLIN | (tpm_session_want_write(s) ? EPOLLOUT : 0), .data.fd = fd };
+            epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &e);
+        }
+    }
+    close(epfd);
+}
+
+static void run_case(const tpm_hello_info *params, const char *mode, int uring, int conc, unsigned long total, int threads) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(addr);
+    int lfd = tpm_listen_tcp(&addr, SOMAXCONN);
+    if (lfd < 0 || getsockname(lfd, (struct sockaddr *)&addr, &alen) < 0)
+        ErrorHandling("listen");
+
+    tpm_evserver_cfg cfg = { .params = *params, .opts = { 2, TPM_DEFAULT_WINDOW, 0, 0, MAX_ROUNDS, 0, { 0, 0, 0 } },
+                             .threads = threads, .max_sessions = total };
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) ErrorHandling("fork");
+    if (pid == 0) {
+        tpm_evserver_stats st;
+        uint64_t seed;
+        // fork 한 자식은 부모의 스레드별 난수 상태를 그대로 물려받는다
+        if (tpm_random_bytes(&seed, sizeof(seed)) == 0) tpm_rand_seed(seed);
+        int r = uring ? tpm_uring_server_run(lfd, &cfg, &st) : tpm_evserver_run(lfd, &cfg, &st);
+        if (r < 0) perror(uring ? "tpm_uring_server_run" : "tpm_evserver_run");
+        printf("    server: done %lu, failed %lu, peak active %lu, steals %lu, %.2f syscalls/round\n",
+               st.done, st.failed, st.peak_active, st.steals, st.rounds ? (double)st.syscalls / st.rounds : 0.0);
+        fflush(stdout);
+        _exit(r < 0);
+    }
+    close(lfd);
+
+    load ld = { .conc = conc, .total = total };
+    uint64_t t0 = tpm_now_ns();
+    drive(&addr, &ld);
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+    waitpid(pid, NULL, 0);
+
+    printf("  %-14s %-5s C=%-6d %7lu sessions  %6.2f s  %8.0f sessions/s  %6.1f rounds/session  "
+           "p50 %7.2f ms  p99 %7.2f ms  (peak %lu, failed %lu)\n",
+           mode, uring ? "uring" : "epoll", conc, ld.done, sec, ld.done / sec, ld.done ? (double)ld.rounds / ld.done : 0.0,
+           tpm_lat_pct(&ld.lat, 0.50) * 1e-6, tpm_lat_pct(&ld.lat, 0.99) * 1e-6, ld.peak, ld.failed);
+    tpm_lat_free(&ld.lat);
+}
+
+int main(int argc, char **argv) {
+    int per_slot = argc > 1 ? atoi(argv[1]) : 2;
+    int concs[] = { 1000, 10000 };
+    size_t nconc = 2;
+    static const struct { const char *name; uint16_t flags; } modes[] = {
+        { "lockstep",      0 },
+        { "duplex+seeded", TPM_F_DUPLEX | TPM_F_SEEDED },
+    };
+    struct rlimit rl;
+
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    int uring_from = 0, uring_to = 1;
+    if (argc > 4) uring_from = uring_to = strcmp(argv[4], "uring") == 0;
+    if (argc > 2) {
+        concs[0] = atoi(argv[2]);
+        nconc = 1;
+    }
+
+    // 클라이언트 쪽 fd 만 C 개가 필요하다 (서버 fd 는 자식 프로세스 몫)
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    getrlimit(RLIMIT_NOFILE, &rl);
+    nslots = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (1u << 20) ? (1 << 20) : (int)rl.rlim_cur;
+    slots = calloc((size_t)nslots, sizeof(*slots));
+    if (slots == NULL) ErrorHandling("calloc");
+
+    signal(SIGPIPE, SIG_IGN);
+    tpm_hello_info params = { RULE_RANDOM_WALK, { 3, 4, 3 }, 0, 0, 0, 0 };
+    printf("K=%d N=%d L=%d rule=%s, loopback, server in a separate process, %ld CPU(s), %d server worker(s)\n",
+           params.shape.K, params.shape.N, params.shape.L, tpm_rule_get(params.rule)->name,
+           sysconf(_SC_NPROCESSORS_ONLN), threads > 0 ? threads : (int)sysconf(_SC_NPROCESSORS_ONLN));
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        params.flags = modes[m].flags;
+        for (size_t c = 0; c < nconc; c++)
+            for (int u = uring_from; u <= uring_to; u++)
+                run_case(&params, modes[m].name, u, concs[c], (unsigned long)concs[c] * per_slot, threads);
+    }
+    free(slots);
+    return 0;
+}
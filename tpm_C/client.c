@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "tpm.h"
+
+int main(int argc, char **argv) {
+    int sock;
+    struct sockaddr_in servAddr;
+    char server_ip[64];
+    int server_port;
+    char message[BUFSIZE];
+    int nRcv;
+
+    tpm_sync_opts sync_opts = { 0, 0, 1, 0, 0, 0, { 0, 0, 0 } };
+
+    tpm_session *sess;
+    TPM *tpm_B;
+    tpm_conn *conn;
+    const tpm_hello_info *info;
+
+    // --packed: 가중치를 비트 평면으로 들고 popcount 커널로 계산한다
+    if (argc > 1 && strcmp(argv[1], "--packed") == 0) {
+        sync_opts.packed = 1;
+        argc--;
+        argv++;
+    }
+
+    if (argc == 3) {
+        snprintf(server_ip, sizeof(server_ip), "%s", argv[1]);
+        server_port = atoi(argv[2]);
+    } else {
+        printf("Server Address: ");
+        if (scanf("%63s", server_ip) != 1) return 1;
+        printf("Port Number: ");
+        if (scanf("%d", &server_port) != 1) return 1;
+        getchar();
+    }
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) ErrorHandling("socket");
+
+    memset(&servAddr, 0, sizeof(servAddr));
+    servAddr.sin_family = AF_INET;
+    servAddr.sin_port = htons(server_port);
+
+    if (inet_pton(AF_INET, server_ip, &servAddr.sin_addr) <= 0)
+        ErrorHandling("inet_pton");
+
+    if (connect(sock, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0)
+        ErrorHandling("connect");
+
+    printf("Connected to %s:%d\n", server_ip, server_port);
+
+    sess = tpm_session_client(sock, &sync_opts);
+    if (sess == NULL) ErrorHandling("tpm_session_client");
+    conn = tpm_session_conn(sess);
+
+    // 서버가 정한 학습 규칙과 K/N/L 을 받아 같은 구조·갱신 커널을 사용한다 (HELLO)
+    while (tpm_session_state(sess) == TPM_SESS_HANDSHAKE) tpm_session_step(sess);
+    tpm_B = tpm_session_tpm(sess);
+    if (tpm_B == NULL) {
+        fprintf(stderr, "Handshake failed\n");
+        return 1;
+    }
+    info = tpm_session_info(sess);
+
+    printf("[Client] Initialization complete (rule: %s, K=%d N=%d L=%d, kernel: %s/%s)\n",
+           tpm_B->ops->name, info->shape.K, info->shape.N, info->shape.L, tpm_B->kern->name,
+           sync_opts.packed ? "packed" : tpm_B->simd->name);
+    print_weights(tpm_B, "Client Initial");
+
+    printf("\n Key Synchronization Start (%s)\n", (info->flags & TPM_F_DUPLEX) ? "duplex" : "lockstep");
+    if (tpm_session_run(sess) == TPM_SESS_DONE) {
+        uint8_t key[TPM_KEY_SIZE];
+        printf("\nSynchronization Achieved! (Iter: %d) \n", tpm_session_result(sess)->iterations);
+        if (tpm_session_key(sess, key) == 0)
+            printf("Session key: %02x%02x%02x%02x%02x%02x%02x%02x...\n", key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7]);
+    } else {
+        // 서버가 --max-rounds, --max-repulsive 로 끊었거나 연결이 끊겼다
+        printf("\nSynchronization failed (Iter: %d)\n", tpm_session_result(sess)->iterations);
+        tpm_session_free(sess);
+        close(sock);
+        return 1;
+    }
+
+    print_weights(tpm_B, "Client Synced");
+
+    printf("\nChat Started\n");
+
+    while (1) {
+        printf("message: ");
+        if (fgets(message, BUFSIZE, stdin) == NULL) break;
+        message[strcspn(message, "\n")] = '\0';
+
+        if (send(sock, message, (int)strlen(message), 0) < 0) {
+            perror("send");
+            break;
+        }
+        if (strcmp(message, "exit") == 0) break;
+
+        nRcv = (int)tpm_conn_read(conn, message, BUFSIZE - 1);
+        if (nRcv <= 0) {
+            printf("Server closed connection.\n");
+            break;
+        }
+        message[nRcv] = '\0';
+
+        if (strcmp(message, "exit") == 0) {
+            printf("Server requested exit.\n");
+            break;
+        }
+        printf("Received: %s\n", message);
+    }
+
+    close(sock);
+    tpm_session_free(sess);
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <sys/epoll.h>
+#include "tpm.h"
+
+/*
+ * 논블로킹 키 교환 클라이언트. 호출한 쪽의 이벤트 루프 안에서 여러 교환을 한 스레드로 돌린다.
+ *
+ *   tpm_aclient_start : 논블로킹 connect 를 걸고 클라이언트 세션을 만든다. 바로 돌아온다.
+ *   tpm_aclient_poll  : 준비된 연결만 한 단계씩 진행한다. 끝난 교환은 콜백으로 알린다.
+ *   tpm_aclient_fd    : 내부 epoll fd. 호출한 쪽의 epoll/poll 에 넣어 두고, 읽을 수 있을 때
+ *                       tpm_aclient_poll(ac, 0) 을 부르면 된다.
+ *
+ * 콜백은 tpm_aclient_poll 안에서, 연결을 닫고 정리한 뒤에 부른다. 그래서 콜백에서
+ * 새 교환을 시작해도 된다. err 는 0 이면 성공이고 key 에 세션 키가 들어 있다.
+ * 실패면 errno 값(connect 실패 이유, 프로토콜 실패는 EPROTO, 취소는 ECANCELED)이고 key 는 NULL 이다.
+ */
+
+#define AC_BATCH 64
+
+typedef struct ac_op {
+    struct ac_op *prev, *next;
+    int fd;
+    int connected;
+    tpm_session *sess;
+    tpm_key_cb cb;
+    void *arg;
+} ac_op;
+
+struct tpm_aclient {
+    int epfd;
+    ac_op *ops;             // 진행 중인 교환 (취소할 때 훑는다)
+    unsigned long pending;
+    unsigned long completed;
+};
+
+tpm_aclient *tpm_aclient_new(void) {
+    tpm_aclient *ac = calloc(1, sizeof(*ac));
+    if (ac == NULL) return NULL;
+    ac->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (ac->epfd < 0) {
+        free(ac);
+        return NULL;
+    }
+    return ac;
+}
+
+int tpm_aclient_fd(const tpm_aclient *ac) {
+    return ac->epfd;
+}
+
+unsigned long tpm_aclient_pending(const tpm_aclient *ac) {
+    return ac->pending;
+}
+
+/* 연결을 정리한 뒤 콜백을 부른다. 이 뒤로 op 는 없다. */
+static void complete(tpm_aclient *ac, ac_op *op, int err) {
+    uint8_t key[TPM_KEY_SIZE];
+    tpm_sync_result res;
+    tpm_key_cb cb = op->cb;
+    void *arg = op->arg;
+
+    if (err == 0 && tpm_session_key(op->sess, key) < 0) err = EPROTO;
+    res = *tpm_session_result(op->sess);
+
+    epoll_ctl(ac->epfd, EPOLL_CTL_DEL, op->fd, NULL);
+    close(op->fd);
+    tpm_session_free(op->sess);
+    if (op->prev != NULL) op->prev->next = op->next;
+    else ac->ops = op->next;
+    if (op->next != NULL) op->next->prev = op->prev;
+    ac->pending--;
+    ac->completed++;
+    free(op);
+
+    cb(arg, err, err == 0 ? key : NULL, &res);
+}
+
+/*
+ * peer 와 키 교환을 시작한다. 연결 결과를 기다리지 않는다.
+ * 교환을 시작하지 못하면 -1 (콜백은 불리지 않는다), 시작했으면 0 이고 콜백이 꼭 한 번 불린다.
+ */
+int tpm_aclient_start(tpm_aclient *ac, const struct sockaddr_in *peer, const tpm_sync_opts *opts,
+                      tpm_key_cb cb, void *arg) {
+    ac_op *op = calloc(1, sizeof(*op));
+    if (op == NULL) return -1;
+
+    op->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (op->fd < 0) {
+        free(op);
+        return -1;
+    }
+    if (connect(op->fd, (const struct sockaddr *)peer, sizeof(*peer)) == 0) op->connected = 1;
+    else if (errno != EINPROGRESS) goto fail;
+
+    // 클라이언트는 HELLO 를 받기 전엔 보낼 것이 없으므로 연결이 끝나기 전에 세션을 만들어도 된다
+    op->sess = tpm_session_client(op->fd, opts);
+    if (op->sess == NULL) goto fail;
+    op->cb = cb;
+    op->arg = arg;
+
+    struct epoll_event e = { .events = EPOLLIN | (op->connected ? 0 : EPOLLOUT), .data.ptr = op };
+    if (epoll_ctl(ac->epfd, EPOLL_CTL_ADD, op->fd, &e) < 0) goto fail;
+
+    op->next = ac->ops;
+    if (ac->ops != NULL) ac->ops->prev = op;
+    ac->ops = op;
+    ac->pending++;
+    return 0;
+
+fail:;
+    int saved = errno;
+    tpm_session_free(op->sess);
+    close(op->fd);
+    free(op);
+    errno = saved;
+    return -1;
+}
+
+static void on_event(tpm_aclient *ac, ac_op *op, uint32_t events) {
+    if (!op->connected) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(op->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) err = errno;
+        if (err != 0) {
+            complete(ac, op, err);
+            return;
+        }
+        if (!(events & (EPOLLOUT | EPOLLIN))) return;
+        op->connected = 1;
+    }
+
+    if ((events & EPOLLOUT) && tpm_session_flush(op->sess) < 0) tpm_session_on_eof(op->sess);
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) tpm_session_on_readable(op->sess);
+
+    tpm_sess_state state = tpm_session_state(op->sess);
+    if (state >= TPM_SESS_DONE) {
+        complete(ac, op, state == TPM_SESS_DONE ? 0 : EPROTO);
+        return;
+    }
+    struct epoll_event e = { .events = EPOLLIN | (tpm_session_want_write(op->sess) ? EPOLLOUT : 0), .data.ptr = op };
+    epoll_ctl(ac->epfd, EPOLL_CTL_MOD, op->fd, &e);
+}
+
+/*
+ * 준비된 교환을 진행한다. 이벤트를 timeout_ms 까지 기다린다 (0 이면 기다리지 않고, -1 이면 하나 올 때까지).
+ * 끝난 교환 수를 돌려준다. 실패면 -1.
+ */
+int tpm_aclient_poll(tpm_aclient *ac, int timeout_ms) {
+    struct epoll_event events[AC_BATCH];
+    unsigned long before = ac->completed;
+
+    int n = epoll_wait(ac->epfd, events, AC_BATCH, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    for (int i = 0; i < n; i++) on_event(ac, events[i].data.ptr, events[i].events);
+    return (int)(ac->completed - before);
+}
+
+/* 남은 교환을 ECANCELED 로 끝내고 정리한다. 이때 불리는 콜백에서는 새 교환을 시작하면 안 된다. */
+void tpm_aclient_free(tpm_aclient *ac) {
+    if (ac == NULL) return;
+    while (ac->ops != NULL) complete(ac, ac->ops, ECANCELED);
+    close(ac->epfd);
+    free(ac);
+}
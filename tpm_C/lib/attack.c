@@ -0,0 +1,241 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "tpm.h"
+
+/*
+ * 기하 공격 (geometric attack) 시뮬레이터. 도청자 E 는 같은 구조의 TPM 하나로, 라운드마다 공개된
+ * 입력 x, theta 와 A, B 의 tau 를 본다 (세션에서 x, theta 는 선로에 실리거나 공개 seed 로 만든다).
+ *   - tauA != tauB: A, B 가 갱신하지 않으므로 E 도 가만히 있다.
+ *   - tauE == tauA: A 와 같은 규칙으로 갱신 (update_weights).
+ *   - tauE != tauA: |h| 가 가장 작은 hidden unit 의 sigma 를 뒤집어 tauE 를 tauA 로 맞추고 갱신.
+ * E 가 A 와 같아지면 그 뒤로는 늘 같이 움직이므로 따라잡은 것이다.
+ *
+ * A-B 쪽 난수는 sim.c 의 시행과 똑같이 쓰고 (같은 seed 면 A-B 동기화 라운드가 tpmsim 과 같다),
+ * 공격자의 초기 가중치는 따로 심은 난수에서 뽑는다. 시행 결과는 seed 와 시행 번호로만 정해진다.
+ * A-B 가 동기화된 뒤에도 chase 배 라운드까지 A 를 계속 돌리며 공격자가 얼마나 늦게 따라잡는지 본다.
+ * cfg->soa 나 cfg->majority 면 공격자를 TPM 하나씩이 아니라 묶음 엔진 (majority.c) 으로 돌린다.
+ * cfg->genetic 이면 개체 수 상한이 attackers 인 유전 공격 (genetic.c) 을 한다. 개체 칸은 스레드마다
+ * 한 번 잡아 시행 사이에 재사용한다.
+ * cfg->sim.H_max 가 있으면 A 가 H 조절기 (qctl.c) 로 H 를 정한다. A-B 가 동기화된 뒤에는 마지막 H 로 둔다.
+ */
+
+#define ATTACK_CHUNK 16
+#define ATTACK_SALT 0x6a09e667f3bcc908ULL   // 공격자 초기 가중치 난수를 A-B 와 가른다
+
+typedef struct {
+    const tpm_attack_cfg *cfg;
+    uint64_t seed, first, n;
+    atomic_ulong next;
+    atomic_int err;
+} attack_job;
+
+typedef struct {
+    attack_job *job;
+    pthread_t th;
+    tpm_attack_stats st;
+} attack_thread;
+
+typedef struct {
+    TPM a, b, *e;
+    int ne;
+    tpm_majority *mj;       // 묶음 엔진이면 e 대신
+    tpm_genetic *gen;       // 유전 공격이면 e 대신
+    int8_t *x, *theta;
+} attack_ctx;
+
+static void ctx_free(attack_ctx *p) {
+    free_tpm(&p->a);
+    free_tpm(&p->b);
+    for (int i = 0; i < p->ne; i++) free_tpm(&p->e[i]);
+    free(p->e);
+    tpm_majority_free(p->mj);
+    tpm_genetic_free(p->gen);
+    free(p->x);
+    free(p->theta);
+}
+
+static int ctx_init(attack_ctx *p, const tpm_attack_cfg *cfg) {
+    const tpm_sim_cfg *sim = &cfg->sim;
+    memset(p, 0, sizeof(*p));
+    p->e = calloc((size_t)cfg->attackers, sizeof(*p->e));
+    p->x = tpm_alloc_vec(&sim->shape);
+    p->theta = tpm_alloc_vec(&sim->shape);
+    if (p->e == NULL || p->x == NULL || p->theta == NULL) goto fail;
+    if (init_tpm(&p->a, &sim->shape, sim->rule) < 0 || init_tpm(&p->b, &sim->shape, sim->rule) < 0) goto fail;
+    if (cfg->genetic) {
+        p->gen = tpm_genetic_new(&sim->shape, sim->rule, cfg->attackers);
+        if (p->gen == NULL) goto fail;
+        return 0;
+    }
+    if (cfg->soa || cfg->majority) {
+        p->mj = tpm_majority_new(&sim->shape, sim->rule, cfg->attackers, cfg->majority);
+        if (p->mj == NULL) goto fail;
+        return 0;
+    }
+    for (; p->ne < cfg->attackers; p->ne++)
+        if (init_tpm(&p->e[p->ne], &sim->shape, sim->rule) < 0) goto fail;
+    return 0;
+fail:
+    ctx_free(p);
+    return -1;
+}
+
+/* 공격자 한 라운드. tau 는 A 의 tau (A, B 가 갱신하는 라운드에만 부른다). */
+static void geometric_step(TPM *e, const int8_t *x, const int8_t *theta, int tau) {
+    calculate_tau(e, x);
+    if (e->tau != tau) {
+        const int N = e->shape.N;
+        int best = 0, best_h = INT_MAX;
+        for (int k = 0; k < e->shape.K; k++) {
+            int h = abs(e->simd->dot(e->weights + (size_t)k * N, x + (size_t)k * N, N));
+            if (h < best_h) {
+                best_h = h;
+                best = k;
+            }
+        }
+        e->sigma[best] = -e->sigma[best];
+        e->tau = tau;
+    }
+    update_weights(e, theta);
+}
+
+static int run_trial(attack_ctx *p, const tpm_attack_cfg *cfg, uint64_t seed, uint64_t trial, tpm_attack_stats *st) {
+    const tpm_sim_cfg *sim = &cfg->sim;
+    const size_t len = tpm_vec_len(&sim->shape);
+    const uint32_t max_rounds = sim->max_rounds > 0 ? sim->max_rounds : TPM_SIM_MAX_ROUNDS;
+    const uint64_t chase = cfg->chase > 1 ? cfg->chase : 1;
+    uint64_t limit = max_rounds, synced = 0, caught = 0;
+    tpm_qctl qc;
+    int H = sim->H;
+
+    tpm_rand_seed(tpm_ctr64(seed, trial));
+    tpm_randomize_weights(&p->a);
+    tpm_randomize_weights(&p->b);
+    uint64_t saved = tpm_rand_state();
+    tpm_rand_seed(tpm_ctr64(seed ^ ATTACK_SALT, trial));
+    if (p->mj != NULL) tpm_majority_randomize(p->mj);
+    if (p->gen != NULL) tpm_genetic_reset(p->gen);
+    for (int i = 0; i < p->ne; i++) tpm_randomize_weights(&p->e[i]);
+    tpm_rand_seed(saved);
+    if (sim->H_max > 0) {
+        tpm_qctl_init(&qc, &sim->shape, sim->H, sim->H_max);
+        H = qc.H;
+    }
+
+    for (uint64_t r = 1; r <= limit; r++) {
+        make_inputs(&p->a, p->x, H);
+        generate_inputs(&sim->shape, p->theta);
+        calculate_tau(&p->a, p->x);
+        if (!synced) {
+            calculate_tau(&p->b, p->x);
+            if (sim->H_max > 0) H = tpm_qctl_observe(&qc, &p->a, p->a.tau == p->b.tau);
+            if (p->a.tau != p->b.tau) continue;
+        }
+        if (!caught) {
+            if (p->mj != NULL) tpm_majority_round(p->mj, p->x, p->theta, p->a.tau);
+            if (p->gen != NULL) tpm_genetic_round(p->gen, p->x, p->theta, p->a.tau);
+            for (int i = 0; i < p->ne; i++) geometric_step(&p->e[i], p->x, p->theta, p->a.tau);
+        }
+        update_weights(&p->a, p->theta);
+        if (!synced) update_weights(&p->b, p->theta);
+
+        if (!caught && p->mj != NULL && tpm_majority_match(p->mj, p->a.weights) >= 0) caught = r;
+        if (!caught && p->gen != NULL && tpm_genetic_match(p->gen, p->a.weights) >= 0) caught = r;
+        for (int i = 0; i < p->ne && !caught; i++)
+            if (memcmp(p->e[i].weights, p->a.weights, len) == 0) caught = r;
+        if (!synced && memcmp(p->a.weights, p->b.weights, len) == 0) {
+            synced = r;
+            limit = r * chase;
+        }
+        if (synced && caught) break;
+    }
+
+    st->trials++;
+    if (!synced) return 0;
+    st->synced++;
+    if (tpm_stats_add(&st->rounds, synced) < 0) return -1;
+    if (!caught) return 0;
+    st->caught++;
+    st->broken += caught <= synced;
+    if (tpm_stats_add(&st->attack, caught) < 0) return -1;
+    return tpm_stats_add(&st->ratio, caught * 1000 / synced);
+}
+
+static void *attack_worker(void *arg) {
+    attack_thread *me = arg;
+    attack_job *job = me->job;
+    attack_ctx p;
+
+    if (ctx_init(&p, job->cfg) < 0) {
+        atomic_store(&job->err, 1);
+        return NULL;
+    }
+    for (;;) {
+        uint64_t i = atomic_fetch_add(&job->next, ATTACK_CHUNK);
+        if (i >= job->n || atomic_load(&job->err)) break;
+        uint64_t end = i + ATTACK_CHUNK < job->n ? i + ATTACK_CHUNK : job->n;
+        for (; i < end; i++) {
+            if (run_trial(&p, job->cfg, job->seed, job->first + i, &me->st) < 0) {
+                atomic_store(&job->err, 1);
+                break;
+            }
+        }
+    }
+    ctx_free(&p);
+    return NULL;
+}
+
+/*
+ * 시행 first .. first+n-1 을 threads 개 스레드로 돌려 st 에 더한다 (threads <= 0 이면 온라인 CPU 수).
+ * 스레드마다 따로 쌓아 끝에 합치므로 결과는 스레드 수와 상관없다.
+ */
+int tpm_attack_run(const tpm_attack_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads,
+                   tpm_attack_stats *st) {
+    attack_job job = { .cfg = cfg, .seed = seed, .first = first, .n = n };
+    attack_thread *th;
+    int started = 0;
+
+    if (!tpm_shape_valid(&cfg->sim.shape) || cfg->attackers < 1) return -1;
+    tpm_qctl qc;
+    if (cfg->sim.H_max > 0 && tpm_qctl_init(&qc, &cfg->sim.shape, cfg->sim.H, cfg->sim.H_max) < 0) return -1;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if ((uint64_t)threads > (n + ATTACK_CHUNK - 1) / ATTACK_CHUNK) threads = (int)((n + ATTACK_CHUNK - 1) / ATTACK_CHUNK);
+    if (threads < 1) return 0;
+
+    th = calloc((size_t)threads, sizeof(*th));
+    if (th == NULL) return -1;
+    for (int t = 0; t < threads; t++) {
+        th[t].job = &job;
+        if (pthread_create(&th[t].th, NULL, attack_worker, &th[t]) != 0) {
+            atomic_store(&job.err, 1);
+            break;
+        }
+        started++;
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(th[t].th, NULL);
+        if (tpm_attack_stats_merge(st, &th[t].st) < 0) atomic_store(&job.err, 1);
+        tpm_attack_stats_free(&th[t].st);
+    }
+    free(th);
+    return atomic_load(&job.err) ? -1 : 0;
+}
+
+int tpm_attack_stats_merge(tpm_attack_stats *dst, const tpm_attack_stats *src) {
+    dst->trials += src->trials;
+    dst->synced += src->synced;
+    dst->broken += src->broken;
+    dst->caught += src->caught;
+    if (tpm_stats_merge(&dst->rounds, &src->rounds) < 0) return -1;
+    if (tpm_stats_merge(&dst->attack, &src->attack) < 0) return -1;
+    return tpm_stats_merge(&dst->ratio, &src->ratio);
+}
+
+void tpm_attack_stats_free(tpm_attack_stats *st) {
+    tpm_stats_free(&st->rounds);
+    tpm_stats_free(&st->attack);
+    tpm_stats_free(&st->ratio);
+    memset(st, 0, sizeof(*st));
+}
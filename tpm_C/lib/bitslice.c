@@ -0,0 +1,364 @@
+#include "tpm.h"
+
+/*
+ * 비트 슬라이스 시뮬레이터. 독립된 TPM 쌍 64 개(AVX2 면 256 개)를 워드의 비트 lane 에 하나씩 싣는다.
+ * 가중치 w 는 u = w + L (0..2L) 의 비트 평면으로 들고, 국소장·부호·패리티·clamp 를 모두 논리 연산으로 한다.
+ * 한 번의 논리 연산이 모든 lane 을 한 걸음씩 진행시킨다.
+ *
+ *   x·w + L      : x 가 +1 이면 u, -1 이면 2L - u       (상수 뺄셈, 빌림 전파)
+ *   sigma = +1   : Σ (x·w + L) >= N·L                 (비트 슬라이스 덧셈 후 상수 비교)
+ *   tau          : 음수 sigma 개수의 패리티
+ *   갱신          : sigma == tau 인 행에서 u ± 1, 0 과 2L 에서 멈춘다 (clamp)
+ *
+ * 시행별 결과는 sim.c 의 스칼라 루프와 같다. lane 마다 스칼라와 같은 난수 수열을 따로 들고
+ * (시행 i 는 tpm_ctr64(seed, i) 로 시작), 가중치 초기화와 query 입력은 스칼라 함수를 그대로 부른다.
+ * 동기화되거나 max_rounds 에 닿은 lane 은 그 자리에서 다음 시행으로 채운다.
+ */
+
+#define BS_MAX_W 4          // 256 lanes
+#define BS_REP_BITS 32      // 반발 라운드 카운터 비트 수
+#define BS_MAX_S 24         // 국소장 누산기 비트 수 상한 (2·L·N < 2^24)
+
+typedef struct {
+    const tpm_sim_cfg *cfg;
+    uint64_t seed, first;
+    tpm_sim_take_fn take;
+    tpm_sim_put_fn put;
+    void *ctx;
+
+    int K, N, L, B, S, W, lanes;
+    size_t E;               // K·N
+    int words;              // 입력 벡터 하나를 만드는 난수 수 (generate_inputs 와 같다)
+    uint64_t *wa, *wb;      // [E][B][W] 가중치 비트 평면 (A, B)
+    uint64_t *x, *th;       // [E][W] 입력, theta (1 이면 +1)
+    uint64_t *rep;          // [BS_REP_BITS][W] lane 별 반발 라운드 수
+    uint64_t active[BS_MAX_W];
+    uint64_t *rng;          // [lanes] lane 별 난수 상태
+    uint64_t *trial;        // [lanes] 돌리고 있는 시행 번호 (first 기준)
+    uint32_t *start;        // [lanes] 시작한 전역 라운드
+    uint32_t max_rounds;
+    uint32_t round;         // 전역 라운드
+    uint32_t deadline;      // 활성 lane 중 가장 이른 start + max_rounds
+    TPM sa, sb;             // 초기화와 query 입력용 스칼라 TPM
+    int8_t *xq;
+} bs_engine;
+
+static inline uint64_t *plane(uint64_t *p, const bs_engine *e, size_t el, int b) {
+    return p + ((el * (size_t)e->B) + (size_t)b) * (size_t)e->W;
+}
+
+static inline void lane_set(uint64_t *w, int lane, int bit) {
+    uint64_t m = 1ULL << (lane & 63);
+    if (bit) w[lane >> 6] |= m;
+    else w[lane >> 6] &= ~m;
+}
+
+static inline int lane_get(const uint64_t *w, int lane) {
+    return (int)(w[lane >> 6] >> (lane & 63)) & 1;
+}
+
+/* ---- lane 단위 (스칼라) ---- */
+
+static void scatter_weights(bs_engine *e, uint64_t *planes, const int8_t *w, int lane) {
+    for (size_t el = 0; el < e->E; el++) {
+        int u = w[el] + e->L;
+        for (int b = 0; b < e->B; b++) lane_set(plane(planes, e, el, b), lane, (u >> b) & 1);
+    }
+}
+
+static void gather_weights(const bs_engine *e, uint64_t *planes, int8_t *w, int lane) {
+    for (size_t el = 0; el < e->E; el++) {
+        int u = 0;
+        for (int b = 0; b < e->B; b++) u |= lane_get(plane(planes, e, el, b), lane) << b;
+        w[el] = (int8_t)(u - e->L);
+    }
+}
+
+/* generate_inputs 와 같은 순서로 난수를 써서 lane 의 비트를 켠다 (평면은 미리 0) */
+static void scatter_random(bs_engine *e, uint64_t *planes, int lane) {
+    const uint64_t bit = 1ULL << (lane & 63);
+    const int word = lane >> 6;
+    for (int j = 0; j < e->words; j++) {
+        uint64_t r = tpm_rand_step(&e->rng[lane]);
+        size_t base = (size_t)j * 64;
+        if (e->E - base < 64) r &= (1ULL << (e->E - base)) - 1;
+        while (r != 0) {
+            int i = __builtin_ctzll(r);
+            planes[(base + (size_t)i) * (size_t)e->W + word] |= bit;
+            r &= r - 1;
+        }
+    }
+}
+
+static void query_inputs(bs_engine *e, int lane) {
+    gather_weights(e, e->wa, e->sa.weights, lane);
+    tpm_rand_seed(e->rng[lane]);
+    generate_query_inputs(&e->sa, e->xq, e->cfg->H);
+    e->rng[lane] = tpm_rand_state();
+    const uint64_t bit = 1ULL << (lane & 63);
+    for (size_t el = 0; el < e->E; el++)
+        if (e->xq[el] > 0) e->x[el * (size_t)e->W + (lane >> 6)] |= bit;
+}
+
+/* lane 을 다음 시행으로 채운다. 남은 시행이 없으면 비활성으로 둔다. */
+static void refill(bs_engine *e, int lane) {
+    uint64_t i;
+    if (!e->take(e->ctx, &i)) {
+        e->active[lane >> 6] &= ~(1ULL << (lane & 63));
+        return;
+    }
+    tpm_rand_seed(tpm_ctr64(e->seed, e->first + i));
+    tpm_randomize_weights(&e->sa);
+    tpm_randomize_weights(&e->sb);
+    e->rng[lane] = tpm_rand_state();
+    scatter_weights(e, e->wa, e->sa.weights, lane);
+    scatter_weights(e, e->wb, e->sb.weights, lane);
+    for (int b = 0; b < BS_REP_BITS; b++) lane_set(e->rep + (size_t)b * e->W, lane, 0);
+    e->trial[lane] = i;
+    e->start[lane] = e->round;
+    e->active[lane >> 6] |= 1ULL << (lane & 63);
+}
+
+static void finish(bs_engine *e, int lane, int synced) {
+    tpm_sim_trial t = { 0 };
+    for (int b = 0; b < BS_REP_BITS; b++) t.repulsive |= (uint32_t)lane_get(e->rep + (size_t)b * e->W, lane) << b;
+    t.rounds = e->round - e->start[lane];
+    t.synced = (uint8_t)synced;
+    e->put(e->ctx, e->trial[lane], &t);
+    refill(e, lane);
+}
+
+static void update_deadline(bs_engine *e) {
+    e->deadline = UINT32_MAX;
+    for (int l = 0; l < e->lanes; l++)
+        if (lane_get(e->active, l) && e->start[l] + e->max_rounds < e->deadline) e->deadline = e->start[l] + e->max_rounds;
+}
+
+/* ---- 모든 lane (W 는 상수로 인라인된다) ---- */
+
+/* 가중치 평면 p 의 sigma[K][W] 와 tau[W] (비트 1 이 +1) */
+static inline __attribute__((always_inline))
+void bs_tau(const bs_engine *e, uint64_t *p, uint64_t *sigma, uint64_t *tau, const int W) {
+    const int B = e->B, S = e->S, N = e->N;
+    const uint32_t c = 2u * (uint32_t)e->L, T = (uint32_t)N * (uint32_t)e->L;
+    uint64_t par[BS_MAX_W] = { 0 };
+
+    for (int k = 0; k < e->K; k++) {
+        uint64_t acc[BS_MAX_S][BS_MAX_W];
+        for (int s = 0; s < S; s++)
+            for (int i = 0; i < W; i++) acc[s][i] = 0;
+
+        for (int n = 0; n < N; n++) {
+            const size_t el = (size_t)k * N + n;
+            const uint64_t *xw = e->x + el * W;
+            const uint64_t *u = p + el * B * W;
+            uint64_t br[BS_MAX_W] = { 0 }, cy[BS_MAX_W] = { 0 };
+            for (int s = 0; s < S; s++) {
+                for (int i = 0; i < W; i++) {
+                    uint64_t v = 0;
+                    if (s < B) {
+                        // d = 2L - u (상수 뺄셈), v = x ? u : d
+                        const uint64_t ub = u[s * W + i];
+                        const uint64_t cb = (c >> s) & 1 ? ~0ULL : 0;
+                        const uint64_t d = cb ^ ub ^ br[i];
+                        br[i] = cb ? (ub & br[i]) : (ub | br[i]);
+                        v = (xw[i] & ub) | (~xw[i] & d);
+                    }
+                    const uint64_t a = acc[s][i];
+                    acc[s][i] = a ^ v ^ cy[i];
+                    cy[i] = (a & v) | (cy[i] & (a ^ v));
+                }
+            }
+        }
+        // acc >= T 이면 sigma = +1 (acc - T 에서 빌림이 없으면)
+        uint64_t bo[BS_MAX_W] = { 0 };
+        for (int s = 0; s < S; s++)
+            for (int i = 0; i < W; i++)
+                bo[i] = (T >> s) & 1 ? (~acc[s][i] | bo[i]) : (~acc[s][i] & bo[i]);
+        for (int i = 0; i < W; i++) {
+            sigma[k * W + i] = ~bo[i];
+            par[i] ^= bo[i];
+        }
+    }
+    for (int i = 0; i < W; i++) tau[i] = ~par[i];
+}
+
+/* mask 인 lane 에서 sigma == tau 인 행을 theta 로 갱신하고 [0, 2L] 로 자른다 */
+static inline __attribute__((always_inline))
+void bs_update(const bs_engine *e, uint64_t *p, const uint64_t *sigma, const uint64_t *tau,
+               const uint64_t *mask, const int W) {
+    const int B = e->B, N = e->N;
+    const uint32_t c = 2u * (uint32_t)e->L;
+    const int dir = tpm_rule_get(e->cfg->rule)->dir;
+
+    for (int k = 0; k < e->K; k++) {
+        uint64_t row[BS_MAX_W], any = 0;
+        for (int i = 0; i < W; i++) {
+            row[i] = mask[i] & ~(sigma[k * W + i] ^ tau[i]);
+            any |= row[i];
+        }
+        if (any == 0) continue;
+
+        for (int n = 0; n < N; n++) {
+            const size_t el = (size_t)k * N + n;
+            uint64_t *u = p + el * B * W;
+            const uint64_t *th = e->th + el * W;
+            for (int i = 0; i < W; i++) {
+                uint64_t at_c = ~0ULL, nz = 0;
+                for (int b = 0; b < B; b++) {
+                    at_c &= (c >> b) & 1 ? u[b * W + i] : ~u[b * W + i];
+                    nz |= u[b * W + i];
+                }
+                const uint64_t up = dir > 0 ? th[i] : ~th[i];
+                uint64_t inc = row[i] & up & ~at_c;
+                uint64_t dec = row[i] & ~up & nz;
+                for (int b = 0; b < B; b++) {
+                    const uint64_t ub = u[b * W + i];
+                    u[b * W + i] = ub ^ inc ^ dec;
+                    inc &= ub;
+                    dec &= ~ub;
+                }
+            }
+        }
+    }
+}
+
+static inline __attribute__((always_inline))
+void bs_rounds(bs_engine *e, const int W) {
+    const int query = e->cfg->rule == RULE_QUERY;
+    const size_t E = e->E;
+    const size_t WB = (size_t)e->B * W;
+
+    for (;;) {
+        uint64_t any = 0;
+        for (int i = 0; i < W; i++) any |= e->active[i];
+        if (any == 0) return;
+
+        // 입력과 theta (lane 마다 스칼라와 같은 순서: 입력 → theta)
+        memset(e->x, 0, E * W * sizeof(uint64_t));
+        memset(e->th, 0, E * W * sizeof(uint64_t));
+        for (int i = 0; i < W; i++) {
+            for (uint64_t m = e->active[i]; m != 0; m &= m - 1) {
+                int lane = i * 64 + __builtin_ctzll(m);
+                if (query) query_inputs(e, lane);
+                else scatter_random(e, e->x, lane);
+                scatter_random(e, e->th, lane);
+            }
+        }
+
+        uint64_t sa[64 * BS_MAX_W], sb[64 * BS_MAX_W], ta[BS_MAX_W], tb[BS_MAX_W], eq[BS_MAX_W], diff[BS_MAX_W];
+        bs_tau(e, e->wa, sa, ta, W);
+        bs_tau(e, e->wb, sb, tb, W);
+        for (int i = 0; i < W; i++) eq[i] = ~(ta[i] ^ tb[i]) & e->active[i];
+
+        // 반발 라운드 카운터 += 1 (tau 가 다른 활성 lane)
+        for (int i = 0; i < W; i++) {
+            uint64_t cy = ~eq[i] & e->active[i];
+            for (int b = 0; b < BS_REP_BITS && cy != 0; b++) {
+                uint64_t *r = e->rep + (size_t)b * W + i;
+                uint64_t t = *r & cy;
+                *r ^= cy;
+                cy = t;
+            }
+        }
+
+        bs_update(e, e->wa, sa, ta, eq, W);
+        bs_update(e, e->wb, sb, tb, eq, W);
+        e->round++;
+
+        for (int i = 0; i < W; i++) diff[i] = 0;
+        for (size_t j = 0; j < E * WB / W; j++)
+            for (int i = 0; i < W; i++) diff[i] |= e->wa[j * W + i] ^ e->wb[j * W + i];
+
+        int refilled = 0;
+        for (int i = 0; i < W; i++) {
+            for (uint64_t m = eq[i] & ~diff[i]; m != 0; m &= m - 1) {
+                finish(e, i * 64 + __builtin_ctzll(m), 1);
+                refilled = 1;
+            }
+        }
+        if (e->round >= e->deadline) {
+            for (int l = 0; l < e->lanes; l++)
+                if (lane_get(e->active, l) && e->round - e->start[l] >= e->max_rounds) finish(e, l, 0);
+            refilled = 1;
+        }
+        if (refilled) update_deadline(e);
+    }
+}
+
+static void bs_rounds_w1(bs_engine *e) {
+    bs_rounds(e, 1);
+}
+
+__attribute__((target("avx2")))
+static void bs_rounds_w4(bs_engine *e) {
+    bs_rounds(e, 4);
+}
+
+/* 이 CPU 에서 쓰는 lane 수. TPM_BITSLICE=64 로 64 lane 을 강제할 수 있다. */
+int tpm_bitslice_lanes(void) {
+    const char *env = getenv("TPM_BITSLICE");
+    if (env != NULL && strcmp(env, "64") == 0) return 64;
+    return __builtin_cpu_supports("avx2") ? 256 : 64;
+}
+
+static void engine_free(bs_engine *e) {
+    free_tpm(&e->sa);
+    free_tpm(&e->sb);
+    free(e->xq);
+    free(e->wa);
+    free(e->wb);
+    free(e->x);
+    free(e->th);
+    free(e->rep);
+    free(e->rng);
+    free(e->trial);
+    free(e->start);
+}
+
+/*
+ * take 가 내주는 시행 i 를 모두 돌려 결과를 put 으로 넘긴다 (시행 번호는 first + i).
+ * 스레드 하나가 부른다. 여러 스레드가 같은 take 를 나눠 쓰면 된다 (sim.c).
+ */
+int tpm_bitslice_run(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, tpm_sim_take_fn take,
+                     tpm_sim_put_fn put, void *ctx) {
+    bs_engine e = { .cfg = cfg, .seed = seed, .first = first, .take = take, .put = put, .ctx = ctx };
+    int ret = -1;
+
+    if (!tpm_shape_valid(&cfg->shape) || cfg->shape.K > 64) return -1;
+    e.K = cfg->shape.K;
+    e.N = cfg->shape.N;
+    e.L = cfg->shape.L;
+    e.E = tpm_vec_len(&cfg->shape);
+    e.words = (int)((e.E + 63) / 64);
+    for (e.B = 1; (1u << e.B) <= 2u * (uint32_t)e.L; e.B++) {}
+    for (e.S = 1; (1ull << e.S) <= 2ull * (uint64_t)e.L * (uint64_t)e.N; e.S++) {}
+    if (e.S > BS_MAX_S) return -1;
+    e.lanes = tpm_bitslice_lanes();
+    e.W = e.lanes / 64;
+    e.max_rounds = cfg->max_rounds > 0 ? cfg->max_rounds : TPM_SIM_MAX_ROUNDS;
+
+    if (init_tpm(&e.sa, &cfg->shape, cfg->rule) < 0 || init_tpm(&e.sb, &cfg->shape, cfg->rule) < 0) goto out;
+    e.xq = tpm_alloc_vec(&cfg->shape);
+    e.wa = calloc(e.E * e.B * e.W, sizeof(uint64_t));
+    e.wb = calloc(e.E * e.B * e.W, sizeof(uint64_t));
+    e.x = calloc(e.E * e.W, sizeof(uint64_t));
+    e.th = calloc(e.E * e.W, sizeof(uint64_t));
+    e.rep = calloc((size_t)BS_REP_BITS * e.W, sizeof(uint64_t));
+    e.rng = calloc((size_t)e.lanes, sizeof(uint64_t));
+    e.trial = calloc((size_t)e.lanes, sizeof(uint64_t));
+    e.start = calloc((size_t)e.lanes, sizeof(uint32_t));
+    if (e.xq == NULL || e.wa == NULL || e.wb == NULL || e.x == NULL || e.th == NULL || e.rep == NULL ||
+        e.rng == NULL || e.trial == NULL || e.start == NULL)
+        goto out;
+
+    for (int l = 0; l < e.lanes; l++) refill(&e, l);
+    update_deadline(&e);
+    if (e.W == 4) bs_rounds_w4(&e);
+    else bs_rounds_w1(&e);
+    ret = 0;
+
+out:
+    engine_free(&e);
+    return ret;
+}
@@ -0,0 +1,410 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "tpm.h"
+
+/*
+ * epoll 로 여러 키 교환을 동시에 돌리는 서버. 워커 스레드마다 SO_REUSEPORT listen 소켓,
+ * epoll, 준비된 세션 큐를 따로 둔다. 연결마다 tpm_session 하나(TPM, 라운드, 프로토콜 단계)를
+ * 두고 fd 로 찾는다.
+ *
+ * 소유 규칙
+ *   - 연결은 accept 한 워커의 epoll 에 EPOLLONESHOT 으로 등록된다 (owner).
+ *   - 이벤트가 오면 owner 가 연결을 자기 준비 큐에 넣는다. ONESHOT 이라 다시 걸기 전에는
+ *     이벤트가 또 오지 않으므로, 큐에 있거나 처리 중인 연결은 한 스레드만 만진다.
+ *   - 큐에서 꺼낸 스레드(owner 또는 훔쳐 간 워커)가 세션을 진행하고, 마지막에
+ *     owner 의 epoll 에 다시 건다. 끝났으면 대신 닫는다. 다시 걸거나 닫은 뒤에는 손대지 않는다.
+ * 할 일이 없는 워커는 큐가 가장 긴 워커의 큐 뒤쪽에서 세션 하나를 가져온다.
+ * 큰 N 세션이 몇 개 몰려 한 워커가 밀릴 때 나머지 코어가 그 계산을 나눠 맡는다.
+ */
+
+#define EV_BATCH 256
+#define EV_STEAL_MS 1       // 워커가 둘 이상일 때 빈 워커가 훔칠 거리를 다시 보는 간격
+
+typedef struct {
+    int owner;
+    uint32_t revents;
+    tpm_session *sess;
+} ev_conn;
+
+typedef struct {
+    pthread_mutex_t lock;
+    ev_conn **q;
+    size_t head, len, cap;
+} ev_queue;
+
+typedef struct ev_server ev_server;
+
+typedef struct {
+    int id, epfd, lfd;
+    pthread_t th;
+    ev_server *srv;
+    ev_queue ready;
+    pthread_mutex_t st_lock;    // lat, iters, steals (보고 스레드가 모아 간다)
+    tpm_stats lat, iters;       // 직전 보고 이후 완료한 세션
+    unsigned long steals;
+} ev_worker;
+
+struct ev_server {
+    const tpm_evserver_cfg *cfg;
+    ev_worker *w;
+    int nw;
+    ev_conn *conns;             // fd 로 찾는다
+    int nconns;
+    atomic_ulong accepted, done, failed, active, peak_active, rounds, restarts;
+    atomic_ulong syscalls;      // 루프의 epoll/accept/close + 닫은 세션의 send/recv
+    atomic_int stop;
+    uint64_t started_ns;
+    tpm_stats sync_ns, iters;   // 지난 보고들까지 모은 것 (collect 만 만진다)
+};
+
+static void count_sys(ev_server *srv, unsigned long n) {
+    atomic_fetch_add_explicit(&srv->syscalls, n, memory_order_relaxed);
+}
+
+static int set_nonblock(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl < 0 ? -1 : fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+}
+
+/* ---- 준비 큐 ---- */
+
+static int queue_push(ev_queue *q, ev_conn *c) {
+    pthread_mutex_lock(&q->lock);
+    if (q->len == q->cap) {
+        size_t cap = q->cap ? q->cap * 2 : 256;
+        ev_conn **nq = malloc(cap * sizeof(*nq));
+        if (nq == NULL) {
+            pthread_mutex_unlock(&q->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < q->len; i++) nq[i] = q->q[(q->head + i) % q->cap];
+        free(q->q);
+        q->q = nq;
+        q->cap = cap;
+        q->head = 0;
+    }
+    q->q[(q->head + q->len++) % q->cap] = c;
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+/* owner 는 앞에서, 훔치는 쪽은 뒤에서 꺼낸다 */
+static ev_conn *queue_pop(ev_queue *q, int back) {
+    ev_conn *c = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->len > 0) {
+        if (back) {
+            c = q->q[(q->head + q->len - 1) % q->cap];
+        } else {
+            c = q->q[q->head];
+            q->head = (q->head + 1) % q->cap;
+        }
+        q->len--;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return c;
+}
+
+static size_t queue_len(ev_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    size_t n = q->len;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+static ev_conn *steal(ev_worker *self) {
+    ev_server *srv = self->srv;
+    ev_worker *victim = NULL;
+    size_t best = 1;    // 하나뿐이면 owner 가 곧 처리한다
+    for (int i = 0; i < srv->nw; i++) {
+        if (i == self->id) continue;
+        size_t n = queue_len(&srv->w[i].ready);
+        if (n > best) {
+            best = n;
+            victim = &srv->w[i];
+        }
+    }
+    ev_conn *c = victim != NULL ? queue_pop(&victim->ready, 1) : NULL;
+    if (c != NULL) {
+        pthread_mutex_lock(&self->st_lock);
+        self->steals++;
+        pthread_mutex_unlock(&self->st_lock);
+    }
+    return c;
+}
+
+/* ---- 세션 ---- */
+
+static int conn_fd(const ev_server *srv, const ev_conn *c) {
+    return (int)(c - srv->conns);
+}
+
+static void count_finished(ev_server *srv) {
+    unsigned long n = atomic_load(&srv->done) + atomic_load(&srv->failed);
+    if (srv->cfg->max_sessions > 0 && n >= srv->cfg->max_sessions) atomic_store(&srv->stop, 1);
+}
+
+static void close_conn(ev_worker *w, ev_conn *c) {
+    ev_server *srv = w->srv;
+    int fd = conn_fd(srv, c);
+    tpm_session *s = c->sess;
+    const tpm_sync_result *res = tpm_session_result(s);
+
+    atomic_fetch_add(&srv->restarts, (unsigned long)res->restarts);
+    if (tpm_session_state(s) == TPM_SESS_DONE) {
+        atomic_fetch_add(&srv->rounds, (unsigned long)res->iterations);
+        pthread_mutex_lock(&w->st_lock);
+        tpm_stats_add(&w->lat, res->elapsed_ns);
+        tpm_stats_add(&w->iters, (uint64_t)res->iterations);
+        pthread_mutex_unlock(&w->st_lock);
+        atomic_fetch_add(&srv->done, 1);
+    } else {
+        atomic_fetch_add(&srv->failed, 1);
+    }
+    atomic_fetch_sub(&srv->active, 1);
+    count_sys(srv, tpm_session_conn(s)->syscalls + 2);    // + epoll_ctl(DEL), close
+    epoll_ctl(srv->w[c->owner].epfd, EPOLL_CTL_DEL, fd, NULL);
+    tpm_session_free(s);
+    c->sess = NULL;
+    close(fd);      // 이 뒤로는 같은 fd 번호가 다른 연결에 쓰일 수 있다
+    count_finished(srv);
+}
+
+/* 세션 상태에 맞춰 owner 의 epoll 에 다시 걸거나, 끝났으면 닫는다 */
+static void settle(ev_worker *w, ev_conn *c) {
+    tpm_session *s = c->sess;
+    int want_write = tpm_session_want_write(s);
+
+    if (tpm_session_state(s) == TPM_SESS_FAILED || (tpm_session_state(s) == TPM_SESS_DONE && !want_write)) {
+        close_conn(w, c);
+        return;
+    }
+    int fd = conn_fd(w->srv, c);
+    struct epoll_event e = { .events = EPOLLIN | EPOLLONESHOT | (want_write ? EPOLLOUT : 0), .data.fd = fd };
+    count_sys(w->srv, 1);
+    if (epoll_ctl(w->srv->w[c->owner].epfd, EPOLL_CTL_MOD, fd, &e) < 0) close_conn(w, c);
+}
+
+static void run_conn(ev_worker *w, ev_conn *c) {
+    tpm_session *s = c->sess;
+    if ((c->revents & EPOLLOUT) && tpm_session_flush(s) < 0) {
+        close_conn(w, c);
+        return;
+    }
+    if (c->revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) tpm_session_on_readable(s);
+    settle(w, c);
+}
+
+static void accept_all(ev_worker *w) {
+    ev_server *srv = w->srv;
+    for (;;) {
+        int fd = accept(w->lfd, NULL, NULL);
+        count_sys(srv, 1);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        if (fd >= srv->nconns || set_nonblock(fd) < 0) {
+            close(fd);
+            atomic_fetch_add(&srv->failed, 1);
+            continue;
+        }
+
+        // HELLO (비 seeded 면 첫 ROUND 까지) 를 쌓아 두고 바로 보내 본다
+        tpm_session *s = tpm_session_server(fd, &srv->cfg->params, &srv->cfg->opts);
+        if (s == NULL) {
+            close(fd);
+            atomic_fetch_add(&srv->failed, 1);
+            continue;
+        }
+        atomic_fetch_add(&srv->accepted, 1);
+        count_sys(srv, 4);      // fcntl ×2, setsockopt(TCP_NODELAY), epoll_ctl(ADD)
+        unsigned long active = atomic_fetch_add(&srv->active, 1) + 1;
+        unsigned long peak = atomic_load(&srv->peak_active);
+        while (active > peak && !atomic_compare_exchange_weak(&srv->peak_active, &peak, active)) {}
+
+        ev_conn *c = &srv->conns[fd];
+        c->owner = w->id;
+        c->sess = s;
+        struct epoll_event e = { .events = EPOLLIN | EPOLLONESHOT, .data.fd = fd };
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &e) < 0) {
+            close_conn(w, c);
+            continue;
+        }
+        if (tpm_session_flush(s) < 0) {
+            close_conn(w, c);
+            continue;
+        }
+        settle(w, c);
+    }
+}
+
+/* ---- 보고 ---- */
+
+/*
+ * 워커들이 직전 보고 이후 쌓은 분포를 out->lat 으로 모으고 서버 누적분에 옮긴 뒤 비운다.
+ * out->sync_ns, out->iters 는 누적분의 사본. 한 번에 한 스레드만 부른다 (워커 0, 끝나고 나서).
+ */
+static void collect(ev_server *srv, tpm_evserver_stats *out) {
+    memset(out, 0, sizeof(*out));
+    out->accepted = atomic_load(&srv->accepted);
+    out->done = atomic_load(&srv->done);
+    out->failed = atomic_load(&srv->failed);
+    out->active = atomic_load(&srv->active);
+    out->peak_active = atomic_load(&srv->peak_active);
+    out->rounds = atomic_load(&srv->rounds);
+    out->restarts = atomic_load(&srv->restarts);
+    out->syscalls = atomic_load(&srv->syscalls);
+    out->started_ns = srv->started_ns;
+    for (int i = 0; i < srv->nw; i++) {
+        ev_worker *w = &srv->w[i];
+        pthread_mutex_lock(&w->st_lock);
+        tpm_stats_merge(&out->lat, &w->lat);
+        tpm_stats_merge(&srv->sync_ns, &w->lat);
+        tpm_stats_merge(&srv->iters, &w->iters);
+        tpm_stats_reset(&w->lat);
+        tpm_stats_reset(&w->iters);
+        out->steals += w->steals;
+        pthread_mutex_unlock(&w->st_lock);
+    }
+    tpm_stats_merge(&out->sync_ns, &srv->sync_ns);
+    tpm_stats_merge(&out->iters, &srv->iters);
+}
+
+void tpm_evserver_stats_free(tpm_evserver_stats *st) {
+    tpm_stats_free(&st->lat);
+    tpm_stats_free(&st->sync_ns);
+    tpm_stats_free(&st->iters);
+}
+
+void tpm_evserver_report(const char *tag, tpm_evserver_stats *st) {
+    double sec = (double)(tpm_now_ns() - st->started_ns) * 1e-9;
+    printf("[%s] %.1fs  active %lu (peak %lu)  done %lu  failed %lu  steals %lu  %.0f sessions/s  "
+           "%.2f syscalls/round  sync p50 %.2f ms  p99 %.2f ms  (%zu samples)\n",
+           tag, sec, st->active, st->peak_active, st->done, st->failed, st->steals, sec > 0 ? st->done / sec : 0.0,
+           st->rounds ? (double)st->syscalls / st->rounds : 0.0,
+           tpm_stats_quantile(&st->lat, 0.50) * 1e-6, tpm_stats_quantile(&st->lat, 0.99) * 1e-6,
+           (size_t)st->lat.n);
+    fflush(stdout);
+}
+
+/* ---- 워커 ---- */
+
+static void *worker_main(void *arg) {
+    ev_worker *w = arg;
+    ev_server *srv = w->srv;
+    struct epoll_event events[EV_BATCH];
+    uint64_t next_report = srv->started_ns + (uint64_t)srv->cfg->report_ms * 1000000ULL;
+
+    while (!atomic_load(&srv->stop)) {
+        int timeout = queue_len(&w->ready) > 0 ? 0 : srv->nw > 1 ? EV_STEAL_MS : 100;
+        int n = epoll_wait(w->epfd, events, EV_BATCH, timeout);
+        count_sys(srv, 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            atomic_store(&srv->stop, 1);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == w->lfd) {
+                accept_all(w);
+                continue;
+            }
+            ev_conn *c = &srv->conns[fd];
+            c->revents = events[i].events;
+            if (queue_push(&w->ready, c) < 0) run_conn(w, c);
+        }
+
+        // 이번에 들어온 만큼만 처리하고 epoll 로 돌아간다. 그 사이 남이 가져갈 수도 있다.
+        for (size_t k = queue_len(&w->ready); k > 0; k--) {
+            ev_conn *c = queue_pop(&w->ready, 0);
+            if (c == NULL) break;
+            run_conn(w, c);
+        }
+        if (n == 0 && srv->nw > 1) {
+            ev_conn *c;
+            while (!atomic_load(&srv->stop) && (c = steal(w)) != NULL) run_conn(w, c);
+        }
+
+        if (w->id == 0 && srv->cfg->report_ms > 0 && tpm_now_ns() >= next_report) {
+            tpm_evserver_stats st;
+            collect(srv, &st);
+            tpm_evserver_report("evserver", &st);
+            tpm_evserver_stats_free(&st);
+            next_report = tpm_now_ns() + (uint64_t)srv->cfg->report_ms * 1000000ULL;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * listen_fd 에서 연결을 받아 세션을 돌린다. 워커 0 은 listen_fd 를 쓰고, 나머지 워커는
+ * 같은 주소에 SO_REUSEPORT 소켓을 새로 연다 (listen_fd 도 tpm_listen_tcp 로 연 것이어야 한다).
+ * cfg->max_sessions 개가 끝나면 0 을 돌려준다. 주기 보고의 백분위는 직전 보고 이후에 끝난 세션만 보고,
+ * 돌려주는 st->lat 은 전체 세션이다.
+ */
+int tpm_evserver_run(int listen_fd, const tpm_evserver_cfg *cfg, tpm_evserver_stats *st) {
+    struct rlimit rl;
+    ev_server srv = { .cfg = cfg, .started_ns = tpm_now_ns() };
+    int ret = -1, started = 0;
+
+    memset(st, 0, sizeof(*st));
+    srv.nw = cfg->threads > 0 ? cfg->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (srv.nw < 1) srv.nw = 1;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) return -1;
+    srv.nconns = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (1u << 20) ? (1 << 20) : (int)rl.rlim_cur;
+    srv.conns = calloc((size_t)srv.nconns, sizeof(*srv.conns));
+    srv.w = calloc((size_t)srv.nw, sizeof(*srv.w));
+    if (srv.conns == NULL || srv.w == NULL) goto out;
+
+    for (int i = 0; i < srv.nw; i++) {
+        ev_worker *w = &srv.w[i];
+        w->id = i;
+        w->srv = &srv;
+        w->epfd = -1;
+        w->lfd = i == 0 ? listen_fd : tpm_listen_again(listen_fd, SOMAXCONN);
+        pthread_mutex_init(&w->ready.lock, NULL);
+        pthread_mutex_init(&w->st_lock, NULL);
+        if (w->lfd < 0 || set_nonblock(w->lfd) < 0 || (w->epfd = epoll_create1(0)) < 0) goto out;
+        struct epoll_event le = { .events = EPOLLIN, .data.fd = w->lfd };
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->lfd, &le) < 0) goto out;
+    }
+
+    for (; started < srv.nw; started++)
+        if (pthread_create(&srv.w[started].th, NULL, worker_main, &srv.w[started]) != 0) break;
+    ret = started == srv.nw ? 0 : -1;
+    if (ret < 0) atomic_store(&srv.stop, 1);
+    for (int i = 0; i < started; i++) pthread_join(srv.w[i].th, NULL);
+    collect(&srv, st);
+    tpm_stats_reset(&st->lat);      // 반환할 때는 전체
+    tpm_stats_merge(&st->lat, &st->sync_ns);
+
+out:
+    for (int fd = 0; srv.conns != NULL && fd < srv.nconns; fd++) {
+        if (srv.conns[fd].sess == NULL) continue;
+        close(fd);
+        tpm_session_free(srv.conns[fd].sess);
+    }
+    for (int i = 0; srv.w != NULL && i < srv.nw; i++) {
+        ev_worker *w = &srv.w[i];
+        if (w->srv == NULL) continue;
+        if (w->epfd >= 0) close(w->epfd);
+        if (i > 0 && w->lfd >= 0) close(w->lfd);
+        free(w->ready.q);
+        tpm_stats_free(&w->lat);
+        tpm_stats_free(&w->iters);
+        pthread_mutex_destroy(&w->ready.lock);
+        pthread_mutex_destroy(&w->st_lock);
+    }
+    tpm_stats_free(&srv.sync_ns);
+    tpm_stats_free(&srv.iters);
+    free(srv.w);
+    free(srv.conns);
+    return ret;
+}
@@ -0,0 +1,173 @@
+#include "tpm.h"
+
+/*
+ * 유전 공격 (genetic attack) 의 공격자 무리. 도청자는 TPM 여러 개를 들고 A, B 가 갱신하는 라운드마다
+ *   - 개체 수 × 2^(K-1) 이 상한 이하면 (변이) 개체마다 tau 가 A 와 같은 내부 표현 2^(K-1) 가지로 복제해
+ *     각자 그 sigma 로 갱신한다.
+ *   - 아니면 (선택) tau 가 A 와 다른 개체를 버리고 남은 개체만 갱신한다. 모두 틀렸으면 A 의 tau 를
+ *     맞힌 횟수 (적합도) 가 큰 개체를 상한 / 2^(K-1) 개 남겨 변이한다.
+ *
+ * 라운드마다 개체가 생기고 없어지므로 TPM 을 그때그때 만들면 할당이 대부분을 차지한다. 여기서는
+ * 상한 개수만큼의 가중치 칸을 한 번 잡아 두고 (arena) 복제는 칸 사이 memcpy, 제거는 앞으로 당겨
+ * 채우기로 한다. 커널은 TPM 하나 (view) 의 weights, sigma 를 칸마다 바꿔 끼워 tpm.c 의 것을 그대로 쓴다.
+ * 적합도 계산 (개체마다 tau) 은 이어진 칸을 한 번 훑는다. 시행끼리는 attack.c 가 스레드로 나눈다.
+ */
+
+struct tpm_genetic {
+    TPM view;               // 커널을 부르는 틀 (가중치는 갖지 않는다)
+    int cap, n, variants;   // 상한, 지금 개체 수, 2^(K-1)
+    size_t len;
+    int8_t *w;              // [cap][K·N]
+    int *sigma;             // [cap][K]
+    int *tau;               // [cap] 이번 라운드 출력
+    uint32_t *fit;          // [cap] A 의 tau 를 맞힌 라운드 수
+    int *pick;              // [cap] 남길 칸 번호
+};
+
+static TPM *slot(tpm_genetic *g, int i) {
+    g->view.weights = g->w + (size_t)i * g->len;
+    g->view.sigma = g->sigma + (size_t)i * g->view.shape.K;
+    return &g->view;
+}
+
+static void copy_slot(tpm_genetic *g, int dst, int src) {
+    const int K = g->view.shape.K;
+    memcpy(g->w + (size_t)dst * g->len, g->w + (size_t)src * g->len, g->len);
+    memcpy(g->sigma + (size_t)dst * K, g->sigma + (size_t)src * K, (size_t)K * sizeof(*g->sigma));
+    g->tau[dst] = g->tau[src];
+    g->fit[dst] = g->fit[src];
+}
+
+/* pick[0..n-1] (오름차순) 칸만 앞으로 당겨 남긴다. pick[i] >= i 라 앞에서부터 옮겨도 겹치지 않는다. */
+static void keep_slots(tpm_genetic *g, int n) {
+    for (int i = 0; i < n; i++)
+        if (g->pick[i] != i) copy_slot(g, i, g->pick[i]);
+    g->n = n;
+}
+
+/* 적합도가 큰 개체 n 개 (같으면 앞 칸) 를 골라 남긴다. 모두 틀린 라운드에만 오므로 단순 선택 정렬로 충분하다. */
+static void keep_fittest(tpm_genetic *g, int n) {
+    for (int i = 0; i < g->n; i++) g->pick[i] = i;
+    for (int i = 0; i < n; i++) {
+        int best = i;
+        for (int j = i + 1; j < g->n; j++)
+            if (g->fit[g->pick[j]] > g->fit[g->pick[best]] ||
+                (g->fit[g->pick[j]] == g->fit[g->pick[best]] && g->pick[j] < g->pick[best]))
+                best = j;
+        int t = g->pick[i];
+        g->pick[i] = g->pick[best];
+        g->pick[best] = t;
+    }
+    // 옮길 때 겹치지 않도록 칸 번호 순으로
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && g->pick[j - 1] > g->pick[j]; j--) {
+            int t = g->pick[j];
+            g->pick[j] = g->pick[j - 1];
+            g->pick[j - 1] = t;
+        }
+    keep_slots(g, n);
+}
+
+/* 개체마다 tau 가 맞는 내부 표현 2^(K-1) 가지로 복제해 갱신. 복제본은 n 뒤의 빈 칸에 둔다. */
+static void mutate(tpm_genetic *g, const int8_t *theta, int tau) {
+    const int K = g->view.shape.K, n = g->n;
+    for (int i = 0; i < n; i++)
+        for (int v = 1; v < g->variants; v++) copy_slot(g, n + i * (g->variants - 1) + v - 1, i);
+    for (int i = 0; i < n; i++) {
+        for (int v = 0; v < g->variants; v++) {
+            TPM *e = slot(g, v == 0 ? i : n + i * (g->variants - 1) + v - 1);
+            int prod = 1;
+            for (int k = 0; k < K - 1; k++) {
+                e->sigma[k] = v >> k & 1 ? -1 : 1;
+                prod *= e->sigma[k];
+            }
+            e->sigma[K - 1] = prod * tau;
+            e->tau = tau;
+            update_weights(e, theta);
+        }
+    }
+    g->n = n * g->variants;
+}
+
+void tpm_genetic_free(tpm_genetic *g) {
+    if (g == NULL) return;
+    free(g->w);
+    free(g->sigma);
+    free(g->tau);
+    free(g->fit);
+    free(g->pick);
+    free(g);
+}
+
+/* 개체 수 상한 capacity. 한 번은 변이할 수 있어야 하므로 2^(K-1) 이상. */
+tpm_genetic *tpm_genetic_new(const tpm_shape *shape, tpm_rule rule, int capacity) {
+    if (!tpm_shape_valid(shape) || shape->K > 30 || capacity < (1 << (shape->K - 1))) return NULL;
+    tpm_genetic *g = calloc(1, sizeof(*g));
+    if (g == NULL) return NULL;
+    g->view.shape = *shape;
+    g->view.tau = 1;
+    g->view.ops = tpm_rule_get(rule);
+    g->view.kern = tpm_kernel_select(shape);
+    g->view.simd = tpm_simd_select();
+    g->view.update = g->view.kern->update[g->view.ops->dir < 0];
+    g->cap = capacity;
+    g->variants = 1 << (shape->K - 1);
+    g->len = tpm_vec_len(shape);
+    g->w = malloc(g->len * capacity);
+    g->sigma = malloc((size_t)capacity * shape->K * sizeof(*g->sigma));
+    g->tau = malloc((size_t)capacity * sizeof(*g->tau));
+    g->fit = malloc((size_t)capacity * sizeof(*g->fit));
+    g->pick = malloc((size_t)capacity * sizeof(*g->pick));
+    if (g->w == NULL || g->sigma == NULL || g->tau == NULL || g->fit == NULL || g->pick == NULL) {
+        tpm_genetic_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+/* 개체 하나로 다시 시작한다 (스레드별 난수, tpm_randomize_weights 한 번과 같은 값) */
+void tpm_genetic_reset(tpm_genetic *g) {
+    g->n = 1;
+    g->fit[0] = 0;
+    tpm_randomize_weights(slot(g, 0));
+}
+
+/* A, B 가 갱신하는 라운드에만 부른다. tau 는 A 의 tau. */
+void tpm_genetic_round(tpm_genetic *g, const int8_t *x, const int8_t *theta, int tau) {
+    int keep = 0;
+    for (int i = 0; i < g->n; i++) {
+        TPM *e = slot(g, i);
+        calculate_tau(e, x);
+        g->tau[i] = e->tau;
+        if (e->tau == tau) {
+            g->fit[i]++;
+            g->pick[keep++] = i;
+        }
+    }
+    if ((size_t)g->n * g->variants <= (size_t)g->cap) {
+        mutate(g, theta, tau);
+        return;
+    }
+    if (keep == 0) {
+        keep_fittest(g, g->cap / g->variants);
+        mutate(g, theta, tau);
+        return;
+    }
+    keep_slots(g, keep);
+    for (int i = 0; i < g->n; i++) {
+        TPM *e = slot(g, i);
+        e->tau = g->tau[i];
+        update_weights(e, theta);
+    }
+}
+
+int tpm_genetic_size(const tpm_genetic *g) {
+    return g->n;
+}
+
+/* weights 와 가중치가 같은 첫 개체, 없으면 -1 */
+int tpm_genetic_match(const tpm_genetic *g, const int8_t *weights) {
+    for (int i = 0; i < g->n; i++)
+        if (memcmp(g->w + (size_t)i * g->len, weights, g->len) == 0) return i;
+    return -1;
+}
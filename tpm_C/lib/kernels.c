@@ -0,0 +1,243 @@
+#include "tpm.h"
+
+// 3/4/3 표 커널은 가중치 한 줄을 little-endian 32 비트로 읽으므로 그런 호스트에서만 쓴다
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define LUT_N4_KERNEL 1
+#include "lut_n4.h"     // build/lut_n4.h, lib/lutgen.c 가 빌드 때 만든다
+#else
+#define LUT_N4_KERNEL 0
+#endif
+
+/*
+ * 커널 본체.
+ * K/N/L 과 dir 은 호출부에서 상수로 넘어오므로, 인라인 후 구조·규칙마다
+ * 루프 횟수가 고정되고 규칙 분기가 없는 코드가 따로 생성된다.
+ * (N=4 같은 작은 구조는 컴파일러가 루프를 완전히 펼친다)
+ *   random walk / query : w += theta
+ *   anti-hebbian        : w -= theta
+ */
+static inline __attribute__((always_inline))
+int clamp_weight(int v, const int L) {
+    v = v > L ? L : v;      // cmov 로 컴파일되는 분기 없는 clamp
+    return v < -L ? -L : v;
+}
+
+static inline __attribute__((always_inline))
+void calc_tau_kernel(TPM *tpm, const int8_t *x, const int K, const int N) {
+    const int8_t *w = tpm->weights;
+    int tau = 1;
+    for (int k = 0; k < K; k++) {
+        int sum = 0;
+        for (int n = 0; n < N; n++) {
+            sum += w[k * N + n] * x[k * N + n];
+        }
+        tpm->sigma[k] = sgn(sum);
+        tau *= tpm->sigma[k];
+    }
+    tpm->tau = tau;
+}
+
+static inline __attribute__((always_inline))
+void update_kernel(TPM *tpm, const int8_t *theta, const int K, const int N, const int L, const int dir) {
+    int8_t *w = tpm->weights;
+    for (int k = 0; k < K; k++) {
+        if (tpm->sigma[k] != tpm->tau) continue;
+        for (int n = 0; n < N; n++) {
+            w[k * N + n] = (int8_t)clamp_weight(w[k * N + n] + dir * theta[k * N + n], L);
+        }
+    }
+}
+
+/* 큰 N: hidden unit 한 줄을 SIMD 커널 하나로 처리한다 */
+static inline __attribute__((always_inline))
+void calc_tau_wide(TPM *tpm, const int8_t *x, const int K, const int N) {
+    int tau = 1;
+    for (int k = 0; k < K; k++) {
+        tpm->sigma[k] = sgn(tpm->simd->dot(tpm->weights + (size_t)k * N, x + (size_t)k * N, N));
+        tau *= tpm->sigma[k];
+    }
+    tpm->tau = tau;
+}
+
+static inline __attribute__((always_inline))
+void update_wide(TPM *tpm, const int8_t *theta, const int K, const int N, const int L, const int dir) {
+    for (int k = 0; k < K; k++) {
+        if (tpm->sigma[k] != tpm->tau) continue;
+        tpm->simd->update_row[dir < 0](tpm->weights + (size_t)k * N, theta + (size_t)k * N, N, L);
+    }
+}
+
+#if LUT_N4_KERNEL
+/*
+ * N=4, L=3: hidden unit 하나의 가중치 4 개를 12 비트 상태 번호로, 입력 4 개를 부호 비트 4 개로 바꿔
+ * 빌드 때 만든 표 (lib/lutgen.c) 를 찾는다. tau 는 표 한 번, 갱신은 표 한 번과 4 바이트 저장이다.
+ * 가중치와 입력 한 줄을 little-endian 32 비트로 읽는다 (바이트 n 이 n 번째 값).
+ * 다른 호스트에서는 3/4/3 도 루프 커널을 쓴다 (LUT_N4_KERNEL).
+ */
+static inline __attribute__((always_inline))
+uint32_t lut_state(uint32_t w) {
+    // 바이트마다 w + 3 (0..6). 자리 올림이 옆 바이트로 넘어가지 않게 부호 비트를 따로 더한다.
+    uint32_t t = ((w & 0x7f7f7f7fu) + 0x03030303u) ^ (w & 0x80808080u);
+    return (t & 0x7) | ((t >> 5) & 0x38) | ((t >> 10) & 0x1c0) | ((t >> 15) & 0xe00);
+}
+
+static inline __attribute__((always_inline))
+uint32_t lut_signs(uint32_t x) {
+    // 바이트 n 의 부호 비트 (비트 8n+7) 를 비트 28+n 으로 모은다. 곱의 항들이 겹치지 않는다.
+    return ((x & 0x80808080u) * 0x00204081u) >> 28;
+}
+
+static inline __attribute__((always_inline))
+void calc_tau_lut(TPM *tpm, const int8_t *x, const int K, const int N) {
+    int neg = 0;    // 음수인 sigma 개수의 홀짝
+    (void)N;
+    for (int k = 0; k < K; k++) {
+        uint32_t w, xs;
+        memcpy(&w, tpm->weights + 4 * k, 4);
+        memcpy(&xs, x + 4 * k, 4);
+        int s = (lut_n4_neg[lut_state(w)] >> lut_signs(xs)) & 1;
+        tpm->sigma[k] = 1 - 2 * s;
+        neg ^= s;
+    }
+    tpm->tau = 1 - 2 * neg;
+}
+
+static inline __attribute__((always_inline))
+void update_lut(TPM *tpm, const int8_t *theta, const int K, const int N, const int L, const int dir) {
+    (void)N;
+    (void)L;
+    // 표를 늘 찾고 sigma == tau 인 unit 만 바꿔 쓴다. 갱신 여부는 무작위라 분기하면 자주 빗나간다.
+    for (int k = 0; k < K; k++) {
+        uint32_t w, ts;
+        memcpy(&w, tpm->weights + 4 * k, 4);
+        memcpy(&ts, theta + 4 * k, 4);
+        // w - theta 는 부호를 뒤집은 theta 를 더하는 것과 같다
+        uint32_t next = lut_n4_next[lut_state(w)][lut_signs(ts) ^ (dir < 0 ? 0xf : 0)];
+        w = tpm->sigma[k] == tpm->tau ? next : w;
+        memcpy(tpm->weights + 4 * k, &w, 4);
+    }
+}
+#endif
+
+/* 임의 구조용 generic 커널 (작은 N 은 스칼라, 큰 N 은 SIMD) */
+#define GENERIC_WIDE_MIN_N 32
+
+static void calc_tau_generic(TPM *tpm, const int8_t *x) {
+    calc_tau_kernel(tpm, x, tpm->shape.K, tpm->shape.N);
+}
+
+static void update_fwd_generic(TPM *tpm, const int8_t *theta) {
+    update_kernel(tpm, theta, tpm->shape.K, tpm->shape.N, tpm->shape.L, 1);
+}
+
+static void update_rev_generic(TPM *tpm, const int8_t *theta) {
+    update_kernel(tpm, theta, tpm->shape.K, tpm->shape.N, tpm->shape.L, -1);
+}
+
+static void calc_tau_generic_wide(TPM *tpm, const int8_t *x) {
+    calc_tau_wide(tpm, x, tpm->shape.K, tpm->shape.N);
+}
+
+static void update_fwd_generic_wide(TPM *tpm, const int8_t *theta) {
+    update_wide(tpm, theta, tpm->shape.K, tpm->shape.N, tpm->shape.L, 1);
+}
+
+static void update_rev_generic_wide(TPM *tpm, const int8_t *theta) {
+    update_wide(tpm, theta, tpm->shape.K, tpm->shape.N, tpm->shape.L, -1);
+}
+
+/*
+ * 자주 쓰는 구조는 K/N/L 을 상수로 박은 특수화 커널을 만든다.
+ * BODY 는 kernel (스칼라, 작은 N), wide (SIMD, 큰 N) 또는 lut (N=4, L=3 표).
+ */
+#define DEFINE_SHAPE_KERNEL(SK, SN, SL, BODY)                                           \
+    static void calc_tau_##SK##_##SN##_##SL##_##BODY(TPM *tpm, const int8_t *x) {       \
+        calc_tau_##BODY(tpm, x, SK, SN);                                                \
+    }                                                                                   \
+    static void update_fwd_##SK##_##SN##_##SL##_##BODY(TPM *tpm, const int8_t *theta) { \
+        update_##BODY(tpm, theta, SK, SN, SL, 1);                                       \
+    }                                                                                   \
+    static void update_rev_##SK##_##SN##_##SL##_##BODY(TPM *tpm, const int8_t *theta) { \
+        update_##BODY(tpm, theta, SK, SN, SL, -1);                                      \
+    }
+
+#define SHAPE_KERNEL_ENTRY(SK, SN, SL, BODY, NAME)                                      \
+    { { SK, SN, SL }, NAME, calc_tau_##SK##_##SN##_##SL##_##BODY,                       \
+      { update_fwd_##SK##_##SN##_##SL##_##BODY, update_rev_##SK##_##SN##_##SL##_##BODY } }
+
+#if LUT_N4_KERNEL
+_Static_assert(LUT_N4_L == 3, "lut_n4.h 는 L=3 표다");
+DEFINE_SHAPE_KERNEL(3, 4, 3, lut)
+#endif
+DEFINE_SHAPE_KERNEL(3, 4, 3, kernel)
+DEFINE_SHAPE_KERNEL(3, 100, 3, wide)
+DEFINE_SHAPE_KERNEL(3, 1000, 6, wide)
+
+static const tpm_kernel shape_kernels[] = {
+#if LUT_N4_KERNEL
+    SHAPE_KERNEL_ENTRY(3, 4, 3, lut, "3/4/3"),
+#else
+    SHAPE_KERNEL_ENTRY(3, 4, 3, kernel, "3/4/3"),
+#endif
+    SHAPE_KERNEL_ENTRY(3, 100, 3, wide, "3/100/3"),
+    SHAPE_KERNEL_ENTRY(3, 1000, 6, wide, "3/1000/6"),
+};
+
+// 고르지는 않고 이름으로만 꺼내는 커널 (비교용)
+static const tpm_kernel named_kernels[] = {
+    SHAPE_KERNEL_ENTRY(3, 4, 3, kernel, "3/4/3-loop"),
+};
+
+static const tpm_kernel generic_kernel = {
+    { 0, 0, 0 }, "generic", calc_tau_generic, { update_fwd_generic, update_rev_generic }
+};
+
+static const tpm_kernel generic_wide_kernel = {
+    { 0, 0, 0 }, "generic-wide", calc_tau_generic_wide, { update_fwd_generic_wide, update_rev_generic_wide }
+};
+
+const tpm_kernel *tpm_kernel_select(const tpm_shape *shape) {
+    for (size_t i = 0; i < sizeof(shape_kernels) / sizeof(shape_kernels[0]); i++) {
+        const tpm_shape *s = &shape_kernels[i].shape;
+        if (s->K == shape->K && s->N == shape->N && s->L == shape->L)
+            return &shape_kernels[i];
+    }
+    return shape->N >= GENERIC_WIDE_MIN_N ? &generic_wide_kernel : &generic_kernel;
+}
+
+/* 이름으로 커널을 찾는다 (generic 포함). 없으면 NULL. */
+const tpm_kernel *tpm_kernel_get(const char *name) {
+    for (size_t i = 0; i < sizeof(shape_kernels) / sizeof(shape_kernels[0]); i++)
+        if (strcmp(name, shape_kernels[i].name) == 0) return &shape_kernels[i];
+    for (size_t i = 0; i < sizeof(named_kernels) / sizeof(named_kernels[0]); i++)
+        if (strcmp(name, named_kernels[i].name) == 0) return &named_kernels[i];
+    if (strcmp(name, generic_kernel.name) == 0) return &generic_kernel;
+    if (strcmp(name, generic_wide_kernel.name) == 0) return &generic_wide_kernel;
+    return NULL;
+}
+
+static void inputs_random(const TPM *tpm, int8_t *x, int H) {
+    (void)H;
+    generate_inputs(&tpm->shape, x);
+}
+
+static const tpm_rule_ops rule_table[RULE_COUNT] = {
+    [RULE_RANDOM_WALK]  = { RULE_RANDOM_WALK,  "random",  1, inputs_random },
+    [RULE_ANTI_HEBBIAN] = { RULE_ANTI_HEBBIAN, "anti",   -1, inputs_random },
+    [RULE_QUERY]        = { RULE_QUERY,        "query",   1, generate_query_inputs },
+};
+
+const tpm_rule_ops *tpm_rule_get(tpm_rule rule) {
+    if ((unsigned)rule >= RULE_COUNT) rule = RULE_RANDOM_WALK;
+    return &rule_table[rule];
+}
+
+int tpm_rule_parse(const char *name, tpm_rule *rule) {
+    for (int r = 0; r < RULE_COUNT; r++) {
+        if (strcmp(name, rule_table[r].name) == 0) {
+            *rule = (tpm_rule)r;
+            return 0;
+        }
+    }
+    return -1;
+}
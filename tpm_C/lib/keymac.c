@@ -0,0 +1,88 @@
+#include "tpm.h"
+
+/*
+ * 동기화 확인 태그. 가중치를 보내는 대신 가중치로 키를 만든 HMAC 을 비교한다.
+ *   row_k  = SHA-256(weights[k][0..N-1])
+ *   key    = SHA-256(row_0 || ... || row_{K-1})
+ *   tag(r) = HMAC-SHA256(key, salt || round)      salt 는 HELLO 의 서버 nonce
+ *   세션 키 = HMAC-SHA256(key, "tpm-session-key" || salt)   동기화가 끝난 뒤 (태그와 겹치지 않는 입력)
+ * 행 digest 와 키를 넣은 HMAC 상태를 캐시해 두고, 갱신된 hidden unit (sigma == tau) 의 행만
+ * 다시 해시한다. 갱신이 없던 라운드의 태그는 압축 두 번이면 된다.
+ */
+
+int tpm_keymac_init(tpm_keymac *m, const tpm_shape *shape) {
+    memset(m, 0, sizeof(*m));
+    m->K = shape->K;
+    m->N = shape->N;
+    m->row = malloc((size_t)shape->K * TPM_SHA256_SIZE);
+    m->stale = malloc((size_t)shape->K);
+    if (m->row == NULL || m->stale == NULL) {
+        tpm_keymac_free(m);
+        return -1;
+    }
+    tpm_keymac_reset(m);
+    return 0;
+}
+
+void tpm_keymac_free(tpm_keymac *m) {
+    free(m->row);
+    free(m->stale);
+    m->row = NULL;
+    m->stale = NULL;
+}
+
+void tpm_keymac_reset(tpm_keymac *m) {
+    memset(m->stale, 1, (size_t)m->K);
+    m->key_stale = 1;
+}
+
+/* update_weights 뒤에 부른다. 이번 라운드에 갱신된 행만 표시한다. */
+void tpm_keymac_touch(tpm_keymac *m, const TPM *tpm) {
+    for (int k = 0; k < m->K; k++) {
+        if (tpm->sigma[k] == tpm->tau) {
+            m->stale[k] = 1;
+            m->key_stale = 1;
+        }
+    }
+}
+
+/* 갱신된 행만 다시 해시해 HMAC 키를 최신으로 만든다 */
+static void refresh_key(tpm_keymac *m, TPM *tpm) {
+    uint8_t key[TPM_SHA256_SIZE];
+
+    if (!m->key_stale) return;
+    tpm_sync_weights(tpm);
+    for (int k = 0; k < m->K; k++) {
+        if (!m->stale[k]) continue;
+        tpm_sha256(tpm->weights + (size_t)k * m->N, (size_t)m->N, m->row + (size_t)k * TPM_SHA256_SIZE);
+        m->stale[k] = 0;
+        m->rehashed++;
+    }
+    tpm_sha256(m->row, (size_t)m->K * TPM_SHA256_SIZE, key);
+    tpm_hmac_init(&m->mac, key, sizeof(key));
+    m->key_stale = 0;
+}
+
+void tpm_keymac_tag(tpm_keymac *m, TPM *tpm, uint64_t salt, uint32_t round, uint8_t out[TPM_TAG_SIZE]) {
+    refresh_key(m, tpm);
+
+    uint8_t msg[12];
+    tpm_put_u64(msg, salt);
+    msg[8] = (uint8_t)(round >> 24);
+    msg[9] = (uint8_t)(round >> 16);
+    msg[10] = (uint8_t)(round >> 8);
+    msg[11] = (uint8_t)round;
+    tpm_hmac_tag(&m->mac, msg, sizeof(msg), out);
+    m->tags++;
+}
+
+/* 동기화된 가중치에서 세션 키를 뽑는다. 태그는 공개되므로 태그와 다른 입력으로 만든다. */
+void tpm_keymac_derive(tpm_keymac *m, TPM *tpm, uint64_t salt, uint8_t out[TPM_KEY_SIZE]) {
+    static const char label[] = "tpm-session-key";
+    uint8_t msg[sizeof(label) - 1 + 8];
+
+    refresh_key(m, tpm);
+    memcpy(msg, label, sizeof(label) - 1);
+    tpm_put_u64(msg + sizeof(label) - 1, salt);
+    tpm_hmac_tag(&m->mac, msg, sizeof(msg), out);
+}
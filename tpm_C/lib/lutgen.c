@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * 빌드 도구. N=4, L=3 hidden unit 의 표 (build/lut_n4.h) 를 만들어 표준 출력에 쓴다.
+ * 라이브러리에는 들어가지 않고, Makefile 이 kernels.o 를 만들기 전에 돌린다.
+ *
+ * 가중치 상태는 w[n] + 3 (0..6) 을 3 비트씩 이어 붙인 12 비트 번호, 입력은 x[n] < 0 인 자리의
+ * 4 비트 마스크다. 가중치 필드가 7 인 번호는 나오지 않으므로 0 으로 채운다.
+ *   lut_n4_neg[s]       : 비트 b 가 켜져 있으면 입력 b 에서 sgn(Σ w x) = -1 (sgn(0) = +1)
+ *   lut_n4_next[s][b]   : w += theta (theta 는 입력과 같은 비트 표기) 후 [-3, 3] 으로 자른 가중치,
+ *                         바이트 n 이 w[n] 인 little-endian 32 비트 값
+ */
+
+#define LUT_N 4
+#define LUT_L 3
+#define LUT_STATES (1 << (3 * LUT_N))
+#define LUT_PATTERNS (1 << LUT_N)
+
+static int weight_of(int s, int n) {
+    return ((s >> (3 * n)) & 7) - LUT_L;
+}
+
+static int state_valid(int s) {
+    for (int n = 0; n < LUT_N; n++)
+        if (weight_of(s, n) > LUT_L) return 0;
+    return 1;
+}
+
+static int input_of(int b, int n) {
+    return (b >> n) & 1 ? -1 : 1;
+}
+
+int main(void) {
+    printf("/* lib/lutgen.c 가 만든 파일. 고치지 말 것. */\n");
+    printf("#define LUT_N4_L %d\n\n", LUT_L);
+
+    printf("static const uint16_t lut_n4_neg[%d] = {\n", LUT_STATES);
+    for (int s = 0; s < LUT_STATES; s++) {
+        unsigned neg = 0;
+        for (int b = 0; b < LUT_PATTERNS && state_valid(s); b++) {
+            int sum = 0;
+            for (int n = 0; n < LUT_N; n++) sum += weight_of(s, n) * input_of(b, n);
+            if (sum < 0) neg |= 1u << b;
+        }
+        printf("%s0x%04x,%s", s % 8 == 0 ? "    " : "", neg, s % 8 == 7 ? "\n" : " ");
+    }
+    printf("};\n\n");
+
+    printf("static const uint32_t lut_n4_next[%d][%d] = {\n", LUT_STATES, LUT_PATTERNS);
+    for (int s = 0; s < LUT_STATES; s++) {
+        printf("    {");
+        for (int b = 0; b < LUT_PATTERNS; b++) {
+            uint32_t next = 0;
+            for (int n = 0; n < LUT_N && state_valid(s); n++) {
+                int v = weight_of(s, n) + input_of(b, n);
+                v = v > LUT_L ? LUT_L : v < -LUT_L ? -LUT_L : v;
+                next |= (uint32_t)(uint8_t)(int8_t)v << (8 * n);
+            }
+            printf("0x%08x%s", next, b + 1 < LUT_PATTERNS ? ", " : "");
+        }
+        printf("},\n");
+    }
+    printf("};\n");
+    return 0;
+}
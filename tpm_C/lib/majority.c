@@ -0,0 +1,207 @@
+#include "tpm.h"
+
+/*
+ * 공격자 M 개를 한 묶음으로 돌리는 엔진 (다수결 공격, 기하 공격 묶음).
+ * TPM 구조체를 M 개 두면 라운드마다 M 번 따로 흩어진 가중치를 읽는다. 여기서는 가중치를
+ * 공격자 MJ_LANE 개씩 블록으로 묶어 w[k·N + n][lane] 으로 두고 (structure of arrays), 같은 입력 x[k][n] 에
+ * 대한 블록의 곱을 한 줄로 읽는다. lane 루프는 길이가 상수이고 분기가 없어 컴파일러가 벡터화한다
+ * (AVX2 가 있으면 그 버전을 쓴다).
+ *
+ * 한 라운드 (A, B 가 갱신하는 라운드에만 부른다. tau 는 A 의 tau)
+ *   1. 국소장 h[k][m] 과 내부 표현 rep[m] (sigma 가 음수인 hidden unit 의 비트)
+ *   2. 기하 보정: tau 가 A 와 다른 공격자는 |h| 가 가장 작은 unit 의 sigma 를 뒤집는다
+ *   3. 다수결이면 가장 많은 공격자가 가진 내부 표현을 모두가 쓴다 (같은 수면 비트가 작은 쪽)
+ *   4. sigma == tau 인 행을 theta 로 갱신. 다수결이면 모든 공격자의 갱신 행이 같아 행 단위로 한 번에 한다.
+ * 다수결을 끄면 공격자마다 attack.c 의 geometric_step 과 같은 결과가 나온다 (bench_majority 가 비교한다).
+ */
+
+#define MJ_LANE 32              // 공격자를 이 수만큼 한 블록으로 묶는다 (남는 lane 은 세지 않는다)
+#define MJ_MAX_K 16             // 내부 표현 수를 세는 표가 2^K 칸
+
+struct tpm_majority {
+    int K, N, L, M, blocks, dir, majority;
+    int8_t *w;                  // [블록][K·N][MJ_LANE]
+    int8_t *sel;                // [블록][K][MJ_LANE] 이번 라운드에 갱신할 행이면 -1
+    uint16_t *rep;              // [블록·MJ_LANE] 내부 표현 (sigma 가 음수인 hidden unit 의 비트)
+    uint32_t *count;            // [2^K] 다수결 표
+    void (*round)(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau);
+};
+
+/*
+ * 블록 하나의 국소장, 내부 표현, 기하 보정. lane 루프는 길이가 상수라 -O2 에서도 벡터화된다.
+ * 비트 연산은 lane 마다 다른 shift 를 피하려고 k 마다 상수 비트로 고른다.
+ */
+static inline __attribute__((always_inline))
+void mj_block_rep(const int8_t *restrict w, const int8_t *x, int K, int N, uint16_t neg, uint16_t *restrict rep) {
+    int16_t minh[MJ_LANE];
+    uint16_t r[MJ_LANE] = { 0 }, par[MJ_LANE] = { 0 }, flip[MJ_LANE] = { 0 };
+
+    for (int j = 0; j < MJ_LANE; j++) minh[j] = INT16_MAX;
+    for (int k = 0; k < K; k++) {
+        int16_t h[MJ_LANE] = { 0 };
+        for (int n = 0; n < N; n++, w += MJ_LANE) {
+            if (x[k * N + n] > 0)
+                for (int j = 0; j < MJ_LANE; j++) h[j] += w[j];
+            else
+                for (int j = 0; j < MJ_LANE; j++) h[j] -= w[j];
+        }
+        const uint16_t bit = (uint16_t)(1u << k);
+        for (int j = 0; j < MJ_LANE; j++) {
+            const uint16_t s = h[j] < 0 ? 0xffff : 0;
+            const int16_t a = h[j] < 0 ? -h[j] : h[j];
+            r[j] |= s & bit;
+            par[j] ^= s;
+            flip[j] = a < minh[j] ? bit : flip[j];     // 같은 |h| 면 앞의 unit
+            minh[j] = a < minh[j] ? a : minh[j];
+        }
+    }
+    // tau 는 음수 sigma 개수의 홀짝. A 와 다르면 |h| 가 가장 작은 unit 을 뒤집는다
+    for (int j = 0; j < MJ_LANE; j++) rep[j] = r[j] ^ (flip[j] & (par[j] ^ neg));
+}
+
+/* 블록 하나에서 sel 이 -1 인 lane 만 theta 로 갱신 */
+static inline __attribute__((always_inline))
+void mj_block_update(int8_t *restrict w, const int8_t *restrict sel, const int8_t *theta, int K, int N, int dir,
+                     int8_t L) {
+    for (int k = 0; k < K; k++, sel += MJ_LANE) {
+        for (int n = 0; n < N; n++, w += MJ_LANE) {
+            const int8_t t = (int8_t)(dir * theta[k * N + n]);
+            for (int j = 0; j < MJ_LANE; j++) {
+                int8_t v = (int8_t)(w[j] + (t & sel[j]));
+                w[j] = v > L ? L : v < -L ? (int8_t)-L : v;
+            }
+        }
+    }
+}
+
+static inline __attribute__((always_inline))
+void mj_round_body(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau) {
+    const int K = e->K, N = e->N, blocks = e->blocks;
+    const size_t bw = (size_t)K * N * MJ_LANE, bs = (size_t)K * MJ_LANE;
+    const uint16_t neg = tau < 0 ? 0xffff : 0;
+    uint16_t *rep = e->rep;
+
+    // 1, 2. 국소장, 내부 표현, 기하 보정
+    for (int b = 0; b < blocks; b++) mj_block_rep(e->w + b * bw, x, K, N, neg, rep + (size_t)b * MJ_LANE);
+
+    // 3, 4. 다수결이면 모두 같은 내부 표현을 쓰므로 갱신할 행이 모두 같다. 행 단위로 한 번에 갱신
+    if (e->majority) {
+        uint32_t top = 0;
+        uint16_t win = 0;
+        for (int m = 0; m < e->M; m++) e->count[rep[m]]++;
+        for (int m = 0; m < e->M; m++) {
+            uint32_t c = e->count[rep[m]];
+            if (c > top || (c == top && rep[m] < win)) {
+                top = c;
+                win = rep[m];
+            }
+        }
+        for (int m = 0; m < e->M; m++) e->count[rep[m]] = 0;
+
+        const int8_t L = (int8_t)e->L;
+        for (int k = 0; k < K; k++) {
+            if ((win >> k & 1) != (neg & 1)) continue;
+            for (int n = 0; n < N; n++) {
+                const int8_t t = (int8_t)(e->dir * theta[k * N + n]);
+                int8_t *w = e->w + ((size_t)k * N + n) * MJ_LANE;
+                for (int b = 0; b < blocks; b++, w += bw)
+                    for (int j = 0; j < MJ_LANE; j++) {
+                        int8_t v = (int8_t)(w[j] + t);
+                        w[j] = v > L ? L : v < -L ? (int8_t)-L : v;
+                    }
+            }
+        }
+        return;
+    }
+
+    // 4. 공격자마다 sigma == tau 인 행 (내부 표현 비트가 tau 의 부호와 같은 행) 을 갱신
+    for (int b = 0; b < blocks; b++) {
+        int8_t *sel = e->sel + b * bs;
+        const uint16_t *r = rep + (size_t)b * MJ_LANE;
+        for (int k = 0; k < K; k++)
+            for (int j = 0; j < MJ_LANE; j++) sel[k * MJ_LANE + j] = (r[j] >> k & 1) == (neg & 1) ? -1 : 0;
+        mj_block_update(e->w + b * bw, sel, theta, K, N, e->dir, (int8_t)e->L);
+    }
+}
+
+static void mj_round_default(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau) {
+    mj_round_body(e, x, theta, tau);
+}
+
+__attribute__((target("avx2")))
+static void mj_round_avx2(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau) {
+    mj_round_body(e, x, theta, tau);
+}
+
+void tpm_majority_free(tpm_majority *e) {
+    if (e == NULL) return;
+    free(e->w);
+    free(e->sel);
+    free(e->rep);
+    free(e->count);
+    free(e);
+}
+
+/* 공격자 attackers 개. majority 가 0 이면 공격자마다 기하 공격만 한다. K 는 16, N·L 은 int16 범위까지. */
+tpm_majority *tpm_majority_new(const tpm_shape *shape, tpm_rule rule, int attackers, int majority) {
+    if (!tpm_shape_valid(shape) || shape->K > MJ_MAX_K || shape->N * shape->L > INT16_MAX || attackers < 1)
+        return NULL;
+    tpm_majority *e = calloc(1, sizeof(*e));
+    if (e == NULL) return NULL;
+    e->K = shape->K;
+    e->N = shape->N;
+    e->L = shape->L;
+    e->M = attackers;
+    e->blocks = (attackers + MJ_LANE - 1) / MJ_LANE;
+    e->dir = tpm_rule_get(rule)->dir;
+    e->majority = majority;
+    e->w = calloc(tpm_vec_len(shape) * e->blocks, MJ_LANE);
+    e->sel = malloc((size_t)e->K * e->blocks * MJ_LANE);
+    e->rep = malloc((size_t)e->blocks * MJ_LANE * sizeof(*e->rep));
+    e->count = calloc((size_t)1 << e->K, sizeof(*e->count));
+    if (e->w == NULL || e->sel == NULL || e->rep == NULL || e->count == NULL) {
+        tpm_majority_free(e);
+        return NULL;
+    }
+    e->round = __builtin_cpu_supports("avx2") ? mj_round_avx2 : mj_round_default;
+    return e;
+}
+
+/* 공격자 m 의 가중치 i 자리 */
+static inline size_t lane_index(const tpm_majority *e, int m, size_t i) {
+    return ((size_t)(m / MJ_LANE) * e->K * e->N + i) * MJ_LANE + m % MJ_LANE;
+}
+
+/* 스레드별 난수로 공격자 0, 1, .. 순서로 뽑는다 (tpm_randomize_weights 를 M 번 부른 것과 같은 값) */
+void tpm_majority_randomize(tpm_majority *e) {
+    const size_t len = (size_t)e->K * e->N;
+    for (int m = 0; m < e->M; m++) {
+        for (size_t i = 0; i < len; i++) {
+            int w = 0;
+            while (w == 0) w = (int)tpm_rand_below(2 * e->L + 1) - e->L;
+            e->w[lane_index(e, m, i)] = (int8_t)w;
+        }
+    }
+}
+
+void tpm_majority_round(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau) {
+    e->round(e, x, theta, tau);
+}
+
+/* weights 와 가중치가 같은 첫 공격자, 없으면 -1 */
+int tpm_majority_match(const tpm_majority *e, const int8_t *weights) {
+    const size_t len = (size_t)e->K * e->N;
+    for (int b = 0; b < e->blocks; b++) {
+        const int8_t *w = e->w + (size_t)b * len * MJ_LANE;
+        uint8_t diff[MJ_LANE] = { 0 };
+        for (size_t i = 0; i < len; i++, w += MJ_LANE)
+            for (int j = 0; j < MJ_LANE; j++) diff[j] |= (uint8_t)(w[j] ^ weights[i]);
+        for (int j = 0; j < MJ_LANE && b * MJ_LANE + j < e->M; j++)
+            if (diff[j] == 0) return b * MJ_LANE + j;
+    }
+    return -1;
+}
+
+void tpm_majority_get(const tpm_majority *e, int m, int8_t *weights) {
+    for (size_t i = 0; i < (size_t)e->K * e->N; i++) weights[i] = e->w[lane_index(e, m, i)];
+}
@@ -0,0 +1,898 @@
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include "tpm.h"
+
+/*
+ * 작은 구조의 동기화 시간 분포를 표본 없이 정확히 구한다 (몬테카를로 검증용 기준값).
+ *
+ * 상태는 두 TPM 의 가중치 전체다. 한 라운드는 sim.c 와 같다:
+ *   입력 x (query 면 hidden unit 마다 A 의 가중치에 맞춘 것) → sigma, tau →
+ *   tauA == tauB 면 sigma == tau 인 행만 theta 로 갱신하고 clamp → 가중치가 같으면 동기화.
+ * x 와 theta 는 hidden unit 마다 독립이라, 전이 확률은 유닛별 표 (sigma 분포, 갱신 뒤 상태 분포) 의 곱이다.
+ *
+ * 대칭 (확률이 그대로인 바꿈) 으로 상태를 줄인다
+ *   - 유닛 안의 위치 순서: 위치별 (wA, wB) 쌍의 중복 집합만 본다 (query 입력도 위치 순서에 무관하다).
+ *   - 위치의 부호: (wA, wB, x, theta) 를 함께 뒤집어도 h 와 갱신이 그대로라 (a, b) 와 (-a, -b) 는 같다.
+ *   - 유닛 순서: 결합 상태는 유닛 상태 K 개를 정렬한 것.
+ *   - random walk / anti-hebbian 은 A 와 B 를 바꿔도 같다 (query 는 A 로 입력을 만들어서 아니다).
+ * 그래도 3/4/3 은 유닛 상태가 20475 개, 결합 상태가 10^12 개 가까이라 (tpm_markov_space) 풀 수 없다.
+ * 도달한 상태가 max_states 를 넘으면 E2BIG 로 포기한다. 3/2/2, 3/4/1, 2/3/2 정도가 풀린다.
+ *
+ * 초기 분포 (가중치는 [-L, L] \ {0} 에서 고르게) 에서 넓이 우선으로 도달 가능한 상태를 찾으며
+ * 행을 만들고 (묶음마다 스레드가 나눠 만든다), 열 방향 (CSC) 으로 바꾼 뒤 확률 벡터를 라운드마다 곱한다.
+ * 동기화된 상태는 흡수 상태라 라운드 r 에 흡수된 확률이 P(T = r) 이다. 동기화 상태로 갈 길이 없는
+ * 상태 (가중치가 서로 반대로 굳은 경우 등) 에 들어간 확률은 never 로 따로 센다.
+ * 곱셈은 열을 고정된 조각으로 나눠 맡기므로 결과는 스레드 수와 상관없다.
+ */
+
+#define MK_MAX_K 6
+#define MK_MAX_N 10
+#define MK_MAX_L 10
+#define MK_MAX_UNITS (1u << 22)
+#define MK_BATCH 4096           // 스레드 하나가 한 묶음에 만드는 행 수
+#define MK_CHUNKS 256           // 곱셈의 열 조각 수
+
+// 결합 상태의 종류
+enum { MK_LIVE, MK_SYNCED, MK_DEAD };   // MK_DEAD: 동기화 상태로 갈 길이 없다 (rows 를 다 만든 뒤 정한다)
+
+typedef struct {
+    uint32_t swap;              // A 와 B 를 바꾼 유닛 상태
+    uint8_t synced;             // 모든 위치에서 wA == wB
+    uint16_t cnt[3];            // A 만 / B 만 / 둘 다 갱신했을 때 다음 상태 수
+    double sig[4];              // (sigmaA, sigmaB) 확률. 색인은 (sA < 0) << 1 | (sB < 0)
+} mk_unit;
+
+typedef struct {
+    uint32_t k[MK_MAX_K];       // 정렬한 유닛 상태 (남는 칸은 0)
+    double p;
+} mk_ent;
+
+typedef struct {
+    int K, N, L, W, X, dir, query, swap, threads;
+    uint64_t *binom;            // C(n, k) = binom[n * (N + 1) + k]
+    uint32_t U;
+    mk_unit *units;
+    uint32_t *nid;              // 유닛 u 의 갱신 f (1..3) 뒤 상태: nid[((u * 3) + f - 1) * X + j]
+    double *np;
+
+    // 결합 상태
+    uint32_t *keys;             // states * K
+    uint8_t *kind;              // MK_LIVE / MK_SYNCED / MK_DEAD
+    double *init;
+    size_t states, cap, max_states;
+    uint32_t *table;            // 열린 주소 해시 (빈 칸은 UINT32_MAX)
+    size_t tmask;
+
+    // 행 (CSR). rowp 는 행을 만든 상태까지만 채워진다.
+    size_t *rowp;
+    uint32_t *col;
+    double *val;
+    size_t nnz, nnz_cap;
+} mk_ctx;
+
+/* ---- 유닛 상태: 위치별 쌍 종류의 중복 집합 ---- */
+
+static uint64_t binom(const mk_ctx *c, int n, int k) {
+    return c->binom[(size_t)n * (c->N + 1) + k];
+}
+
+// (a, b) 와 (-a, -b) 중 번호가 작은 쪽
+static int pair_type(const mk_ctx *c, int a, int b) {
+    int r = (a + c->L) * c->W + (b + c->L), m = c->W * c->W - 1 - r;
+    return r < m ? r : m;
+}
+
+static void sort_u8(uint8_t *t, int n) {
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && t[j - 1] > t[j]; j--) {
+            uint8_t x = t[j];
+            t[j] = t[j - 1];
+            t[j - 1] = x;
+        }
+}
+
+static void sort_u32(uint32_t *t, int n) {
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && t[j - 1] > t[j]; j--) {
+            uint32_t x = t[j];
+            t[j] = t[j - 1];
+            t[j - 1] = x;
+        }
+}
+
+// 정렬한 종류 t[0] <= .. <= t[N-1] 의 번호 (중복 조합의 colex 순위). t 는 정렬된다.
+static uint32_t unit_rank(const mk_ctx *c, uint8_t *t) {
+    uint64_t r = 0;
+    sort_u8(t, c->N);
+    for (int i = 0; i < c->N; i++) r += binom(c, t[i] + i, i + 1);
+    return (uint32_t)r;
+}
+
+static void unit_unrank(const mk_ctx *c, uint32_t r, uint8_t *t) {
+    const int top = (c->W * c->W + 1) / 2 + c->N - 2;
+    for (int i = c->N - 1; i >= 0; i--) {
+        int d = i;
+        while (d < top && binom(c, d + 1, i + 1) <= r) d++;
+        r -= (uint32_t)binom(c, d, i + 1);
+        t[i] = (uint8_t)(d - i);
+    }
+}
+
+static int clamp_w(int v, int L) {
+    return v > L ? L : v < -L ? -L : v;
+}
+
+static int sig_idx(int ha, int hb) {
+    return (ha < 0) << 1 | (hb < 0);
+}
+
+/* 유닛 u 의 sigma 분포와 갱신 뒤 상태 분포. x, theta 의 비트 n 이 1 이면 -1 이다. */
+static void unit_build(mk_ctx *c, int H, uint32_t u) {
+    const int N = c->N, L = c->L, X = c->X;
+    mk_unit *m = &c->units[u];
+    uint8_t t[MK_MAX_N], s[MK_MAX_N];
+    int wa[MK_MAX_N], wb[MK_MAX_N];
+    int ha[1 << MK_MAX_N], hb[1 << MK_MAX_N];
+
+    unit_unrank(c, u, t);
+    m->synced = 1;
+    for (int n = 0; n < N; n++) {
+        wa[n] = t[n] / c->W - L;
+        wb[n] = t[n] % c->W - L;
+        if (wa[n] != wb[n]) m->synced = 0;
+        s[n] = (uint8_t)pair_type(c, wb[n], wa[n]);
+    }
+    m->swap = unit_rank(c, s);
+
+    for (int x = 0; x < X; x++) {
+        ha[x] = hb[x] = 0;
+        for (int n = 0; n < N; n++) {
+            int sx = x >> n & 1 ? -1 : 1;
+            ha[x] += wa[n] * sx;
+            hb[x] += wb[n] * sx;
+        }
+        if (!c->query) m->sig[sig_idx(ha[x], hb[x])] += 1.0 / X;
+    }
+
+    // query: 고른 x, 목표 크기 (1 .. 2H-1), 목표 부호마다 generate_query_inputs 가 |w| 별로 뒤집을 개수를 정하고,
+    // 후보 중 그 개수의 부분집합을 고르게 뽑는다. 가능한 부분집합을 모두 세어 분포를 만든다.
+    if (c->query) {
+        for (int x = 0; x < X; x++) {
+            for (int tg = 1 - 2 * H; tg <= 2 * H - 1; tg++) {
+                if (tg == 0) continue;
+                const double p0 = 0.5 / X / (2 * H - 1);
+                int d = tg - ha[x], cand[MK_MAX_L + 1] = { 0 }, need[MK_MAX_L + 1];
+                if (abs(d) <= 1) {
+                    m->sig[sig_idx(ha[x], hb[x])] += p0;
+                    continue;
+                }
+                const int up = d > 0;
+                unsigned cm = 0;
+                for (int n = 0; n < N; n++) {
+                    int pr = wa[n] * (x >> n & 1 ? -1 : 1);
+                    if (pr != 0 && (pr < 0) == up) {
+                        cm |= 1u << n;
+                        cand[abs(wa[n])]++;
+                    }
+                }
+                int left = abs(d);
+                double ways = 1;
+                for (int l = L; l >= 1; l--) {
+                    int mm = left > 1 ? (left + 1) / (2 * l) : 0;
+                    need[l] = mm < cand[l] ? mm : cand[l];
+                    left -= 2 * l * need[l];
+                    ways *= (double)binom(c, cand[l], need[l]);
+                }
+                for (unsigned f = cm;; f = (f - 1) & cm) {
+                    int got[MK_MAX_L + 1] = { 0 }, ok = 1;
+                    for (int n = 0; n < N; n++)
+                        if (f >> n & 1) got[abs(wa[n])]++;
+                    for (int l = 1; l <= L && ok; l++) ok = got[l] == need[l];
+                    if (ok) {
+                        int xf = x ^ (int)f;
+                        m->sig[sig_idx(ha[xf], hb[xf])] += p0 / ways;
+                    }
+                    if (f == 0) break;
+                }
+            }
+        }
+    }
+
+    for (int f = 1; f <= 3; f++) {
+        size_t off = ((size_t)u * 3 + f - 1) * X;
+        uint32_t *ids = c->nid + off;
+        double *ps = c->np + off;
+        int cnt = 0;
+        for (int th = 0; th < X; th++) {
+            for (int n = 0; n < N; n++) {
+                int step = c->dir * (th >> n & 1 ? -1 : 1);
+                s[n] = (uint8_t)pair_type(c, f & 1 ? clamp_w(wa[n] + step, L) : wa[n],
+                                          f & 2 ? clamp_w(wb[n] + step, L) : wb[n]);
+            }
+            uint32_t id = unit_rank(c, s);
+            int j = 0;
+            while (j < cnt && ids[j] != id) j++;
+            if (j == cnt) {
+                ids[cnt++] = id;
+                ps[j] = 0;
+            }
+            ps[j] += 1.0 / X;
+        }
+        m->cnt[f - 1] = (uint16_t)cnt;
+    }
+}
+
+typedef struct {
+    mk_ctx *c;
+    int H, id;
+    pthread_t th;
+} mk_unit_job;
+
+static void *unit_worker(void *arg) {
+    mk_unit_job *j = arg;
+    for (uint32_t u = (uint32_t)j->id; u < j->c->U; u += (uint32_t)j->c->threads) unit_build(j->c, j->H, u);
+    return NULL;
+}
+
+/* ---- 결합 상태 ---- */
+
+static int key_cmp(const uint32_t *a, const uint32_t *b, int K) {
+    for (int i = 0; i < K; i++)
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+// 유닛 순서와 (대칭이면) A/B 바꿈에 대한 대표
+static void key_canon(const mk_ctx *c, uint32_t *k) {
+    sort_u32(k, c->K);
+    if (!c->swap) return;
+    uint32_t s[MK_MAX_K];
+    for (int i = 0; i < c->K; i++) s[i] = c->units[k[i]].swap;
+    sort_u32(s, c->K);
+    if (key_cmp(s, k, c->K) < 0) memcpy(k, s, (size_t)c->K * sizeof(*k));
+}
+
+static size_t key_hash(const mk_ctx *c, const uint32_t *k) {
+    uint64_t h = 0;
+    for (int i = 0; i < c->K; i++) h = tpm_ctr64(h, k[i]);
+    return (size_t)h & c->tmask;
+}
+
+static int table_grow(mk_ctx *c) {
+    size_t size = c->tmask ? (c->tmask + 1) * 2 : 1u << 16;
+    uint32_t *t = malloc(size * sizeof(*t));
+    if (t == NULL) return -1;
+    memset(t, 0xff, size * sizeof(*t));
+    free(c->table);
+    c->table = t;
+    c->tmask = size - 1;
+    for (size_t s = 0; s < c->states; s++) {
+        size_t h = key_hash(c, c->keys + s * c->K);
+        while (t[h] != UINT32_MAX) h = (h + 1) & c->tmask;
+        t[h] = (uint32_t)s;
+    }
+    return 0;
+}
+
+/* k (대표) 의 번호. 처음 보면 새로 붙인다. 상한을 넘으면 E2BIG. */
+static int state_get(mk_ctx *c, const uint32_t *k, uint32_t *id) {
+    const int K = c->K;
+    if ((c->states + 1) * 2 > c->tmask + 1 && table_grow(c) < 0) return -1;
+
+    size_t h = key_hash(c, k);
+    for (; c->table[h] != UINT32_MAX; h = (h + 1) & c->tmask) {
+        if (key_cmp(c->keys + (size_t)c->table[h] * K, k, K) == 0) {
+            *id = c->table[h];
+            return 0;
+        }
+    }
+    if (c->states >= c->max_states) {
+        errno = E2BIG;
+        return -1;
+    }
+    if (c->states == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 1u << 15;
+        uint32_t *keys = realloc(c->keys, cap * K * sizeof(*keys));
+        if (keys != NULL) c->keys = keys;
+        uint8_t *kd = realloc(c->kind, cap);
+        if (kd != NULL) c->kind = kd;
+        double *in = realloc(c->init, cap * sizeof(*in));
+        if (in != NULL) c->init = in;
+        size_t *rp = realloc(c->rowp, (cap + 1) * sizeof(*rp));
+        if (rp != NULL) c->rowp = rp;
+        if (keys == NULL || kd == NULL || in == NULL || rp == NULL) return -1;
+        c->cap = cap;
+    }
+    size_t s = c->states++;
+    memcpy(c->keys + s * K, k, (size_t)K * sizeof(*k));
+    int synced = 1;
+    for (int i = 0; i < K; i++) synced &= c->units[k[i]].synced;
+    c->kind[s] = synced ? MK_SYNCED : MK_LIVE;
+    c->init[s] = 0;
+    c->table[h] = (uint32_t)s;
+    *id = (uint32_t)s;
+    return 1;
+}
+
+/* ---- 초기 분포: 가중치는 0 이 아닌 값에서 고르게 ---- */
+
+static double fact(int n) {
+    double f = 1;
+    for (int i = 2; i <= n; i++) f *= i;
+    return f;
+}
+
+typedef struct {
+    uint32_t *u;
+    double *p;
+    size_t n;
+} mk_init_units;
+
+static int init_rec(mk_ctx *c, const mk_init_units *iu, int depth, size_t from, uint32_t *k, double p) {
+    if (depth == c->K) {
+        // 같은 유닛이 여러 번이면 순서 있는 경우의 수 K! / (중복 수)!
+        double coef = fact(c->K);
+        for (int i = 0, run = 1; i < c->K; i++, run++) {
+            if (i + 1 == c->K || k[i + 1] != k[i]) {
+                coef /= fact(run);
+                run = 0;
+            }
+        }
+        uint32_t key[MK_MAX_K] = { 0 }, id;
+        memcpy(key, k, (size_t)c->K * sizeof(*k));
+        key_canon(c, key);
+        if (state_get(c, key, &id) < 0) return -1;
+        c->init[id] += coef * p;
+        return 0;
+    }
+    for (size_t i = from; i < iu->n; i++) {
+        k[depth] = iu->u[i];
+        if (init_rec(c, iu, depth + 1, i, k, p * iu->p[i]) < 0) return -1;
+    }
+    return 0;
+}
+
+static int init_states(mk_ctx *c) {
+    mk_init_units iu = { malloc(c->U * sizeof(uint32_t)), malloc(c->U * sizeof(double)), 0 };
+    uint32_t k[MK_MAX_K];
+    int rc = -1;
+
+    if (iu.u == NULL || iu.p == NULL) goto out;
+    // 쌍 (a, b), a, b != 0 은 (-a, -b) 와 묶여 종류 하나가 확률 2 / (2L)^2 다
+    const double q = 1.0 / (2.0 * c->L * c->L);
+    for (uint32_t u = 0; u < c->U; u++) {
+        uint8_t t[MK_MAX_N];
+        double p = fact(c->N);
+        int run = 1, ok = 1;
+        unit_unrank(c, u, t);
+        for (int n = 0; n < c->N && ok; n++) {
+            ok = t[n] / c->W != c->L && t[n] % c->W != c->L;
+            p *= q;
+            if (n + 1 == c->N || t[n + 1] != t[n]) {
+                p /= fact(run);
+                run = 1;
+            } else {
+                run++;
+            }
+        }
+        if (!ok) continue;
+        iu.u[iu.n] = u;
+        iu.p[iu.n++] = p;
+    }
+    rc = init_rec(c, &iu, 0, 0, k, 1.0);
+out:
+    free(iu.u);
+    free(iu.p);
+    return rc;
+}
+
+/* ---- 행 만들기 ---- */
+
+typedef struct {
+    mk_ent *e;
+    size_t n, cap;
+} mk_rowbuf;
+
+static int rb_push(mk_rowbuf *rb, const mk_ent *e) {
+    if (rb->n == rb->cap) {
+        size_t cap = rb->cap ? rb->cap * 2 : 4096;
+        mk_ent *p = realloc(rb->e, cap * sizeof(*p));
+        if (p == NULL) return -1;
+        rb->e = p;
+        rb->cap = cap;
+    }
+    rb->e[rb->n++] = *e;
+    return 0;
+}
+
+static int ent_cmp(const void *a, const void *b) {
+    return key_cmp(((const mk_ent *)a)->k, ((const mk_ent *)b)->k, MK_MAX_K);
+}
+
+// 갱신 패턴 pat (유닛마다 2 비트: 1 A, 2 B) 의 다음 상태를 곱으로 펼친다
+static int expand(const mk_ctx *c, const uint32_t *u, unsigned pat, int k, uint32_t *key, double p, mk_rowbuf *rb) {
+    if (k == c->K) {
+        mk_ent e = { { 0 }, p };
+        memcpy(e.k, key, (size_t)c->K * sizeof(*key));
+        key_canon(c, e.k);
+        return rb_push(rb, &e);
+    }
+    int f = (int)(pat >> (2 * k) & 3);
+    if (f == 0) {
+        key[k] = u[k];
+        return expand(c, u, pat, k + 1, key, p, rb);
+    }
+    size_t off = ((size_t)u[k] * 3 + f - 1) * c->X;
+    for (int j = 0; j < c->units[u[k]].cnt[f - 1]; j++) {
+        key[k] = c->nid[off + j];
+        if (expand(c, u, pat, k + 1, key, p * c->np[off + j], rb) < 0) return -1;
+    }
+    return 0;
+}
+
+/* 상태 s 에서 한 라운드 뒤의 분포를 rb 끝에 (키 순으로, 같은 키는 합쳐) 붙인다 */
+static int row_build(const mk_ctx *c, size_t s, mk_rowbuf *rb) {
+    const int K = c->K;
+    const uint32_t *u = c->keys + s * K;
+    double pw[1 << (2 * MK_MAX_K)], stay = 0;
+    const unsigned combos = 1u << (2 * K);
+    size_t start = rb->n;
+    uint32_t key[MK_MAX_K];
+
+    if (c->kind[s] == MK_SYNCED) return 0;
+    memset(pw, 0, combos * sizeof(*pw));
+
+    for (unsigned cb = 0; cb < combos; cb++) {
+        double p = 1;
+        int negA = 0, negB = 0;
+        for (int k = 0; k < K && p > 0; k++) {
+            unsigned d = cb >> (2 * k) & 3;
+            p *= c->units[u[k]].sig[d];
+            negA ^= d >> 1;
+            negB ^= d & 1;
+        }
+        if (p == 0) continue;
+        if (negA != negB) {
+            stay += p;
+            continue;
+        }
+        unsigned pat = 0;
+        for (int k = 0; k < K; k++) {
+            unsigned d = cb >> (2 * k) & 3;
+            pat |= (unsigned)(((d >> 1) == (unsigned)negA) | ((d & 1) == (unsigned)negB) << 1) << (2 * k);
+        }
+        if (pat == 0) stay += p;
+        else pw[pat] += p;
+    }
+
+    for (unsigned pat = 1; pat < combos; pat++)
+        if (pw[pat] > 0 && expand(c, u, pat, 0, key, pw[pat], rb) < 0) return -1;
+    if (stay > 0) {
+        mk_ent e = { { 0 }, stay };
+        memcpy(e.k, u, (size_t)K * sizeof(*u));
+        if (rb_push(rb, &e) < 0) return -1;
+    }
+
+    qsort(rb->e + start, rb->n - start, sizeof(*rb->e), ent_cmp);
+    size_t w = start;
+    for (size_t i = start; i < rb->n; i++) {
+        if (w > start && ent_cmp(&rb->e[w - 1], &rb->e[i]) == 0) rb->e[w - 1].p += rb->e[i].p;
+        else rb->e[w++] = rb->e[i];
+    }
+    rb->n = w;
+    return 0;
+}
+
+typedef struct {
+    const mk_ctx *c;
+    size_t from, to;
+    mk_rowbuf rb;
+    size_t *len;        // 행마다 항 수
+    int err;
+    pthread_t th;
+} mk_row_job;
+
+static void *row_worker(void *arg) {
+    mk_row_job *j = arg;
+    for (size_t s = j->from; s < j->to; s++) {
+        size_t before = j->rb.n;
+        if (row_build(j->c, s, &j->rb) < 0) {
+            j->err = 1;
+            break;
+        }
+        j->len[s - j->from] = j->rb.n - before;
+    }
+    return NULL;
+}
+
+static int csr_push(mk_ctx *c, uint32_t col, double val) {
+    if (c->nnz == c->nnz_cap) {
+        size_t cap = c->nnz_cap ? c->nnz_cap * 2 : 1u << 20;
+        uint32_t *cl = realloc(c->col, cap * sizeof(*cl));
+        if (cl != NULL) c->col = cl;
+        double *v = realloc(c->val, cap * sizeof(*v));
+        if (v != NULL) c->val = v;
+        if (cl == NULL || v == NULL) return -1;
+        c->nnz_cap = cap;
+    }
+    c->col[c->nnz] = col;
+    c->val[c->nnz++] = val;
+    return 0;
+}
+
+/* 도달한 상태가 더 없을 때까지 묶음마다 스레드로 행을 만들고, 새 상태는 순서대로 번호를 붙인다 */
+static int build_rows(mk_ctx *c) {
+    mk_row_job *jobs = calloc((size_t)c->threads, sizeof(*jobs));
+    size_t done = 0;
+    int rc = 0;
+
+    if (jobs == NULL) return -1;
+    for (int t = 0; t < c->threads; t++) {
+        jobs[t].c = c;
+        jobs[t].len = malloc(MK_BATCH * sizeof(size_t));
+        if (jobs[t].len == NULL) rc = -1;
+    }
+    c->rowp[0] = 0;
+    while (rc == 0 && done < c->states) {
+        size_t end = c->states - done > (size_t)MK_BATCH * c->threads ? done + (size_t)MK_BATCH * c->threads : c->states;
+        size_t per = (end - done + c->threads - 1) / c->threads;
+        int started = 0;
+
+        for (int t = 0; t < c->threads; t++) {
+            mk_row_job *j = &jobs[t];
+            j->from = done + per * t < end ? done + per * t : end;
+            j->to = j->from + per < end ? j->from + per : end;
+            j->rb.n = 0;
+            j->err = 0;
+            if (t > 0 && pthread_create(&j->th, NULL, row_worker, j) != 0) {
+                rc = -1;
+                break;
+            }
+            started = t + 1;
+        }
+        if (started > 0) row_worker(&jobs[0]);
+        for (int t = 1; t < started; t++) pthread_join(jobs[t].th, NULL);
+
+        // 번호 붙이기는 한 스레드가 행 순서대로 한다 (상태 번호가 스레드 수와 상관없다)
+        for (int t = 0; t < started && rc == 0; t++) {
+            mk_row_job *j = &jobs[t];
+            const mk_ent *e = j->rb.e;
+            if (j->err) rc = -1;
+            for (size_t s = j->from; s < j->to && rc == 0; s++) {
+                for (size_t i = 0; i < j->len[s - j->from] && rc == 0; i++, e++) {
+                    uint32_t id;
+                    if (state_get(c, e->k, &id) < 0 || csr_push(c, id, e->p) < 0) rc = -1;
+                }
+                c->rowp[s + 1] = c->nnz;
+            }
+        }
+        done = end;
+    }
+    for (int t = 0; t < c->threads; t++) {
+        free(jobs[t].rb.e);
+        free(jobs[t].len);
+    }
+    free(jobs);
+    return rc;
+}
+
+/* ---- 라운드마다 확률 벡터 곱하기 ---- */
+
+typedef struct {
+    const mk_ctx *c;
+    size_t *cp;                 // CSC: 열 j 의 항은 cp[j] .. cp[j+1]-1
+    uint32_t *ri;
+    double *cv;
+    double *cur, *nxt;
+    double part[2][MK_CHUNKS][3];   // 라운드 홀짝마다 조각별 (동기화, 갇힘, 남음)
+    pthread_barrier_t bar;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int go;                     // -1 스레드를 띄우는 중, 1 시작, 0 그만
+    int nthreads;               // 실제로 띄운 스레드 수 (배리어 크기)
+    uint32_t max_rounds;
+    double eps;
+    tpm_markov_result *res;
+} mk_solve;
+
+typedef struct {
+    mk_solve *sv;
+    int id;
+    pthread_t th;
+} mk_solve_thread;
+
+static void *solve_worker(void *arg) {
+    mk_solve_thread *me = arg;
+    mk_solve *sv = me->sv;
+    const mk_ctx *c = sv->c;
+    double *cur = sv->cur, *nxt = sv->nxt;
+
+    pthread_mutex_lock(&sv->lock);
+    while (sv->go < 0) pthread_cond_wait(&sv->cond, &sv->lock);
+    pthread_mutex_unlock(&sv->lock);
+    if (sv->go == 0) return NULL;
+
+    for (uint32_t r = 1;; r++) {
+        const int par = r & 1;
+        for (int ch = me->id; ch < MK_CHUNKS; ch += sv->nthreads) {
+            size_t from = c->states * ch / MK_CHUNKS, to = c->states * (ch + 1) / MK_CHUNKS;
+            double sum[3] = { 0 };
+            for (size_t j = from; j < to; j++) {
+                double q = 0;
+                for (size_t e = sv->cp[j]; e < sv->cp[j + 1]; e++) q += sv->cv[e] * cur[sv->ri[e]];
+                if (c->kind[j] == MK_LIVE && q < 1e-300) q = 0;    // 비정규 수는 곱셈이 몇십 배 느리다
+                sum[c->kind[j] == MK_SYNCED ? 0 : c->kind[j] == MK_DEAD ? 1 : 2] += q;
+                nxt[j] = c->kind[j] == MK_LIVE ? q : 0;
+            }
+            memcpy(sv->part[par][ch], sum, sizeof(sum));
+        }
+        pthread_barrier_wait(&sv->bar);
+
+        // 모든 스레드가 같은 순서로 더해 같은 값을 보고 같은 라운드에 멈춘다
+        double sum[3] = { 0 };
+        for (int ch = 0; ch < MK_CHUNKS; ch++)
+            for (int i = 0; i < 3; i++) sum[i] += sv->part[par][ch][i];
+        double *t = cur;
+        cur = nxt;
+        nxt = t;
+        if (me->id == 0) {
+            sv->res->p[r] += sum[0];
+            sv->res->never += sum[1];
+            sv->res->rounds = r;
+            sv->res->tail = sum[2] + sv->res->never;
+        }
+        if (sum[2] < sv->eps || r >= sv->max_rounds) break;
+    }
+    return NULL;
+}
+
+static int solve(mk_ctx *c, uint32_t max_rounds, double eps, tpm_markov_result *res) {
+    mk_solve *sv = calloc(1, sizeof(*sv));
+    mk_solve_thread *th = calloc((size_t)c->threads, sizeof(*th));
+    int rc = -1, started = 0;
+
+    if (sv == NULL || th == NULL) goto out;
+    sv->c = c;
+    sv->max_rounds = max_rounds;
+    sv->eps = eps;
+    sv->res = res;
+    sv->cp = calloc(c->states + 1, sizeof(*sv->cp));
+    sv->ri = malloc((c->nnz ? c->nnz : 1) * sizeof(*sv->ri));
+    sv->cv = malloc((c->nnz ? c->nnz : 1) * sizeof(*sv->cv));
+    sv->cur = malloc(c->states * sizeof(*sv->cur));
+    sv->nxt = malloc(c->states * sizeof(*sv->nxt));
+    res->p = calloc((size_t)max_rounds + 1, sizeof(*res->p));
+    if (sv->cp == NULL || sv->ri == NULL || sv->cv == NULL || sv->cur == NULL || sv->nxt == NULL || res->p == NULL)
+        goto out;
+
+    // CSR → CSC (열마다 행 번호 순)
+    for (size_t e = 0; e < c->nnz; e++) sv->cp[c->col[e] + 1]++;
+    for (size_t j = 0; j < c->states; j++) sv->cp[j + 1] += sv->cp[j];
+    for (size_t s = 0; s < c->states; s++) {
+        for (size_t e = c->rowp[s]; e < c->rowp[s + 1]; e++) {
+            size_t at = sv->cp[c->col[e]]++;
+            sv->ri[at] = (uint32_t)s;
+            sv->cv[at] = c->val[e];
+        }
+    }
+    for (size_t j = c->states; j > 0; j--) sv->cp[j] = sv->cp[j - 1];
+    sv->cp[0] = 0;
+
+    // 동기화 상태에서 거꾸로 닿지 않는 상태는 영영 동기화되지 않는다 (예: 2/2/1 의 일부).
+    // 그리로 간 확률은 never 로 빼서 남은 확률이 eps 아래로 내려가게 한다.
+    uint32_t *queue = malloc(c->states * sizeof(*queue));
+    size_t qh = 0, qt = 0;
+    if (queue == NULL) goto out;
+    for (size_t s = 0; s < c->states; s++) {
+        if (c->kind[s] == MK_SYNCED) queue[qt++] = (uint32_t)s;
+        else c->kind[s] = MK_DEAD;
+    }
+    while (qh < qt) {
+        uint32_t j = queue[qh++];
+        for (size_t e = sv->cp[j]; e < sv->cp[j + 1]; e++) {
+            if (c->kind[sv->ri[e]] != MK_DEAD) continue;
+            c->kind[sv->ri[e]] = MK_LIVE;
+            queue[qt++] = sv->ri[e];
+        }
+    }
+    free(queue);
+
+    // 처음부터 같은 가중치면 첫 라운드에 동기화된 것으로 센다 (sim.c 와 같다)
+    double live = 0;
+    for (size_t s = 0; s < c->states; s++) {
+        sv->cur[s] = c->kind[s] == MK_LIVE ? c->init[s] : 0;
+        if (c->kind[s] == MK_SYNCED) res->p[1] += c->init[s];
+        else if (c->kind[s] == MK_DEAD) res->never += c->init[s];
+        else live += c->init[s];
+    }
+    res->tail = live + res->never;
+    if (live < eps) {
+        res->rounds = 1;
+        rc = 0;
+        goto out;
+    }
+
+    // 띄운 스레드 수를 안 뒤에 배리어를 만든다. 몇 개 못 띄워도 남은 스레드가 조각을 나눠 맡는다.
+    sv->go = -1;
+    pthread_mutex_init(&sv->lock, NULL);
+    pthread_cond_init(&sv->cond, NULL);
+    for (int t = 0; t < c->threads; t++) {
+        th[t].sv = sv;
+        th[t].id = t;
+    }
+    for (started = 1; started < c->threads; started++)
+        if (pthread_create(&th[started].th, NULL, solve_worker, &th[started]) != 0) break;
+    sv->nthreads = started;
+    int ok = pthread_barrier_init(&sv->bar, NULL, (unsigned)started) == 0;
+    pthread_mutex_lock(&sv->lock);
+    sv->go = ok;
+    pthread_cond_broadcast(&sv->cond);
+    pthread_mutex_unlock(&sv->lock);
+    if (ok) {
+        solve_worker(&th[0]);
+        rc = 0;
+    }
+    for (int t = 1; t < started; t++) pthread_join(th[t].th, NULL);
+    if (ok) pthread_barrier_destroy(&sv->bar);
+    pthread_mutex_destroy(&sv->lock);
+    pthread_cond_destroy(&sv->cond);
+out:
+    if (sv != NULL) {
+        free(sv->cp);
+        free(sv->ri);
+        free(sv->cv);
+        free(sv->cur);
+        free(sv->nxt);
+    }
+    free(sv);
+    free(th);
+    return rc;
+}
+
+/* ---- 공개 함수 ---- */
+
+static double choose(double n, int k) {
+    double r = 1;
+    for (int i = 1; i <= k; i++) r = r * (n - k + i) / i;
+    return r;
+}
+
+/* 위치와 유닛 대칭으로 줄인 결합 상태 수 (도달하지 않는 상태도 센다). A/B 바꿈까지 쓰면 절반 남짓이다. */
+double tpm_markov_space(const tpm_markov_cfg *cfg) {
+    const int W = 2 * cfg->shape.L + 1;
+    double units = choose((W * W + 1) / 2 + cfg->shape.N - 1, cfg->shape.N);
+    return choose(units + cfg->shape.K - 1, cfg->shape.K);
+}
+
+static void ctx_free(mk_ctx *c) {
+    free(c->binom);
+    free(c->units);
+    free(c->nid);
+    free(c->np);
+    free(c->keys);
+    free(c->kind);
+    free(c->init);
+    free(c->table);
+    free(c->rowp);
+    free(c->col);
+    free(c->val);
+}
+
+/*
+ * cfg 의 구조에서 동기화까지의 라운드 분포를 구한다. res->p 는 tpm_markov_free 로 놓는다.
+ * 구조가 너무 크면 (유닛 상태 2^22 개 또는 결합 상태 max_states 개 초과) -1, errno = E2BIG.
+ */
+int tpm_markov_solve(const tpm_markov_cfg *cfg, tpm_markov_result *res) {
+    mk_ctx c = { 0 };
+    int rc = -1;
+
+    memset(res, 0, sizeof(*res));
+    if (!tpm_shape_valid(&cfg->shape) || cfg->shape.K > MK_MAX_K || cfg->shape.N > MK_MAX_N || cfg->shape.L > MK_MAX_L) {
+        errno = EINVAL;
+        return -1;
+    }
+    c.K = cfg->shape.K;
+    c.N = cfg->shape.N;
+    c.L = cfg->shape.L;
+    c.W = 2 * c.L + 1;
+    c.X = 1 << c.N;
+    c.dir = tpm_rule_get(cfg->rule)->dir;
+    c.query = cfg->rule == RULE_QUERY;
+    c.swap = !c.query;
+    c.threads = cfg->threads > 0 ? cfg->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (c.threads < 1) c.threads = 1;
+    c.max_states = cfg->max_states ? cfg->max_states : TPM_MARKOV_MAX_STATES;
+    if (c.max_states > UINT32_MAX - 1) c.max_states = UINT32_MAX - 1;
+
+    double units = choose((c.W * c.W + 1) / 2 + c.N - 1, c.N);
+    if (units > MK_MAX_UNITS) {
+        errno = E2BIG;
+        return -1;
+    }
+    c.U = (uint32_t)units;
+
+    // 파스칼 삼각형 (n <= 종류 수 + N)
+    const int top = (c.W * c.W + 1) / 2 + c.N;
+    c.binom = calloc((size_t)(top + 1) * (c.N + 1), sizeof(*c.binom));
+    c.units = calloc(c.U, sizeof(*c.units));
+    c.nid = malloc((size_t)c.U * 3 * c.X * sizeof(*c.nid));
+    c.np = malloc((size_t)c.U * 3 * c.X * sizeof(*c.np));
+    if (c.binom == NULL || c.units == NULL || c.nid == NULL || c.np == NULL) goto out;
+    for (int n = 0; n <= top; n++) {
+        c.binom[(size_t)n * (c.N + 1)] = 1;
+        for (int k = 1; k <= c.N && k <= n; k++)
+            c.binom[(size_t)n * (c.N + 1) + k] = binom(&c, n - 1, k - 1) + binom(&c, n - 1, k);
+    }
+
+    // 유닛 표는 서로 독립이라 스레드로 나눠 만든다
+    {
+        mk_unit_job *jobs = calloc((size_t)c.threads, sizeof(*jobs));
+        int started = 0;
+        if (jobs == NULL) goto out;
+        for (int t = 0; t < c.threads; t++) {
+            jobs[t] = (mk_unit_job){ &c, cfg->H > 0 ? cfg->H : tpm_query_H(&cfg->shape), t, 0 };
+            if (t > 0 && pthread_create(&jobs[t].th, NULL, unit_worker, &jobs[t]) != 0) break;
+            started = t + 1;
+        }
+        // 띄우지 못한 스레드 몫은 여기서 돈다
+        for (int t = 0; t < c.threads; t++)
+            if (t == 0 || t >= started) unit_worker(&jobs[t]);
+        for (int t = 1; t < started; t++) pthread_join(jobs[t].th, NULL);
+        free(jobs);
+    }
+
+    res->unit_states = c.U;
+    if (init_states(&c) < 0 || build_rows(&c) < 0) goto out;
+    res->states = c.states;
+    res->nnz = c.nnz;
+    // 행을 다 만들었으면 해시는 필요 없다
+    free(c.table);
+    c.table = NULL;
+
+    rc = solve(&c, cfg->max_rounds ? cfg->max_rounds : TPM_SIM_MAX_ROUNDS, cfg->eps, res);
+out:
+    if (rc < 0) {
+        int e = errno;
+        res->states = c.states;
+        free(res->p);
+        res->p = NULL;
+        errno = e;
+    }
+    ctx_free(&c);
+    return rc;
+}
+
+static double synced_mass(const tpm_markov_result *res) {
+    double s = 0;
+    for (uint32_t r = 1; r <= res->rounds; r++) s += res->p[r];
+    return s;
+}
+
+/* 동기화된 경우의 평균 라운드 (tpmsim 의 rounds 와 같은 조건부) */
+double tpm_markov_mean(const tpm_markov_result *res) {
+    double s = synced_mass(res), m = 0;
+    for (uint32_t r = 1; r <= res->rounds; r++) m += (double)r * res->p[r];
+    return s > 0 ? m / s : 0.0;
+}
+
+double tpm_markov_sd(const tpm_markov_result *res) {
+    double s = synced_mass(res), mean = tpm_markov_mean(res), v = 0;
+    for (uint32_t r = 1; r <= res->rounds; r++) v += ((double)r - mean) * ((double)r - mean) * res->p[r];
+    return s > 0 ? sqrt(v / s) : 0.0;
+}
+
+/* 동기화된 경우의 q 분위: 조건부 누적 확률이 q 이상이 되는 가장 작은 라운드 */
+uint32_t tpm_markov_quantile(const tpm_markov_result *res, double q) {
+    double s = synced_mass(res), cum = 0;
+    for (uint32_t r = 1; r <= res->rounds; r++) {
+        cum += res->p[r];
+        if (cum >= q * s) return r;
+    }
+    return res->rounds;
+}
+
+void tpm_markov_free(tpm_markov_result *res) {
+    free(res->p);
+    memset(res, 0, sizeof(*res));
+}
@@ -0,0 +1,61 @@
+#include "tpm.h"
+
+void ErrorHandling(const char *msg) {
+    perror(msg);
+    exit(1);
+}
+
+int send_all(int sock, const void *buf, size_t len) {
+    size_t total_sent = 0;
+    while (total_sent < len) {
+        ssize_t n = send(sock, (const char *)buf + total_sent, len - total_sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("send_all");
+            return -1;
+        }
+        if (n == 0) return 0;
+        total_sent += n;
+    }
+    return 1;
+}
+
+int recv_all(int sock, void *buf, size_t len) {
+    size_t total_rcvd = 0;
+    while (total_rcvd < len) {
+        ssize_t n = recv(sock, (char *)buf + total_rcvd, len - total_rcvd, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("recv_all");
+            return -1;
+        }
+        if (n == 0) return 0;
+        total_rcvd += n;
+    }
+    return 1;
+}
+
+/*
+ * SO_REUSEPORT 로 여는 listen 소켓. 같은 주소에 워커마다 소켓을 하나씩 열면
+ * 커널이 새 연결을 소켓들에 나눠 준다. addr 의 포트가 0 이면 커널이 고른다.
+ */
+int tpm_listen_tcp(const struct sockaddr_in *addr, int backlog) {
+    int on = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 ||
+        bind(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* tpm_listen_tcp 로 연 소켓과 같은 주소·포트에 소켓을 하나 더 연다 */
+int tpm_listen_again(int listen_fd, int backlog) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(listen_fd, (struct sockaddr *)&addr, &len) < 0) return -1;
+    return tpm_listen_tcp(&addr, backlog);
+}
@@ -0,0 +1,274 @@
+#include "tpm.h"
+
+/*
+ * 비트 패킹 표현.
+ *   입력/theta : hidden unit 한 줄의 N 개 ±1 을 64비트 워드에 1비트씩 (bit=1 이 +1)
+ *   가중치     : 부호 평면 1장 (bit=1 이 음수) + |w| 의 비트 평면 planes 장
+ * 곱 w·x 의 부호는 (부호비트 XOR 입력비트) 로, 크기는 |w| 평면으로 구해지므로
+ *   Σ w·x = Σ_b 2^b · (2·popcount(m_b & d) - popcount(m_b)),   d = sign ^ x
+ * 가 되어 한 명령에 64개 입력을 처리한다. |w| = 0 인 자리의 부호비트는 항상 0 으로 유지한다.
+ */
+
+#if defined(__x86_64__) && defined(__gnu_linux__)
+#define TPM_POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define TPM_POPCNT_CLONES
+#endif
+
+struct tpm_packed {
+    int words;          // hidden unit 당 64비트 워드 수
+    int planes;         // |w| 비트 평면 수 (L 의 비트 길이)
+    uint64_t *sign;     // [K][words]
+    uint64_t *mag;      // [K][planes][words]
+    uint64_t *scratch;  // int8 입력을 받았을 때 패킹해 둘 자리 [K][words]
+    int dirty;          // 평면이 tpm->weights 보다 새로움
+};
+
+int tpm_bits_words(int N) {
+    return (N + 63) / 64;
+}
+
+size_t tpm_bits_len(const tpm_shape *shape) {
+    return (size_t)shape->K * tpm_bits_words(shape->N);
+}
+
+uint64_t *tpm_alloc_bits(const tpm_shape *shape) {
+    return calloc(tpm_bits_len(shape), sizeof(uint64_t));
+}
+
+static inline uint64_t tail_mask(int N) {
+    return (N & 63) ? (1ULL << (N & 63)) - 1 : ~0ULL;
+}
+
+void tpm_pack_bits(const tpm_shape *shape, const int8_t *v, uint64_t *bits) {
+    const int W = tpm_bits_words(shape->N);
+    memset(bits, 0, tpm_bits_len(shape) * sizeof(uint64_t));
+    for (int k = 0; k < shape->K; k++) {
+        const int8_t *row = v + (size_t)k * shape->N;
+        uint64_t *out = bits + (size_t)k * W;
+        for (int n = 0; n < shape->N; n++)
+            out[n >> 6] |= (uint64_t)(row[n] > 0) << (n & 63);
+    }
+}
+
+void tpm_unpack_bits(const tpm_shape *shape, const uint64_t *bits, int8_t *v) {
+    const int W = tpm_bits_words(shape->N);
+    for (int k = 0; k < shape->K; k++) {
+        const uint64_t *in = bits + (size_t)k * W;
+        int8_t *row = v + (size_t)k * shape->N;
+        for (int n = 0; n < shape->N; n++)
+            row[n] = (int8_t)((int)((in[n >> 6] >> (n & 63)) & 1) * 2 - 1);
+    }
+}
+
+void generate_input_bits(const tpm_shape *shape, uint64_t *bits) {
+    const int W = tpm_bits_words(shape->N);
+    const uint64_t last = tail_mask(shape->N);
+    for (int k = 0; k < shape->K; k++) {
+        for (int w = 0; w < W; w++)
+            bits[(size_t)k * W + w] = tpm_rand64();
+        bits[(size_t)k * W + W - 1] &= last;
+    }
+}
+
+static void packed_load(tpm_packed *p, const tpm_shape *shape, const int8_t *weights) {
+    const int W = p->words, P = p->planes;
+    memset(p->sign, 0, (size_t)shape->K * W * sizeof(uint64_t));
+    memset(p->mag, 0, (size_t)shape->K * P * W * sizeof(uint64_t));
+    for (int k = 0; k < shape->K; k++) {
+        for (int n = 0; n < shape->N; n++) {
+            int v = weights[(size_t)k * shape->N + n];
+            int a = abs(v);
+            uint64_t bit = 1ULL << (n & 63);
+            if (v < 0) p->sign[(size_t)k * W + (n >> 6)] |= bit;
+            for (int b = 0; b < P; b++)
+                if ((a >> b) & 1) p->mag[((size_t)k * P + b) * W + (n >> 6)] |= bit;
+        }
+    }
+    p->dirty = 0;
+}
+
+static void packed_store(const tpm_packed *p, const tpm_shape *shape, int8_t *weights) {
+    const int W = p->words, P = p->planes;
+    for (int k = 0; k < shape->K; k++) {
+        for (int n = 0; n < shape->N; n++) {
+            int sh = n & 63, w = n >> 6, a = 0;
+            for (int b = 0; b < P; b++)
+                a |= (int)((p->mag[((size_t)k * P + b) * W + w] >> sh) & 1) << b;
+            int neg = (int)((p->sign[(size_t)k * W + w] >> sh) & 1);
+            weights[(size_t)k * shape->N + n] = (int8_t)(neg ? -a : a);
+        }
+    }
+}
+
+int tpm_enable_packed(TPM *tpm) {
+    if (tpm->packed != NULL) return 0;
+
+    tpm_packed *p = calloc(1, sizeof(*p));
+    if (p == NULL) return -1;
+    p->words = tpm_bits_words(tpm->shape.N);
+    while ((1 << p->planes) <= tpm->shape.L) p->planes++;
+    p->sign = tpm_alloc_bits(&tpm->shape);
+    p->scratch = tpm_alloc_bits(&tpm->shape);
+    p->mag = calloc(tpm_bits_len(&tpm->shape) * p->planes, sizeof(uint64_t));
+    if (p->sign == NULL || p->scratch == NULL || p->mag == NULL) {
+        tpm_packed_free(p);
+        return -1;
+    }
+
+    packed_load(p, &tpm->shape, tpm->weights);
+    tpm->packed = p;
+    return 0;
+}
+
+void tpm_packed_free(tpm_packed *p) {
+    if (p == NULL) return;
+    free(p->sign);
+    free(p->mag);
+    free(p->scratch);
+    free(p);
+}
+
+void tpm_sync_weights(TPM *tpm) {
+    if (tpm->packed != NULL && tpm->packed->dirty) {
+        packed_store(tpm->packed, &tpm->shape, tpm->weights);
+        tpm->packed->dirty = 0;
+    }
+}
+
+/* planes 는 L=1(1장), L=2..3(2장), L=4..7(3장) 에 대해 상수로 특수화된다 */
+static inline __attribute__((always_inline))
+void packed_calc_tau_planes(TPM *tpm, const uint64_t *x, const int P) {
+    const tpm_packed *p = tpm->packed;
+    const int W = p->words;
+    unsigned neg = 0;
+
+    for (int k = 0; k < tpm->shape.K; k++) {
+        const uint64_t *s = p->sign + (size_t)k * W;
+        const uint64_t *m = p->mag + (size_t)k * P * W;
+        const uint64_t *xk = x + (size_t)k * W;
+        long field = 0;
+
+        for (int w = 0; w < W; w++) {
+            uint64_t d = s[w] ^ xk[w];  // 1 이면 w·x > 0
+            for (int b = 0; b < P; b++) {
+                uint64_t mb = m[b * W + w];
+                field += (long)(2 * __builtin_popcountll(mb & d) - __builtin_popcountll(mb)) << b;
+            }
+        }
+        tpm->sigma[k] = sgn((int)field);
+        neg += field < 0;
+    }
+    tpm->tau = (neg & 1) ? -1 : 1;  // 음수인 sigma 개수의 홀짝이 곧 tau
+}
+
+TPM_POPCNT_CLONES
+static void packed_calc_tau(TPM *tpm, const uint64_t *x) {
+    switch (tpm->packed->planes) {
+    case 1:  packed_calc_tau_planes(tpm, x, 1); break;
+    case 2:  packed_calc_tau_planes(tpm, x, 2); break;
+    case 3:  packed_calc_tau_planes(tpm, x, 3); break;
+    default: packed_calc_tau_planes(tpm, x, tpm->packed->planes); break;
+    }
+}
+
+/*
+ * 비트 평면 위의 w = clamp(w + δ, -L, L)  (δ = dir·theta = ±1)
+ *   |w| 가 0 이거나 부호가 δ 와 같으면 |w| + 1 (|w| == L 이면 그대로), 아니면 |w| - 1
+ * 증가/감소는 평면을 따라 carry/borrow 를 전파하는 비트 덧셈으로 처리한다.
+ */
+static inline __attribute__((always_inline))
+void packed_update_planes(TPM *tpm, const uint64_t *theta, const int dir, const int P) {
+    tpm_packed *p = tpm->packed;
+    const int W = p->words, L = tpm->shape.L;
+    const uint64_t last = tail_mask(tpm->shape.N);
+
+    for (int k = 0; k < tpm->shape.K; k++) {
+        if (tpm->sigma[k] != tpm->tau) continue;
+        uint64_t *s = p->sign + (size_t)k * W;
+        uint64_t *m = p->mag + (size_t)k * P * W;
+        const uint64_t *t = theta + (size_t)k * W;
+
+        for (int w = 0; w < W; w++) {
+            const uint64_t valid = (w == W - 1) ? last : ~0ULL;
+            const uint64_t up = dir > 0 ? t[w] : ~t[w];  // 1 이면 δ = +1
+            uint64_t nz = 0, eq_l = ~0ULL;
+            for (int b = 0; b < P; b++) {
+                uint64_t mb = m[b * W + w];
+                nz |= mb;
+                eq_l &= ((L >> b) & 1) ? mb : ~mb;
+            }
+            const uint64_t away = ~nz | (s[w] ^ up);  // |w| 가 커지는 방향
+            const uint64_t inc = away & ~eq_l & valid;
+            const uint64_t dec = ~away & valid;
+
+            s[w] = (s[w] & ~(~nz & inc)) | (~up & ~nz & inc);
+
+            uint64_t carry = inc, borrow = dec, nz_after = 0;
+            for (int b = 0; b < P; b++) {
+                uint64_t mb = m[b * W + w];
+                uint64_t c = mb & carry;
+                uint64_t r = ~mb & borrow;
+                mb ^= carry ^ borrow;
+                carry = c;
+                borrow = r;
+                m[b * W + w] = mb;
+                nz_after |= mb;
+            }
+            s[w] &= nz_after;
+        }
+    }
+    p->dirty = 1;
+}
+
+static inline __attribute__((always_inline))
+void packed_update_dir(TPM *tpm, const uint64_t *theta, const int dir) {
+    switch (tpm->packed->planes) {
+    case 1:  packed_update_planes(tpm, theta, dir, 1); break;
+    case 2:  packed_update_planes(tpm, theta, dir, 2); break;
+    case 3:  packed_update_planes(tpm, theta, dir, 3); break;
+    default: packed_update_planes(tpm, theta, dir, tpm->packed->planes); break;
+    }
+}
+
+static void packed_update_fwd(TPM *tpm, const uint64_t *theta) {
+    packed_update_dir(tpm, theta, 1);
+}
+
+static void packed_update_rev(TPM *tpm, const uint64_t *theta) {
+    packed_update_dir(tpm, theta, -1);
+}
+
+/*
+ * 비트 입력용 진입점. 패킹된 TPM 이면 평면 커널을 바로 쓰고,
+ * int8 TPM 이면 scratch 에 풀어서 int8 커널로 넘긴다.
+ */
+void calculate_tau_bits(TPM *tpm, const uint64_t *x) {
+    if (tpm->packed != NULL) {
+        packed_calc_tau(tpm, x);
+    } else {
+        tpm_unpack_bits(&tpm->shape, x, tpm->scratch);
+        tpm->kern->calc_tau(tpm, tpm->scratch);
+    }
+}
+
+void update_weights_bits(TPM *tpm, const uint64_t *theta) {
+    if (tpm->packed != NULL) {
+        if (tpm->ops->dir > 0) packed_update_fwd(tpm, theta);
+        else packed_update_rev(tpm, theta);
+    } else {
+        tpm_unpack_bits(&tpm->shape, theta, tpm->scratch);
+        tpm->update(tpm, tpm->scratch);
+    }
+}
+
+/* int8 입력이 패킹된 TPM 으로 들어오면 한 번 패킹해서 평면 커널로 넘긴다 */
+void packed_calc_tau_i8(TPM *tpm, const int8_t *x) {
+    tpm_pack_bits(&tpm->shape, x, tpm->packed->scratch);
+    packed_calc_tau(tpm, tpm->packed->scratch);
+}
+
+void packed_update_i8(TPM *tpm, const int8_t *theta) {
+    tpm_pack_bits(&tpm->shape, theta, tpm->packed->scratch);
+    update_weights_bits(tpm, tpm->packed->scratch);
+}
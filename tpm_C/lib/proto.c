@@ -0,0 +1,278 @@
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "tpm.h"
+
+/*
+ * 프레임 형식 (모든 정수는 big endian)
+ *   [0]     version
+ *   [1]     type       (TPM_MSG_*)
+ *   [2..3]  flags      (TPM_F_*, tau 부호 등)
+ *   [4..7]  round
+ *   [8..11] payload 길이
+ * 비트 벡터는 hidden unit 마다 ceil(N/8) 바이트, 입력 n 은 바이트 n/8 의 비트 n%8 이다.
+ * 호스트의 구조체 배치나 엔디안과 무관하다.
+ */
+
+#define TPM_MAX_PAYLOAD (16u << 20)     // max_payload 기본값 (클라이언트가 받는 INPUTS 묶음)
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+void tpm_put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, (uint32_t)(v >> 32));
+    put_u32(p + 4, (uint32_t)v);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+uint64_t tpm_get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) << 32 | get_u32(p + 4);
+}
+
+int tpm_conn_init(tpm_conn *c, int fd) {
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->rcap = 4096;
+    c->max_payload = TPM_MAX_PAYLOAD;
+    c->rbuf = malloc(c->rcap);
+    if (c->rbuf == NULL) return -1;
+
+    // 한 라운드 = 작은 프레임 하나이므로 Nagle 로 묶일 이유가 없다
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return 0;
+}
+
+void tpm_conn_free(tpm_conn *c) {
+    free(c->rbuf);
+    free(c->wbuf);
+    c->rbuf = NULL;
+    c->wbuf = NULL;
+}
+
+/* 프레임 하나를 wbuf 뒤에 붙인다. 실제 전송은 tpm_conn_flush 에서 한 번에 한다. */
+int tpm_conn_queue(tpm_conn *c, const tpm_msg_hdr *h, const void *payload, size_t len) {
+    size_t need = c->wlen + TPM_HDR_SIZE + len;
+    if (need > c->wcap) {
+        // 앞쪽의 이미 보낸 부분을 먼저 치운다
+        if (c->wpos > 0) {
+            memmove(c->wbuf, c->wbuf + c->wpos, c->wlen - c->wpos);
+            c->wlen -= c->wpos;
+            c->wpos = 0;
+            need = c->wlen + TPM_HDR_SIZE + len;
+        }
+        if (need > c->wcap) {
+            size_t cap = c->wcap ? c->wcap : 256;
+            while (cap < need) cap *= 2;
+            uint8_t *nb = realloc(c->wbuf, cap);
+            if (nb == NULL) return -1;
+            c->wbuf = nb;
+            c->wcap = cap;
+        }
+    }
+
+    uint8_t *p = c->wbuf + c->wlen;
+    p[0] = TPM_PROTO_VERSION;
+    p[1] = h->type;
+    put_u16(p + 2, h->flags);
+    put_u32(p + 4, h->round);
+    put_u32(p + 8, (uint32_t)len);
+    if (len > 0) memcpy(p + TPM_HDR_SIZE, payload, len);
+    c->wlen += TPM_HDR_SIZE + len;
+    return 0;
+}
+
+/*
+ * 쌓인 프레임을 보낸다. 보통 send 한 번이면 끝난다.
+ * 1: 다 보냄, TPM_AGAIN: 소켓 버퍼가 차서 남음 (논블로킹), -1: 오류
+ */
+int tpm_conn_flush(tpm_conn *c) {
+    while (c->wpos < c->wlen) {
+        ssize_t n = send(c->fd, c->wbuf + c->wpos, c->wlen - c->wpos, MSG_NOSIGNAL);
+        c->syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return TPM_AGAIN;
+            return -1;
+        }
+        c->wpos += n;
+        c->bytes_out += n;
+    }
+    c->wpos = c->wlen = 0;
+    return 1;
+}
+
+/*
+ * 버퍼에 완성된 프레임이 있으면 꺼낸다. 1: 프레임, 0: 더 받아야 함, -1: 잘못된 프레임.
+ * payload 는 다음 tpm_conn_fill 전까지만 유효하다.
+ */
+int tpm_conn_next(tpm_conn *c, tpm_msg_hdr *h, const uint8_t **payload) {
+    size_t avail = c->rlen - c->rpos;
+    if (avail < TPM_HDR_SIZE) return 0;
+
+    const uint8_t *p = c->rbuf + c->rpos;
+    uint32_t len = get_u32(p + 8);
+    if (p[0] != TPM_PROTO_VERSION || len > c->max_payload) {
+        fprintf(stderr, "tpm_conn_next: bad frame (version %u, len %u)\n", p[0], len);
+        return -1;
+    }
+    if (avail < TPM_HDR_SIZE + len) {
+        if (TPM_HDR_SIZE + len > c->rcap) {
+            uint8_t *nb = realloc(c->rbuf, TPM_HDR_SIZE + len);
+            if (nb == NULL) return -1;
+            c->rbuf = nb;
+            c->rcap = TPM_HDR_SIZE + len;
+        }
+        return 0;
+    }
+    h->type = p[1];
+    h->flags = get_u16(p + 2);
+    h->round = get_u32(p + 4);
+    h->len = len;
+    *payload = p + TPM_HDR_SIZE;
+    c->rpos += TPM_HDR_SIZE + len;
+    return 1;
+}
+
+/*
+ * recv 한 번으로 들어온 만큼 받는다. 남은 조각은 앞으로 당겨 둔다.
+ * >0: 받은 바이트 수, 0: 상대가 닫음, TPM_AGAIN: 받을 것 없음 (논블로킹), -1: 오류
+ */
+int tpm_conn_fill(tpm_conn *c) {
+    if (c->rpos > 0) {
+        memmove(c->rbuf, c->rbuf + c->rpos, c->rlen - c->rpos);
+        c->rlen -= c->rpos;
+        c->rpos = 0;
+    }
+    for (;;) {
+        ssize_t n = recv(c->fd, c->rbuf + c->rlen, c->rcap - c->rlen, 0);
+        c->syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return TPM_AGAIN;
+            perror("recv");
+            return -1;
+        }
+        c->rlen += n;
+        c->bytes_in += n;
+        return (int)n;
+    }
+}
+
+int tpm_send_msg(tpm_conn *c, const tpm_msg_hdr *h, const void *payload, size_t len) {
+    if (tpm_conn_queue(c, h, payload, len) < 0) return -1;
+    return tpm_conn_flush(c) == 1 ? 1 : -1;
+}
+
+/*
+ * 프레임 하나를 받는다 (블로킹). 한 번의 recv 로 버퍼에 들어온 만큼 읽어 두고
+ * 완성된 프레임이 있으면 바로 돌려주므로 보통 라운드당 recv 한 번이면 된다.
+ */
+int tpm_recv_msg(tpm_conn *c, tpm_msg_hdr *h, const uint8_t **payload) {
+    for (;;) {
+        int r = tpm_conn_next(c, h, payload);
+        if (r != 0) return r;
+        r = tpm_conn_fill(c);
+        if (r <= 0) return r == 0 ? 0 : -1;
+    }
+}
+
+/* 밖에서 받은 바이트를 rbuf 뒤에 붙인다 (io_uring 수신 완료 등). 이어서 tpm_conn_next 로 꺼낸다. */
+int tpm_conn_append(tpm_conn *c, const void *data, size_t len) {
+    if (c->rpos > 0) {
+        memmove(c->rbuf, c->rbuf + c->rpos, c->rlen - c->rpos);
+        c->rlen -= c->rpos;
+        c->rpos = 0;
+    }
+    if (c->rlen + len > c->rcap) {
+        size_t cap = c->rcap * 2 > c->rlen + len ? c->rcap * 2 : c->rlen + len;
+        uint8_t *nb = realloc(c->rbuf, cap);
+        if (nb == NULL) return -1;
+        c->rbuf = nb;
+        c->rcap = cap;
+    }
+    memcpy(c->rbuf + c->rlen, data, len);
+    c->rlen += len;
+    c->bytes_in += len;
+    return 0;
+}
+
+/*
+ * 프레임이 아닌 원시 바이트 읽기 (동기화 뒤 채팅용).
+ * tpm_recv_msg 가 미리 읽어 둔 바이트가 있으면 그것부터 돌려준다.
+ */
+ssize_t tpm_conn_read(tpm_conn *c, void *buf, size_t len) {
+    if (c->rpos < c->rlen) {
+        size_t n = c->rlen - c->rpos;
+        if (n > len) n = len;
+        memcpy(buf, c->rbuf + c->rpos, n);
+        c->rpos += n;
+        return (ssize_t)n;
+    }
+    return recv(c->fd, buf, len, 0);
+}
+
+size_t tpm_wire_bits_len(const tpm_shape *shape) {
+    return (size_t)shape->K * ((shape->N + 7) / 8);
+}
+
+void tpm_bits_to_wire(const tpm_shape *shape, const uint64_t *bits, uint8_t *out) {
+    const int W = tpm_bits_words(shape->N), B = (shape->N + 7) / 8;
+    for (int k = 0; k < shape->K; k++) {
+        const uint64_t *row = bits + (size_t)k * W;
+        for (int i = 0; i < B; i++)
+            *out++ = (uint8_t)(row[i >> 3] >> ((i & 7) * 8));
+    }
+}
+
+void tpm_bits_from_wire(const tpm_shape *shape, const uint8_t *in, uint64_t *bits) {
+    const int W = tpm_bits_words(shape->N), B = (shape->N + 7) / 8;
+    memset(bits, 0, tpm_bits_len(shape) * sizeof(uint64_t));
+    for (int k = 0; k < shape->K; k++) {
+        uint64_t *row = bits + (size_t)k * W;
+        for (int i = 0; i < B; i++)
+            row[i >> 3] |= (uint64_t)*in++ << ((i & 7) * 8);
+    }
+    // 패딩 비트는 0 이어야 평면 커널의 popcount 가 맞는다
+    if (shape->N & 63) {
+        for (int k = 0; k < shape->K; k++)
+            bits[(size_t)k * W + W - 1] &= (1ULL << (shape->N & 63)) - 1;
+    }
+}
+
+/* rule u8, L u8, K u16, N u32, 서버 nonce u64, 태그 주기 u32 */
+void tpm_encode_hello(uint8_t out[TPM_HELLO_SIZE], const tpm_hello_info *info) {
+    out[0] = (uint8_t)info->rule;
+    out[1] = (uint8_t)info->shape.L;
+    put_u16(out + 2, (uint16_t)info->shape.K);
+    put_u32(out + 4, (uint32_t)info->shape.N);
+    tpm_put_u64(out + 8, info->nonce);
+    put_u32(out + 16, info->check_every);
+}
+
+int tpm_decode_hello(const uint8_t *in, size_t len, tpm_hello_info *info) {
+    if (len < TPM_HELLO_SIZE || in[0] >= RULE_COUNT) return -1;
+    info->rule = (tpm_rule)in[0];
+    info->shape.L = in[1];
+    info->shape.K = get_u16(in + 2);
+    info->shape.N = (int)get_u32(in + 4);
+    info->nonce = tpm_get_u64(in + 8);
+    info->check_every = get_u32(in + 16);
+    return tpm_shape_valid(&info->shape) ? 0 : -1;
+}
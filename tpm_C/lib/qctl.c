@@ -0,0 +1,75 @@
+#include <math.h>
+#include "tpm.h"
+
+/*
+ * query 규칙의 H 를 세션 중에 정한다. A 는 자기 가중치와 두 tau 만 안다.
+ *
+ * hidden unit 하나에서 A, B 가중치의 겹침을 rho, A 의 국소장 표준편차 (무작위 입력일 때) 를
+ * sigma = sqrt(Σ w² / K) 라 하면, A 의 국소장이 ±H 일 때 B 의 부호가 다를 확률은 대략
+ *   eps = Q(rho H / (sigma sqrt(1 - rho²)))        Q 는 표준 정규 분포의 위쪽 꼬리
+ * 이고, K 개 unit 이 같은 eps 라면 두 tau 가 같을 확률은 a = (1 + (1 - 2 eps)^K) / 2 다.
+ * 창 (TPM_QCTL_WINDOW 라운드) 마다 a 를 세어 거꾸로 eps, rho 를 추정한다.
+ * query 입력은 목표 크기를 1 .. 2H-1 에서 뽑지만 (tpm.c) 여기서는 평균인 H 로 본다.
+ *
+ * H 가 클수록 입력이 A 의 경계에서 멀어져 rho > 0 이면 tau 가 더 잘 맞고 동기화가 빨라진다
+ * (README 의 fixed H 표). 대신 어느 unit 이 rho < 0 인 채로 H 가 크면 그 unit 은 거의 늘 어긋나
+ * tau 가 맞지 않고 갱신이 멈춘다 (목표 크기가 고정이던 때 작은 N 에서 큰 H 가 실패한 이유, 지금은 드물다). 그래서
+ *   - a <= 1/2 (어긋난 unit 이 있다) 이면 h_min 으로 내려 입력을 무작위에 가깝게 하고
+ *   - 아니면 추정한 rho 에 비례해 h_min 에서 h_max 쪽으로 올린다.
+ * 비례 계수와 창 길이는 bench_adaptive 로 맞췄다.
+ */
+
+#define QCTL_FLOOR 1.2      // h_min 을 주지 않으면 무작위 가중치의 sigma 의 이 배
+
+/* Q(z) = eps 인 z (0 <= z <= 8). 창마다 한 번이라 이분법으로 충분하다. */
+static double inv_tail(double eps) {
+    double lo = 0, hi = 8;
+    for (int i = 0; i < 50; i++) {
+        double mid = (lo + hi) / 2;
+        if (0.5 * erfc(mid / sqrt(2)) > eps) lo = mid;
+        else hi = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+/*
+ * h_min 이 0 이하면 구조로 정한다. h_max 가 h_min 보다 작으면 조절할 폭이 없으므로 -1 을 돌려준다
+ * (c->h_min 에는 정한 하한이 들어 있어 호출한 쪽이 알릴 수 있다).
+ */
+int tpm_qctl_init(tpm_qctl *c, const tpm_shape *shape, int h_min, int h_max) {
+    memset(c, 0, sizeof(*c));
+    if (h_min <= 0) h_min = (int)lround(QCTL_FLOOR * tpm_field_sd(shape));
+    if (h_min < 1) h_min = 1;
+    c->K = shape->K;
+    c->h_min = h_min;
+    c->h_max = h_max;
+    c->H = h_min;
+    return h_max >= h_min ? 0 : -1;
+}
+
+/* 라운드가 끝날 때마다 부른다. agree 는 두 tau 가 같았는지. 다음 라운드의 H 를 돌려준다. */
+int tpm_qctl_observe(tpm_qctl *c, const TPM *a, int agree) {
+    c->seen++;
+    c->agree += agree != 0;
+    c->h_sum += c->H;
+    if (c->seen < TPM_QCTL_WINDOW) return c->H;
+
+    double d = 2.0 * c->agree / c->seen - 1, h = (double)c->h_sum / c->seen;
+    c->seen = c->agree = 0;
+    c->h_sum = 0;
+    if (d <= 0) {
+        c->overlap = 0;
+        c->H = c->h_min;
+        return c->H;
+    }
+
+    double eps = (1 - pow(d, 1.0 / c->K)) / 2;
+    if (eps < 1e-4) eps = 1e-4;     // 창 전체가 맞았을 때 rho = 1 로 가지 않게
+    const size_t len = tpm_vec_len(&a->shape);
+    long q = 0;
+    for (size_t i = 0; i < len; i++) q += a->weights[i] * a->weights[i];
+    double t = inv_tail(eps) * sqrt((double)q / c->K) / h;
+    c->overlap = t / sqrt(1 + t * t);
+    c->H = (int)lround(c->h_min + (c->h_max - c->h_min) * c->overlap);
+    return c->H;
+}
@@ -0,0 +1,68 @@
+#include <sys/resource.h>
+#include "tpm.h"
+
+uint64_t tpm_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int tpm_lat_add(tpm_lat *l, uint64_t ns) {
+    if (l->n == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 1024;
+        uint64_t *v = realloc(l->v, cap * sizeof(*v));
+        if (v == NULL) return -1;
+        l->v = v;
+        l->cap = cap;
+    }
+    l->v[l->n++] = ns;
+    return 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* q 분위 값 (0 <= q <= 1). 표본을 제자리에서 정렬한다. */
+uint64_t tpm_lat_pct(tpm_lat *l, double q) {
+    if (l->n == 0) return 0;
+    qsort(l->v, l->n, sizeof(*l->v), cmp_u64);
+    size_t i = (size_t)(q * (double)(l->n - 1) + 0.5);
+    return l->v[i];
+}
+
+void tpm_lat_free(tpm_lat *l) {
+    free(l->v);
+    memset(l, 0, sizeof(*l));
+}
+
+long get_memory_usage_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // macOS: bytes → KB
+#else
+    return usage.ru_maxrss;        // Linux: 이미 KB 단위
+#endif
+}
+
+void print_bar_graph(const char *label, long value, long maxValue) {
+    printf("%-20s | ", label);
+    int bar_length = maxValue > 0 ? (int)((50.0 * value) / maxValue) : 0;
+    if (bar_length > 50) bar_length = 50;
+
+    for (int i = 0; i < bar_length; i++) printf("█");
+    for (int i = bar_length; i < 50; i++) printf(" ");
+    printf(" %ld\n", value);
+}
+
+void show_result_graph(int sync_iter, int rep_steps, long mem_kb) {
+    printf("\n=========== TPM RESULT GRAPH ===========\n\n");
+
+    print_bar_graph("Sync Iterations", sync_iter, sync_iter + 10);
+    print_bar_graph("Repulsive Steps", rep_steps, sync_iter);
+    print_bar_graph("Memory Usage(KB)", mem_kb, mem_kb + 200); // 메모리는 여유 buffer 필요
+
+    printf("\n========================================\n\n");
+}
@@ -0,0 +1,29 @@
+#include "tpm.h"
+
+/*
+ * 늦은 교환을 끊는 정책. 3/4/3 에서 교환 약 0.2% 는 tau 가 늘 어긋나 갱신이 멈추고, 그렇지 않아도
+ * 라운드 분포의 꼬리가 길다. A 만 새 가중치로 다시 시작하면 결합 상태가 새로 뽑히므로 상대 (B) 는
+ * 아무것도 몰라도 된다 (프로토콜은 그대로다).
+ *
+ * 시도 i (1 부터) 의 라운드 예산은 restart, luby 면 restart × luby(i) 다. Luby 수열
+ * 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ... 은 분포를 모를 때 쓰는 재시작 간격으로, 최적 고정 간격 대비
+ * 기대 시간이 로그 배 안에 든다 (Luby, Sinclair, Zuckerman 1993).
+ */
+
+/* luby(i), i >= 1 */
+uint32_t tpm_luby(uint32_t i) {
+    for (;;) {
+        uint32_t k = 1;
+        while (((uint64_t)1 << k) - 1 < i) k++;
+        if (((uint64_t)1 << k) - 1 == i) return (uint32_t)1 << (k - 1);
+        i -= ((uint32_t)1 << (k - 1)) - 1;
+    }
+}
+
+/* 시도 attempt (1 부터) 의 라운드 예산. 재시작하지 않으면 0. */
+uint32_t tpm_restart_budget(const tpm_restart_policy *p, uint32_t attempt) {
+    if (p->restart == 0) return 0;
+    if (!p->luby) return p->restart;
+    uint64_t b = (uint64_t)p->restart * tpm_luby(attempt);
+    return b < UINT32_MAX ? (uint32_t)b : UINT32_MAX;
+}
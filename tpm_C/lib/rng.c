@@ -0,0 +1,96 @@
+#include <sys/random.h>
+#include "tpm.h"
+
+/*
+ * 카운터 기반 난수. 출력 = mix(key + ctr·γ) (SplitMix64 의 출력 함수).
+ * 상태가 없어서 어느 라운드·어느 워드든 바로 계산할 수 있고,
+ * 같은 seed 를 가진 두 노드는 공개 입력을 주고받지 않고도 같은 값을 만든다.
+ */
+
+#define GOLDEN_GAMMA 0x9e3779b97f4a7c15ULL
+
+uint64_t tpm_mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t tpm_ctr64(uint64_t key, uint64_t ctr) {
+    return tpm_mix64(key + ctr * GOLDEN_GAMMA);
+}
+
+/*
+ * 라운드 round 의 stream 번째 벡터 (TPM_STREAM_INPUTS / TPM_STREAM_THETA).
+ * 카운터 = round(32비트) | stream(4비트) | 워드 번호(28비트)
+ */
+void tpm_stream_bits(uint64_t seed, uint32_t round, int stream, const tpm_shape *shape, uint64_t *bits) {
+    const int W = tpm_bits_words(shape->N);
+    const size_t len = tpm_bits_len(shape);
+    const uint64_t base = (uint64_t)round << 32 | (uint64_t)(stream & 0xf) << 28;
+
+    for (size_t i = 0; i < len; i++)
+        bits[i] = tpm_ctr64(seed, base | i);
+    if (shape->N & 63) {
+        const uint64_t last = (1ULL << (shape->N & 63)) - 1;
+        for (int k = 0; k < shape->K; k++)
+            bits[(size_t)k * W + W - 1] &= last;
+    }
+}
+
+/* seed 합의용. 양쪽이 낸 nonce 를 섞어 한쪽만으로는 seed 를 정할 수 없게 한다. */
+uint64_t tpm_stream_seed(uint64_t server_nonce, uint64_t client_nonce) {
+    return tpm_mix64(tpm_mix64(server_nonce) ^ (client_nonce + GOLDEN_GAMMA));
+}
+
+/*
+ * 스레드별 난수 (비 seeded 입력과 theta, query 입력, 시뮬레이션의 가중치).
+ * rand() 는 프로세스 전체가 상태 하나를 나눠 쓰므로 워커 스레드가 늘면 잠금 경합이 된다.
+ * 스레드마다 SplitMix64 상태를 두고, 처음 쓸 때 getrandom 으로 채운다.
+ * 비밀이 아니다. tpm_mix64 는 역함수가 있어 출력 한 워드 (선로에 그대로 나가는 입력) 로 상태를 되찾고
+ * 같은 스레드의 앞뒤 값을 모두 만들 수 있다. 세션의 가중치는 tpm_secret_weights (tpm.c) 가 getrandom 으로 뽑는다.
+ */
+static __thread uint64_t rng_state;
+static __thread int rng_ready;
+
+void tpm_rand_seed(uint64_t seed) {
+    rng_state = seed;
+    rng_ready = 1;
+}
+
+/* 상태를 호출한 쪽이 들고 있는 SplitMix64 한 걸음 (tpm_rand64 와 같은 수열) */
+uint64_t tpm_rand_step(uint64_t *state) {
+    *state += GOLDEN_GAMMA;
+    return tpm_mix64(*state);
+}
+
+uint64_t tpm_rand64(void) {
+    if (!rng_ready) {
+        uint64_t seed;
+        if (tpm_random_bytes(&seed, sizeof(seed)) < 0) seed = tpm_now_ns() ^ (uint64_t)getpid() << 32;
+        tpm_rand_seed(seed);
+    }
+    return tpm_rand_step(&rng_state);
+}
+
+/* 지금 상태. tpm_rand_seed 로 되돌려 놓으면 같은 수열이 이어진다 */
+uint64_t tpm_rand_state(void) {
+    return rng_state;
+}
+
+/* [0, n) 균등 (곱셈-시프트, 나눗셈 없음) */
+uint32_t tpm_rand_below(uint32_t n) {
+    return (uint32_t)(((tpm_rand64() >> 32) * (uint64_t)n) >> 32);
+}
+
+int tpm_random_bytes(void *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = getrandom((char *)buf + got, len - got, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        got += n;
+    }
+    return 0;
+}
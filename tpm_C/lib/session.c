@@ -0,0 +1,634 @@
+#include "tpm.h"
+
+/*
+ * 키 교환 세션 상태 기계. 프레임 하나를 받을 때마다 한 단계 진행하고,
+ * 보낼 프레임은 conn 의 송신 버퍼에 쌓아 둔다. 블로킹 루프(tpm_session_run),
+ * epoll 루프(tpm_session_on_readable), io_uring 루프(tpm_session_on_data)가 같은 코드를 쓴다.
+ *
+ *   lockstep : 서버 ROUND → 클라이언트 REPLY. 다음 라운드는 REPLY 를 받은 뒤에 시작하므로 라운드당 1 RTT.
+ *   duplex   : 양쪽이 라운드 r 의 tau 를 동시에 보내고, 상대 tau 를 받는 즉시 갱신한 뒤 r+1 로 넘어간다.
+ *              라운드당 편도 지연 한 번이면 된다. 공개 입력은 seed 로 각자 만들거나(seeded)
+ *              서버가 INPUTS 프레임으로 window 라운드씩 미리 보내 둔다.
+ *              query 규칙은 입력이 서버 가중치로 정해지므로 클라이언트가 ROUND 를 받은 뒤에야 tau 를 낼 수 있다.
+ * 동기화 확인은 가중치 대신 가중치 태그(keymac.c)로 하고, check_every 라운드마다 REPLY 에 싣는다.
+ * lockstep 은 갱신 후, duplex 는 라운드 r 갱신 전의 태그다. 같은 가중치는 같은 입력에서 같은 tau 를 내고
+ * 똑같이 갱신되므로, duplex 서버는 r 에서 일치를 확인하면 r 까지 갱신한 뒤 DONE(r) 을 보낸다.
+ */
+
+typedef struct {
+    int seeded, query;
+    size_t bits_len, wire_bits;
+    size_t per_round;       // INPUTS 프레임에서 라운드 하나의 바이트 수
+    int slots;              // ring 칸 수 (INPUTS 를 쓸 때만)
+    uint64_t *ring;         // [slots][inputs, theta][bits_len]
+    uint32_t have_upto;     // ring 에 채워진 마지막 라운드
+    uint64_t *inputs, *theta;
+} round_feed;
+
+enum {
+    S_WAIT_NONCE,       // 서버: seeded 클라이언트 nonce 대기
+    S_WAIT_REPLY,       // 서버: 라운드 r 의 REPLY 대기
+    S_DRAIN,            // 서버: DONE 뒤에 클라이언트가 이미 보낸 REPLY 하나를 버린다
+    C_WAIT_HELLO,       // 클라이언트: HELLO 대기
+    C_WAIT_INPUTS,      // 클라이언트(duplex): 라운드 r 의 INPUTS 대기
+    C_WAIT_ROUND,       // 클라이언트: 라운드 r 의 ROUND 대기
+    X_END,
+};
+
+struct tpm_session {
+    int server;
+    int step;
+    tpm_sess_state state;
+    tpm_hello_info info;
+    tpm_sync_opts opts;
+    tpm_conn conn;
+    TPM tpm;
+    int have_tpm;
+    tpm_keymac mac;
+    round_feed feed;
+    int8_t *inputs;         // 서버 query 입력 (int8)
+    tpm_qctl qc;            // 서버 query + opts.H_max: 라운드마다 H 를 정한다
+    uint32_t attempt_start; // 서버: 이번 시도 직전 라운드 (opts.policy 의 재시작)
+    uint32_t budget;        // 서버: 이번 시도의 라운드 예산 (0 이면 재시작하지 않는다)
+    uint8_t *buf;           // 송신 본문 조립용
+    uint32_t round;
+    uint64_t started_ns;
+    tpm_sync_result res;
+};
+
+/* ---- 라운드별 공개 입력 ---- */
+
+static int feed_init(round_feed *f, const tpm_hello_info *info) {
+    memset(f, 0, sizeof(*f));
+    f->seeded = (info->flags & TPM_F_SEEDED) != 0;
+    f->query = info->rule == RULE_QUERY;
+    f->bits_len = tpm_bits_len(&info->shape);
+    f->wire_bits = tpm_wire_bits_len(&info->shape);
+    f->per_round = (f->query ? 1 : 2) * f->wire_bits;
+    f->inputs = tpm_alloc_bits(&info->shape);
+    f->theta = tpm_alloc_bits(&info->shape);
+    return f->inputs != NULL && f->theta != NULL ? 0 : -1;
+}
+
+static int feed_alloc_ring(round_feed *f, int slots) {
+    f->slots = slots;
+    f->ring = calloc((size_t)slots * 2 * f->bits_len, sizeof(uint64_t));
+    return f->ring != NULL ? 0 : -1;
+}
+
+static void feed_free(round_feed *f) {
+    free(f->ring);
+    free(f->inputs);
+    free(f->theta);
+}
+
+static uint64_t *feed_slot(round_feed *f, uint32_t round, int which) {
+    return f->ring + ((size_t)(round % f->slots) * 2 + which) * f->bits_len;
+}
+
+/* round 의 inputs(query 가 아닐 때)/theta 를 f->inputs, f->theta 에 둔다 */
+static void feed_get(round_feed *f, const tpm_hello_info *info, uint32_t round) {
+    if (f->seeded) {
+        if (!f->query) tpm_stream_bits(info->seed, round, TPM_STREAM_INPUTS, &info->shape, f->inputs);
+        tpm_stream_bits(info->seed, round, TPM_STREAM_THETA, &info->shape, f->theta);
+    } else {
+        if (!f->query) memcpy(f->inputs, feed_slot(f, round, 0), f->bits_len * sizeof(uint64_t));
+        memcpy(f->theta, feed_slot(f, round, 1), f->bits_len * sizeof(uint64_t));
+    }
+}
+
+/* 서버: round 부터 count 라운드를 만들어 ring 에 넣고 INPUTS 프레임 하나로 보낸다 */
+static int feed_send_batch(round_feed *f, const tpm_hello_info *info, tpm_conn *c, uint32_t round, int count, uint8_t *buf) {
+    uint8_t *out = buf;
+    for (int i = 0; i < count; i++) {
+        uint64_t *in = feed_slot(f, round + i, 0), *th = feed_slot(f, round + i, 1);
+        if (!f->query) {
+            generate_input_bits(&info->shape, in);
+            tpm_bits_to_wire(&info->shape, in, out);
+            out += f->wire_bits;
+        }
+        generate_input_bits(&info->shape, th);
+        tpm_bits_to_wire(&info->shape, th, out);
+        out += f->wire_bits;
+    }
+    tpm_msg_hdr hdr = { TPM_MSG_INPUTS, 0, round, 0 };
+    if (tpm_conn_queue(c, &hdr, buf, (size_t)count * f->per_round) < 0) return -1;
+    f->have_upto = round + count - 1;
+    return 0;
+}
+
+/* 클라이언트: INPUTS 프레임을 ring 에 풀어 둔다. 첫 프레임의 라운드 수로 ring 크기를 정한다. */
+static int feed_recv_batch(round_feed *f, const tpm_hello_info *info, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    if (f->seeded || hdr->len == 0 || hdr->len % f->per_round != 0 || hdr->round != f->have_upto + 1)
+        return -1;
+    int count = (int)(hdr->len / f->per_round);
+    if (f->ring == NULL && feed_alloc_ring(f, 2 * count + 2) < 0) return -1;
+    if (count > (f->slots - 2) / 2) return -1;
+
+    for (int i = 0; i < count; i++) {
+        if (!f->query) {
+            tpm_bits_from_wire(&info->shape, payload, feed_slot(f, hdr->round + i, 0));
+            payload += f->wire_bits;
+        }
+        tpm_bits_from_wire(&info->shape, payload, feed_slot(f, hdr->round + i, 1));
+        payload += f->wire_bits;
+    }
+    f->have_upto = hdr->round + count - 1;
+    return 0;
+}
+
+/* ---- 공통 ---- */
+
+static void log_round(tpm_session *s, int tau_peer) {
+    if (!s->opts.verbose) return;
+    printf("\n[Iteration %u]\n", s->round);
+    printf("  %s Tau: %d (status: %lld)\n", s->server ? "Server" : "Client", s->tpm.tau, get_weights_checksum(&s->tpm));
+    printf("  %s Tau: %d\n", s->server ? "Client" : "Server", tau_peer);
+    if (s->tpm.tau == tau_peer) printf("  > Taus match! Updating weights...\n");
+    else printf("  > Taus mismatch. No update.\n");
+}
+
+static int tau_of(const tpm_msg_hdr *hdr) {
+    return (hdr->flags & TPM_F_TAU_NEG) ? -1 : 1;
+}
+
+static uint16_t tau_flag(const TPM *tpm) {
+    return tpm->tau < 0 ? TPM_F_TAU_NEG : 0;
+}
+
+static size_t tag_len(const tpm_hello_info *info, uint32_t round) {
+    return round % info->check_every == 0 ? TPM_TAG_SIZE : 0;
+}
+
+static int duplex(const tpm_session *s) {
+    return (s->info.flags & TPM_F_DUPLEX) != 0;
+}
+
+static int window(const tpm_session *s) {
+    return s->opts.window > 0 ? s->opts.window : TPM_DEFAULT_WINDOW;
+}
+
+/* 두 tau 가 같으면 갱신하고, 갱신된 행을 태그 캐시에 알린다 */
+static void apply_round(tpm_session *s, int tau_peer) {
+    log_round(s, tau_peer);
+    if (s->tpm.tau == tau_peer) {
+        update_weights_bits(&s->tpm, s->feed.theta);
+        tpm_keymac_touch(&s->mac, &s->tpm);
+    } else {
+        s->res.repulsive_steps++;
+    }
+}
+
+static void finish(tpm_session *s, tpm_sess_state state) {
+    s->state = state;
+    s->step = X_END;
+    s->res.elapsed_ns = tpm_now_ns() - s->started_ns;
+    // 서버가 끊은 클라이언트 쪽 실패에도 끝낸 라운드 수를 남긴다
+    if (state == TPM_SESS_FAILED && s->res.iterations == 0 && s->round > 0) s->res.iterations = (int)s->round - 1;
+    s->res.tags = s->mac.tags;
+    s->res.rows_hashed = s->mac.rehashed;
+    s->res.bytes_out = s->conn.bytes_out + (s->conn.wlen - s->conn.wpos);
+    s->res.bytes_in = s->conn.bytes_in;
+}
+
+static int unexpected(tpm_session *s, const tpm_msg_hdr *hdr) {
+    fprintf(stderr, "Unexpected frame (type %u, round %u, len %u)\n", hdr->type, hdr->round, hdr->len);
+    finish(s, TPM_SESS_FAILED);
+    return -1;
+}
+
+static int setup_tpm(tpm_session *s) {
+    if (init_tpm(&s->tpm, &s->info.shape, s->info.rule) < 0) return -1;
+    s->have_tpm = 1;
+    if (tpm_secret_weights(&s->tpm) < 0) return -1;
+    if (s->opts.packed && tpm_enable_packed(&s->tpm) < 0) return -1;
+    if (tpm_keymac_init(&s->mac, &s->info.shape) < 0) return -1;
+    if (feed_init(&s->feed, &s->info) < 0) return -1;
+    s->buf = malloc((size_t)(window(s) + 2) * 2 * s->feed.wire_bits + TPM_TAG_SIZE);
+    return s->buf != NULL ? 0 : -1;
+}
+
+static void announce_seed(const tpm_session *s) {
+    if (s->opts.verbose && (s->info.flags & TPM_F_SEEDED))
+        printf("Input stream seed agreed: %016llx\n", (unsigned long long)s->info.seed);
+}
+
+/* ---- 서버 ---- */
+
+/* 라운드 s->round 를 시작한다: 입력을 정하고 tau 를 계산해 ROUND 를 쌓는다 */
+static int server_start_round(tpm_session *s) {
+    round_feed *f = &s->feed;
+    const tpm_shape *shape = &s->info.shape;
+    tpm_msg_hdr hdr;
+
+    const int ahead = window(s) / 2 > 1 ? window(s) / 2 : 1;
+    while (duplex(s) && !f->seeded && f->have_upto < s->round + ahead) {
+        // 클라이언트가 입력을 기다리지 않도록 window 라운드씩 앞서 보낸다.
+        // 적어도 다음 라운드는 늘 가 있어야 동기화된 라운드 뒤의 DONE 을 C_WAIT_ROUND 에서 받는다.
+        if (feed_send_batch(f, &s->info, &s->conn, f->have_upto + 1, window(s), s->buf) < 0) return -1;
+    }
+    if (f->seeded || duplex(s)) {
+        feed_get(f, &s->info, s->round);
+    } else {
+        if (!f->query) generate_input_bits(shape, f->inputs);
+        generate_input_bits(shape, f->theta);
+    }
+    if (f->query) {
+        // query 는 가중치를 보고 int8 로 만든 뒤 패킹한다
+        make_inputs(&s->tpm, s->inputs, s->opts.H_max > 0 ? s->qc.H : s->opts.H);
+        tpm_pack_bits(shape, s->inputs, f->inputs);
+    }
+    calculate_tau_bits(&s->tpm, f->inputs);
+
+    // 상대가 만들 수 없는 것만 싣는다: query 입력, lockstep 비 seeded 의 inputs/theta
+    size_t len = 0;
+    if (f->query || (!f->seeded && !duplex(s))) {
+        tpm_bits_to_wire(shape, f->inputs, s->buf);
+        len += f->wire_bits;
+    }
+    if (!f->seeded && !duplex(s)) {
+        tpm_bits_to_wire(shape, f->theta, s->buf + len);
+        len += f->wire_bits;
+    }
+    hdr = (tpm_msg_hdr){ TPM_MSG_ROUND, tau_flag(&s->tpm), s->round, 0 };
+    if (tpm_conn_queue(&s->conn, &hdr, s->buf, len) < 0) return -1;
+    s->step = S_WAIT_REPLY;
+    return 0;
+}
+
+/* REPLY 의 태그를 내 가중치 태그와 비교한다. 태그가 없는 라운드면 0. */
+static int tag_matches(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    uint8_t tag[TPM_TAG_SIZE];
+    if (hdr->len != TPM_TAG_SIZE) return 0;
+    tpm_keymac_tag(&s->mac, &s->tpm, s->info.nonce, s->round, tag);
+    return memcmp(tag, payload, TPM_TAG_SIZE) == 0;
+}
+
+/*
+ * 이번 시도의 라운드 예산을 다 썼다. A 만 새 가중치로 다시 시작한다 (restart.c). 클라이언트는
+ * 모른 채로 계속 가고, 태그 캐시는 모든 행을 다시 해시한다.
+ */
+static int restart_tpm(tpm_session *s) {
+    if (tpm_secret_weights(&s->tpm) < 0) return -1;
+    if (s->tpm.packed != NULL) {
+        tpm_packed_free(s->tpm.packed);
+        s->tpm.packed = NULL;
+        if (tpm_enable_packed(&s->tpm) < 0) return -1;
+    }
+    tpm_keymac_reset(&s->mac);
+    if (s->opts.H_max > 0) tpm_qctl_init(&s->qc, &s->info.shape, s->opts.H, s->opts.H_max);
+    s->res.restarts++;
+    s->attempt_start = s->round;
+    s->budget = tpm_restart_budget(&s->opts.policy, (uint32_t)s->res.restarts + 1);
+    if (s->opts.verbose) printf("  > Restarting with fresh weights (attempt %d).\n", s->res.restarts + 1);
+    return 0;
+}
+
+static int server_on_reply(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    int synced;
+    if (hdr->type != TPM_MSG_REPLY || hdr->round != s->round || hdr->len != tag_len(&s->info, s->round))
+        return unexpected(s, hdr);
+
+    if (s->feed.query && s->opts.H_max > 0) tpm_qctl_observe(&s->qc, &s->tpm, s->tpm.tau == tau_of(hdr));
+    if (duplex(s)) {
+        // REPLY 의 태그는 갱신 전 가중치의 것이므로 갱신 전에 비교한다
+        synced = tag_matches(s, hdr, payload);
+        apply_round(s, tau_of(hdr));
+    } else {
+        apply_round(s, tau_of(hdr));
+        synced = tag_matches(s, hdr, payload);
+    }
+
+    if (!synced) {
+        if (s->opts.verbose) printf("  > Weights not synced yet.\n");
+        if ((s->opts.max_rounds > 0 && s->round >= s->opts.max_rounds) ||
+            (s->opts.policy.max_repulsive > 0 && (uint32_t)s->res.repulsive_steps >= s->opts.policy.max_repulsive)) {
+            // 작은 N 에서는 tau 가 늘 어긋나 갱신이 멈춘 채로 남는 경우가 있다
+            s->res.iterations = (int)s->round;
+            finish(s, TPM_SESS_FAILED);
+            return -1;
+        }
+        if (s->budget > 0 && s->round - s->attempt_start >= s->budget && restart_tpm(s) < 0) {
+            finish(s, TPM_SESS_FAILED);
+            return -1;
+        }
+        s->round++;
+        return server_start_round(s);
+    }
+
+    s->res.iterations = (int)s->round;
+    tpm_msg_hdr done = { TPM_MSG_DONE, 0, s->round, 0 };
+    if (tpm_conn_queue(&s->conn, &done, NULL, 0) < 0) return -1;
+    // duplex 클라이언트는 DONE 을 보기 전에 다음 라운드 REPLY 를 이미 보냈다
+    if (duplex(s) && !s->feed.query) s->step = S_DRAIN;
+    else finish(s, TPM_SESS_DONE);
+    return 0;
+}
+
+static int server_on_frame(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    switch (s->step) {
+    case S_WAIT_NONCE:
+        if (hdr->type != TPM_MSG_HELLO || hdr->len != TPM_NONCE_SIZE) return unexpected(s, hdr);
+        s->info.seed = tpm_stream_seed(s->info.nonce, tpm_get_u64(payload));
+        announce_seed(s);
+        s->state = TPM_SESS_SYNCING;
+        return server_start_round(s);
+    case S_WAIT_REPLY:
+        return server_on_reply(s, hdr, payload);
+    case S_DRAIN:
+        if (hdr->type != TPM_MSG_REPLY) return unexpected(s, hdr);
+        finish(s, TPM_SESS_DONE);
+        return 0;
+    default:
+        return unexpected(s, hdr);
+    }
+}
+
+tpm_session *tpm_session_server(int fd, const tpm_hello_info *params, const tpm_sync_opts *opts) {
+    tpm_session *s = calloc(1, sizeof(*s));
+    if (s == NULL) return NULL;
+    s->server = 1;
+    s->info = *params;
+    s->opts = *opts;
+    s->started_ns = tpm_now_ns();
+    s->round = 1;
+    if (s->info.check_every == 0) s->info.check_every = 1;
+
+    // 서버 nonce 는 항상 보낸다 (태그 salt). seeded 모드에서는 seed 의 절반이기도 하다.
+    if (tpm_conn_init(&s->conn, fd) < 0 || tpm_random_bytes(&s->info.nonce, sizeof(s->info.nonce)) < 0 ||
+        setup_tpm(s) < 0 || (s->inputs = tpm_alloc_vec(&s->info.shape)) == NULL)
+        goto fail;
+    // 서버가 받는 프레임은 HELLO (nonce) 와 REPLY (태그 또는 빈 본문) 뿐이다.
+    // 인증 전의 상대가 큰 길이를 알려 연결마다 버퍼를 키우게 하지 못하도록 미리 막는다.
+    s->conn.max_payload = TPM_NONCE_SIZE > TPM_TAG_SIZE ? TPM_NONCE_SIZE : TPM_TAG_SIZE;
+    if (s->opts.H_max > 0 && tpm_qctl_init(&s->qc, &s->info.shape, s->opts.H, s->opts.H_max) < 0) goto fail;
+    s->budget = tpm_restart_budget(&s->opts.policy, 1);
+    if (duplex(s) && !s->feed.seeded && feed_alloc_ring(&s->feed, 2 * window(s) + 2) < 0)
+        goto fail;
+
+    uint8_t hello[TPM_HELLO_SIZE];
+    tpm_encode_hello(hello, &s->info);
+    tpm_msg_hdr hdr = { TPM_MSG_HELLO, s->info.flags, 0, 0 };
+    if (tpm_conn_queue(&s->conn, &hdr, hello, sizeof(hello)) < 0) goto fail;
+
+    if (s->info.flags & TPM_F_SEEDED) {
+        s->step = S_WAIT_NONCE;
+    } else {
+        s->state = TPM_SESS_SYNCING;
+        if (server_start_round(s) < 0) goto fail;
+    }
+    return s;
+fail:
+    tpm_session_free(s);
+    return NULL;
+}
+
+/* ---- 클라이언트 ---- */
+
+static int client_send_reply(tpm_session *s) {
+    uint8_t tag[TPM_TAG_SIZE];
+    size_t len = tag_len(&s->info, s->round);
+    if (len > 0) tpm_keymac_tag(&s->mac, &s->tpm, s->info.nonce, s->round, tag);
+    tpm_msg_hdr reply = { TPM_MSG_REPLY, tau_flag(&s->tpm), s->round, 0 };
+    return tpm_conn_queue(&s->conn, &reply, tag, len);
+}
+
+/*
+ * duplex (query 제외): 입력이 준비되면 서버 tau 를 기다리지 않고
+ * 라운드 r 의 tau 와 갱신 전 태그를 바로 보낸다.
+ */
+static int client_try_start(tpm_session *s) {
+    if (!s->feed.seeded && s->feed.have_upto < s->round) {
+        s->step = C_WAIT_INPUTS;
+        return 0;
+    }
+    feed_get(&s->feed, &s->info, s->round);
+    calculate_tau_bits(&s->tpm, s->feed.inputs);
+    if (client_send_reply(s) < 0) return -1;
+    s->step = C_WAIT_ROUND;
+    return 0;
+}
+
+static int client_on_hello(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    if (hdr->type != TPM_MSG_HELLO) return unexpected(s, hdr);
+    s->info.flags = hdr->flags;
+    if (tpm_decode_hello(payload, hdr->len, &s->info) < 0) {
+        fprintf(stderr, "Server sent invalid hello\n");
+        finish(s, TPM_SESS_FAILED);
+        return -1;
+    }
+    if (s->info.check_every == 0) s->info.check_every = 1;
+    if (setup_tpm(s) < 0) return -1;
+
+    if (s->info.flags & TPM_F_SEEDED) {
+        uint64_t client_nonce;
+        uint8_t nonce_buf[TPM_NONCE_SIZE];
+        if (tpm_random_bytes(&client_nonce, sizeof(client_nonce)) < 0) return -1;
+        tpm_put_u64(nonce_buf, client_nonce);
+        tpm_msg_hdr h = { TPM_MSG_HELLO, 0, 0, 0 };
+        if (tpm_conn_queue(&s->conn, &h, nonce_buf, sizeof(nonce_buf)) < 0) return -1;
+        s->info.seed = tpm_stream_seed(s->info.nonce, client_nonce);
+        announce_seed(s);
+    }
+
+    s->state = TPM_SESS_SYNCING;
+    if (duplex(s) && !s->feed.query) return client_try_start(s);
+    s->step = C_WAIT_ROUND;
+    return 0;
+}
+
+static int client_on_round(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    round_feed *f = &s->feed;
+    const tpm_shape *shape = &s->info.shape;
+    size_t round_len = !f->seeded && !duplex(s) ? 2 * f->wire_bits : (f->query ? f->wire_bits : 0);
+
+    if (hdr->type != TPM_MSG_ROUND || hdr->round != s->round || hdr->len != round_len)
+        return unexpected(s, hdr);
+
+    if (!duplex(s)) {
+        // lockstep: 입력을 받고 tau 계산 → 갱신 → 갱신 후 태그와 함께 REPLY
+        if (f->seeded) feed_get(f, &s->info, s->round);
+        if (!f->seeded || f->query) {
+            tpm_bits_from_wire(shape, payload, f->inputs);
+            payload += f->wire_bits;
+        }
+        if (!f->seeded) tpm_bits_from_wire(shape, payload, f->theta);
+        calculate_tau_bits(&s->tpm, f->inputs);
+        apply_round(s, tau_of(hdr));
+        if (client_send_reply(s) < 0) return -1;
+        s->round++;
+        return 0;
+    }
+
+    if (f->query) {
+        // duplex query: 입력이 ROUND 에 실려 오므로 받은 뒤에 tau 를 계산해 보낸다
+        if (!f->seeded && f->have_upto < s->round) return unexpected(s, hdr);
+        feed_get(f, &s->info, s->round);
+        tpm_bits_from_wire(shape, payload, f->inputs);
+        calculate_tau_bits(&s->tpm, f->inputs);
+        if (client_send_reply(s) < 0) return -1;
+        apply_round(s, tau_of(hdr));
+        s->round++;
+        return 0;
+    }
+
+    apply_round(s, tau_of(hdr));
+    s->round++;
+    return client_try_start(s);
+}
+
+static int client_on_frame(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    if (s->step == C_WAIT_HELLO) return client_on_hello(s, hdr, payload);
+
+    if (hdr->type == TPM_MSG_INPUTS) {
+        if (!duplex(s) || feed_recv_batch(&s->feed, &s->info, hdr, payload) < 0) return unexpected(s, hdr);
+        return s->step == C_WAIT_INPUTS ? client_try_start(s) : 0;
+    }
+    if (hdr->type == TPM_MSG_DONE && s->step == C_WAIT_ROUND) {
+        s->res.iterations = (int)hdr->round;
+        finish(s, TPM_SESS_DONE);
+        return 0;
+    }
+    if (s->step != C_WAIT_ROUND) return unexpected(s, hdr);
+    return client_on_round(s, hdr, payload);
+}
+
+tpm_session *tpm_session_client(int fd, const tpm_sync_opts *opts) {
+    tpm_session *s = calloc(1, sizeof(*s));
+    if (s == NULL) return NULL;
+    s->opts = *opts;
+    s->started_ns = tpm_now_ns();
+    s->round = 1;
+    s->step = C_WAIT_HELLO;
+    if (tpm_conn_init(&s->conn, fd) < 0) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/* ---- 구동 ---- */
+
+void tpm_session_free(tpm_session *s) {
+    if (s == NULL) return;
+    tpm_conn_free(&s->conn);
+    if (s->have_tpm) free_tpm(&s->tpm);
+    tpm_keymac_free(&s->mac);
+    feed_free(&s->feed);
+    free(s->inputs);
+    free(s->buf);
+    free(s);
+}
+
+static void on_frame(tpm_session *s, const tpm_msg_hdr *hdr, const uint8_t *payload) {
+    int r = s->server ? server_on_frame(s, hdr, payload) : client_on_frame(s, hdr, payload);
+    if (r < 0 && s->state != TPM_SESS_FAILED) finish(s, TPM_SESS_FAILED);
+}
+
+/* 블로킹: 쌓인 프레임을 보내고 프레임 하나를 받아 처리한다 */
+tpm_sess_state tpm_session_step(tpm_session *s) {
+    tpm_msg_hdr hdr;
+    const uint8_t *payload;
+
+    if (s->state >= TPM_SESS_DONE) return s->state;
+    if (tpm_conn_flush(&s->conn) != 1 || tpm_recv_msg(&s->conn, &hdr, &payload) <= 0) {
+        finish(s, TPM_SESS_FAILED);
+        return s->state;
+    }
+    on_frame(s, &hdr, payload);
+    if (s->state >= TPM_SESS_DONE && tpm_conn_flush(&s->conn) != 1) s->state = TPM_SESS_FAILED;
+    return s->state;
+}
+
+tpm_sess_state tpm_session_run(tpm_session *s) {
+    while (tpm_session_step(s) < TPM_SESS_DONE) {}
+    s->res.memory_kb = get_memory_usage_kb();
+    return s->state;
+}
+
+/* rbuf 에 쌓인 완성된 프레임을 모두 처리한다 */
+static void run_frames(tpm_session *s) {
+    tpm_msg_hdr hdr;
+    const uint8_t *payload;
+    int r = 0;
+    while (s->state < TPM_SESS_DONE && (r = tpm_conn_next(&s->conn, &hdr, &payload)) == 1)
+        on_frame(s, &hdr, payload);
+    if (r < 0 && s->state < TPM_SESS_DONE) finish(s, TPM_SESS_FAILED);
+}
+
+/*
+ * 논블로킹: 읽을 수 있는 만큼 읽어 완성된 프레임을 모두 처리하고 응답을 보낸다.
+ * 소켓 버퍼가 차서 못 보낸 것은 tpm_session_want_write / tpm_session_flush 로 이어서 보낸다.
+ */
+tpm_sess_state tpm_session_on_readable(tpm_session *s) {
+    for (;;) {
+        size_t room = s->conn.rcap - (s->conn.rlen - s->conn.rpos);
+        int r = tpm_conn_fill(&s->conn);
+        if (r == TPM_AGAIN) break;
+        if (r <= 0) {
+            if (s->state < TPM_SESS_DONE) finish(s, TPM_SESS_FAILED);
+            return s->state;
+        }
+        // 버퍼를 다 채우지 못했으면 소켓이 비었다. EAGAIN 을 확인하는 recv 를 아낀다.
+        int drained = (size_t)r < room;
+        run_frames(s);
+        if (s->state >= TPM_SESS_DONE || drained) break;
+    }
+    if (tpm_session_flush(s) < 0) finish(s, TPM_SESS_FAILED);
+    return s->state;
+}
+
+/*
+ * 수신을 밖에서 하는 루프용 (io_uring). 받은 바이트를 넣고 완성된 프레임을 모두 처리한다.
+ * 보낼 프레임은 conn 의 송신 버퍼에 남겨 두므로 호출한 쪽이 가져가 보낸다.
+ */
+tpm_sess_state tpm_session_on_data(tpm_session *s, const void *data, size_t len) {
+    if (s->state >= TPM_SESS_DONE) return s->state;
+    if (tpm_conn_append(&s->conn, data, len) < 0) {
+        finish(s, TPM_SESS_FAILED);
+        return s->state;
+    }
+    run_frames(s);
+    return s->state;
+}
+
+/* 상대가 연결을 끊었을 때 (수신을 밖에서 하는 루프용) */
+void tpm_session_on_eof(tpm_session *s) {
+    if (s->state < TPM_SESS_DONE) finish(s, TPM_SESS_FAILED);
+}
+
+/* 0: 다 보냈거나 소켓 버퍼가 차서 남겨 둠 (tpm_session_want_write 로 확인), -1: 오류 */
+int tpm_session_flush(tpm_session *s) {
+    return tpm_conn_flush(&s->conn) == -1 ? -1 : 0;
+}
+
+int tpm_session_want_write(const tpm_session *s) {
+    return s->conn.wpos < s->conn.wlen;
+}
+
+tpm_sess_state tpm_session_state(const tpm_session *s) {
+    return s->state;
+}
+
+TPM *tpm_session_tpm(tpm_session *s) {
+    return s->have_tpm ? &s->tpm : NULL;
+}
+
+tpm_conn *tpm_session_conn(tpm_session *s) {
+    return &s->conn;
+}
+
+const tpm_hello_info *tpm_session_info(const tpm_session *s) {
+    return &s->info;
+}
+
+const tpm_sync_result *tpm_session_result(const tpm_session *s) {
+    return &s->res;
+}
+
+/* 동기화가 끝난 세션의 키 (양쪽이 같은 값을 얻는다). 아직 끝나지 않았으면 -1. */
+int tpm_session_key(tpm_session *s, uint8_t out[TPM_KEY_SIZE]) {
+    if (s->state != TPM_SESS_DONE || !s->have_tpm) return -1;
+    tpm_keymac_derive(&s->mac, &s->tpm, s->info.nonce, out);
+    return 0;
+}
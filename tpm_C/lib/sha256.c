@@ -0,0 +1,121 @@
+#include "tpm.h"
+
+/*
+ * SHA-256 (FIPS 180-4) 과 HMAC-SHA256 (RFC 2104).
+ * 동기화 확인 태그용이라 외부 암호 라이브러리 없이 여기서 구현한다.
+ */
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t ror(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = hh + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        hh = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+void tpm_sha256_init(tpm_sha256_ctx *s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(s->h, iv, sizeof(iv));
+    s->len = 0;
+    s->fill = 0;
+}
+
+void tpm_sha256_update(tpm_sha256_ctx *s, const void *data, size_t len) {
+    const uint8_t *p = data;
+    s->len += len;
+    if (s->fill > 0) {
+        size_t n = 64 - s->fill < len ? 64 - s->fill : len;
+        memcpy(s->buf + s->fill, p, n);
+        s->fill += n;
+        p += n;
+        len -= n;
+        if (s->fill < 64) return;
+        sha256_block(s->h, s->buf);
+        s->fill = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64)
+        sha256_block(s->h, p);
+    memcpy(s->buf, p, len);
+    s->fill = len;
+}
+
+void tpm_sha256_final(tpm_sha256_ctx *s, uint8_t out[TPM_SHA256_SIZE]) {
+    uint64_t bits = s->len * 8;
+    uint8_t pad = 0x80;
+    tpm_sha256_update(s, &pad, 1);
+    pad = 0;
+    while (s->fill != 56) tpm_sha256_update(s, &pad, 1);
+    uint8_t lenbuf[8];
+    tpm_put_u64(lenbuf, bits);
+    tpm_sha256_update(s, lenbuf, 8);
+    for (int i = 0; i < 8; i++) {
+        out[4 * i] = (uint8_t)(s->h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(s->h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(s->h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)s->h[i];
+    }
+}
+
+void tpm_sha256(const void *data, size_t len, uint8_t out[TPM_SHA256_SIZE]) {
+    tpm_sha256_ctx s;
+    tpm_sha256_init(&s);
+    tpm_sha256_update(&s, data, len);
+    tpm_sha256_final(&s, out);
+}
+
+/*
+ * 키를 넣은 inner/outer 상태를 만들어 둔다. 같은 키로 여러 메시지를 태그할 때
+ * 키 블록 두 개의 압축을 다시 하지 않아도 된다.
+ */
+void tpm_hmac_init(tpm_hmac_ctx *m, const uint8_t *key, size_t key_len) {
+    uint8_t k[64] = { 0 }, pad[64];
+    if (key_len > 64) tpm_sha256(key, key_len, k);
+    else memcpy(k, key, key_len);
+
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+    tpm_sha256_init(&m->inner);
+    tpm_sha256_update(&m->inner, pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+    tpm_sha256_init(&m->outer);
+    tpm_sha256_update(&m->outer, pad, 64);
+}
+
+void tpm_hmac_tag(const tpm_hmac_ctx *m, const void *msg, size_t len, uint8_t out[TPM_SHA256_SIZE]) {
+    tpm_sha256_ctx s = m->inner;
+    uint8_t inner[TPM_SHA256_SIZE];
+    tpm_sha256_update(&s, msg, len);
+    tpm_sha256_final(&s, inner);
+    s = m->outer;
+    tpm_sha256_update(&s, inner, sizeof(inner));
+    tpm_sha256_final(&s, out);
+}
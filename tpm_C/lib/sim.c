@@ -0,0 +1,261 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "tpm.h"
+
+/*
+ * 소켓 없는 동기화 시뮬레이터. 두 TPM 을 메모리에서 번갈아 돌린다. 라운드 하나는 세션과 같다:
+ * 입력(query 면 A 의 가중치로) → 두 tau → 같으면 theta 로 둘 다 갱신 → 가중치가 같아졌는지 본다.
+ * calculate_tau/update_weights 는 server/client 가 쓰는 커널 그대로다.
+ *
+ * 시행 i 는 스레드별 난수를 tpm_ctr64(seed, i) 로 다시 심고 시작하므로, 결과는 seed 와 i 로만
+ * 정해진다. 어느 스레드가 몇 번째로 돌리든 out[i] 는 같다.
+ * cfg->bitslice 면 스레드마다 비트 슬라이스 엔진(bitslice.c)을 돌린다. 결과는 같다.
+ * cfg->H_max 가 있으면 A 가 시행마다 H 조절기 (qctl.c) 를 두고 라운드마다 H 를 정한다.
+ * cfg->policy 로 반발 라운드 예산을 넘긴 시행을 실패로 끊고, 시도마다 라운드 예산을 넘기면 A 를 새
+ * 가중치로 다시 시작한다 (restart.c). 라운드 수는 모든 시도를 합친 것이다.
+ * 결과는 시행별 배열 (tpm_sim_run) 이나 스레드별 통계 (tpm_sim_run_stats) 로 받는다.
+ */
+
+#define SIM_CHUNK 64    // 스레드가 한 번에 가져가는 시행 수
+
+typedef struct {
+    const tpm_sim_cfg *cfg;
+    uint64_t seed, first, n;
+    tpm_sim_trial *out;     // 시행별 결과 (tpm_sim_run) 또는 NULL
+    atomic_ulong next;
+    atomic_int err;
+} sim_job;
+
+// 스레드 하나의 몫. 통계 모드면 결과를 자기 st 에만 쌓고 끝에 합친다.
+typedef struct {
+    sim_job *job;
+    pthread_t th;
+    tpm_sim_stats st;
+} sim_thread;
+
+typedef struct {
+    TPM a, b;
+    int8_t *x, *theta;
+} sim_pair;
+
+static void pair_free(sim_pair *p) {
+    free_tpm(&p->a);
+    free_tpm(&p->b);
+    free(p->x);
+    free(p->theta);
+}
+
+static int pair_init(sim_pair *p, const tpm_sim_cfg *cfg) {
+    memset(p, 0, sizeof(*p));
+    if (init_tpm(&p->a, &cfg->shape, cfg->rule) < 0 || init_tpm(&p->b, &cfg->shape, cfg->rule) < 0) {
+        pair_free(p);
+        return -1;
+    }
+    p->x = tpm_alloc_vec(&cfg->shape);
+    p->theta = tpm_alloc_vec(&cfg->shape);
+    if (p->x == NULL || p->theta == NULL) {
+        pair_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+static void run_trial(sim_pair *p, const tpm_sim_cfg *cfg, uint64_t seed, uint64_t trial, tpm_sim_trial *out) {
+    const size_t len = tpm_vec_len(&cfg->shape);
+    const uint32_t max_rounds = cfg->max_rounds > 0 ? cfg->max_rounds : TPM_SIM_MAX_ROUNDS;
+    const tpm_restart_policy *pol = &cfg->policy;
+    uint32_t budget = tpm_restart_budget(pol, 1), since = 0;
+    tpm_qctl qc;
+    int H = cfg->H;
+
+    tpm_rand_seed(tpm_ctr64(seed, trial));
+    tpm_randomize_weights(&p->a);
+    tpm_randomize_weights(&p->b);
+    memset(out, 0, sizeof(*out));
+    if (cfg->H_max > 0) {
+        tpm_qctl_init(&qc, &cfg->shape, cfg->H, cfg->H_max);
+        H = qc.H;
+    }
+
+    for (uint32_t r = 1; r <= max_rounds; r++) {
+        if (budget > 0 && since == budget) {
+            // 이번 시도의 예산을 다 썼다. A 만 새 가중치로 다시 시작한다 (restart.c).
+            tpm_randomize_weights(&p->a);
+            out->restarts++;
+            since = 0;
+            budget = tpm_restart_budget(pol, out->restarts + 1);
+            if (cfg->H_max > 0) {
+                tpm_qctl_init(&qc, &cfg->shape, cfg->H, cfg->H_max);
+                H = qc.H;
+            }
+        }
+        since++;
+        make_inputs(&p->a, p->x, H);
+        generate_inputs(&cfg->shape, p->theta);
+        calculate_tau(&p->a, p->x);
+        calculate_tau(&p->b, p->x);
+        if (cfg->H_max > 0) H = tpm_qctl_observe(&qc, &p->a, p->a.tau == p->b.tau);
+        if (p->a.tau != p->b.tau) {
+            if (++out->repulsive == pol->max_repulsive) {
+                out->rounds = r;
+                return;
+            }
+            continue;
+        }
+        update_weights(&p->a, p->theta);
+        update_weights(&p->b, p->theta);
+        if (memcmp(p->a.weights, p->b.weights, len) == 0) {
+            out->rounds = r;
+            out->synced = 1;
+            return;
+        }
+    }
+    out->rounds = max_rounds;
+}
+
+/* 비트 슬라이스 엔진이 lane 을 채울 때마다 시행 하나를 가져간다 */
+static int take_one(void *ctx, uint64_t *i) {
+    sim_job *job = ((sim_thread *)ctx)->job;
+    if (atomic_load(&job->err)) return 0;
+    *i = atomic_fetch_add(&job->next, 1);
+    return *i < job->n;
+}
+
+static void put_one(void *ctx, uint64_t i, const tpm_sim_trial *t) {
+    sim_thread *me = ctx;
+    if (me->job->out != NULL) me->job->out[i] = *t;
+    else if (tpm_sim_stats_add(&me->st, t) < 0) atomic_store(&me->job->err, 1);
+}
+
+static void *sim_worker(void *arg) {
+    sim_thread *me = arg;
+    sim_job *job = me->job;
+    sim_pair p;
+
+    if (job->cfg->bitslice) {
+        if (tpm_bitslice_run(job->cfg, job->seed, job->first, take_one, put_one, me) < 0) atomic_store(&job->err, 1);
+        return NULL;
+    }
+
+    if (pair_init(&p, job->cfg) < 0) {
+        atomic_store(&job->err, 1);
+        return NULL;
+    }
+    for (;;) {
+        uint64_t i = atomic_fetch_add(&job->next, SIM_CHUNK);
+        if (i >= job->n || atomic_load(&job->err)) break;
+        uint64_t end = i + SIM_CHUNK < job->n ? i + SIM_CHUNK : job->n;
+        for (; i < end; i++) {
+            tpm_sim_trial t;
+            run_trial(&p, job->cfg, job->seed, job->first + i, &t);
+            put_one(me, i, &t);
+        }
+    }
+    pair_free(&p);
+    return NULL;
+}
+
+static int sim_start(sim_job *job, int threads, tpm_sim_stats *st) {
+    const tpm_sim_cfg *cfg = job->cfg;
+    sim_thread *th;
+    int started = 0;
+
+    if (!tpm_shape_valid(&cfg->shape)) return -1;
+    if (cfg->bitslice && (cfg->H_max > 0 || cfg->policy.max_repulsive > 0 || cfg->policy.restart > 0)) return -1;
+    tpm_qctl qc;
+    if (cfg->H_max > 0 && tpm_qctl_init(&qc, &cfg->shape, cfg->H, cfg->H_max) < 0) return -1;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    uint64_t per = cfg->bitslice ? (uint64_t)tpm_bitslice_lanes() : SIM_CHUNK;
+    if ((uint64_t)threads > (job->n + per - 1) / per) threads = (int)((job->n + per - 1) / per);
+    if (threads < 1) return 0;
+
+    th = calloc((size_t)threads, sizeof(*th));
+    if (th == NULL) return -1;
+    for (int t = 0; t < threads; t++) {
+        th[t].job = job;
+        if (pthread_create(&th[t].th, NULL, sim_worker, &th[t]) != 0) {
+            atomic_store(&job->err, 1);
+            break;
+        }
+        started++;
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(th[t].th, NULL);
+        if (st != NULL && tpm_sim_stats_merge(st, &th[t].st) < 0) atomic_store(&job->err, 1);
+        tpm_sim_stats_free(&th[t].st);
+    }
+    free(th);
+    return atomic_load(&job->err) ? -1 : 0;
+}
+
+/*
+ * 시행 first .. first+n-1 을 threads 개 스레드로 돌려 out[0..n-1] 에 넣는다 (threads <= 0 이면 온라인 CPU 수).
+ * 같은 cfg, seed, first 면 스레드 수와 상관없이 같은 결과다.
+ */
+int tpm_sim_run(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads, tpm_sim_trial *out) {
+    sim_job job = { .cfg = cfg, .seed = seed, .first = first, .n = n, .out = out };
+    return sim_start(&job, threads, NULL);
+}
+
+/*
+ * tpm_sim_run 과 같은 시행을 돌리되 결과를 저장하지 않고 st 에 더한다 (시행 수만큼의 메모리가 필요 없다).
+ * 스레드마다 따로 쌓아 끝에 합치고, 통계가 정수라서 결과는 스레드 수와 상관없다.
+ */
+int tpm_sim_run_stats(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads,
+                      tpm_sim_stats *st) {
+    sim_job job = { .cfg = cfg, .seed = seed, .first = first, .n = n };
+    return sim_start(&job, threads, st);
+}
+
+/* ---- 결과 분포 ---- */
+
+int tpm_sim_stats_add(tpm_sim_stats *st, const tpm_sim_trial *t) {
+    st->trials++;
+    if (tpm_stats_add(&st->repulsive, t->repulsive) < 0) return -1;
+    if (!t->synced) return 0;
+    st->synced++;
+    return tpm_stats_add(&st->rounds, t->rounds);
+}
+
+int tpm_sim_stats_merge(tpm_sim_stats *dst, const tpm_sim_stats *src) {
+    dst->trials += src->trials;
+    dst->synced += src->synced;
+    if (tpm_stats_merge(&dst->rounds, &src->rounds) < 0) return -1;
+    return tpm_stats_merge(&dst->repulsive, &src->repulsive);
+}
+
+void tpm_sim_stats_free(tpm_sim_stats *st) {
+    tpm_stats_free(&st->rounds);
+    tpm_stats_free(&st->repulsive);
+    memset(st, 0, sizeof(*st));
+}
+
+/* 한 줄 텍스트: trials synced R <rounds> P <repulsive> (tpm_stats_write) */
+void tpm_sim_stats_write(FILE *f, const tpm_sim_stats *st) {
+    fprintf(f, "%llu %llu R ", (unsigned long long)st->trials, (unsigned long long)st->synced);
+    tpm_stats_write(f, &st->rounds);
+    fprintf(f, " P ");
+    tpm_stats_write(f, &st->repulsive);
+}
+
+/* tpm_sim_stats_write 한 것을 st 에 더한다. 읽은 끝, 형식이 틀리면 NULL. */
+const char *tpm_sim_stats_read(const char *p, tpm_sim_stats *st) {
+    unsigned long long trials, synced;
+    int used;
+    tpm_sim_stats t = { 0 };
+
+    if (sscanf(p, "%llu %llu R %n", &trials, &synced, &used) != 2) return NULL;
+    p = tpm_stats_read(p + used, &t.rounds);
+    if (p == NULL || strncmp(p, " P ", 3) != 0) goto bad;
+    p = tpm_stats_read(p + 3, &t.repulsive);
+    if (p == NULL) goto bad;
+    t.trials = trials;
+    t.synced = synced;
+    if (tpm_sim_stats_merge(st, &t) < 0) p = NULL;
+    tpm_sim_stats_free(&t);
+    return p;
+bad:
+    tpm_sim_stats_free(&t);
+    return NULL;
+}
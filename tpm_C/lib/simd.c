@@ -0,0 +1,190 @@
+#include "tpm.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TPM_HAVE_X86 1
+#endif
+
+/*
+ * 큰 N 용 hidden unit 한 줄 커널.
+ *   dot        : Σ w[i]·x[i]  (x 는 ±1)
+ *   update_row : w[i] = clamp(w[i] ± theta[i], -L, L)
+ * scalar 는 검증용 기준 구현이다. SIMD 버전은 반드시 같은 결과를 내야 한다.
+ */
+
+static int dot_scalar(const int8_t *w, const int8_t *x, int n) {
+    int sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += w[i] * x[i];
+    return sum;
+}
+
+static inline __attribute__((always_inline))
+void update_row_scalar_dir(int8_t *w, const int8_t *theta, int n, int L, const int dir) {
+    for (int i = 0; i < n; i++) {
+        int v = w[i] + dir * theta[i];
+        v = v > L ? L : v;
+        v = v < -L ? -L : v;
+        w[i] = (int8_t)v;
+    }
+}
+
+static void update_row_scalar_fwd(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_scalar_dir(w, theta, n, L, 1);
+}
+
+static void update_row_scalar_rev(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_scalar_dir(w, theta, n, L, -1);
+}
+
+const tpm_simd_ops tpm_simd_scalar = {
+    "scalar", dot_scalar, { update_row_scalar_fwd, update_row_scalar_rev }
+};
+
+#ifdef TPM_HAVE_X86
+
+/*
+ * SSE2: 곱셈 대신 x<0 인 자리만 w 의 부호를 뒤집는다 ((w ^ m) - m).
+ * 곱은 [-127, 127] 이므로 0x80 을 xor 해서 unsigned 로 옮긴 뒤 psadbw 로
+ * 8바이트씩 합하고, 마지막에 128·n 을 빼서 되돌린다.
+ * clamp 는 SSE2 에 signed byte min/max 가 없으므로 같은 bias 를 건 unsigned min/max 로 한다.
+ */
+__attribute__((target("sse2")))
+static int dot_sse2(const int8_t *w, const int8_t *x, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    __m128i acc = zero;
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i vw = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i m = _mm_cmplt_epi8(vx, zero);
+        __m128i p = _mm_sub_epi8(_mm_xor_si128(vw, m), m);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_xor_si128(p, bias), zero));
+    }
+
+    long long sum = _mm_cvtsi128_si64(acc) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+    sum -= 128LL * i;
+    for (; i < n; i++)
+        sum += w[i] * x[i];
+    return (int)sum;
+}
+
+static inline __attribute__((always_inline, target("sse2")))
+void update_row_sse2_dir(int8_t *w, const int8_t *theta, int n, int L, const int dir) {
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i hi = _mm_set1_epi8((char)(L ^ 0x80));
+    const __m128i lo = _mm_set1_epi8((char)(-L ^ 0x80));
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i vw = _mm_loadu_si128((const __m128i *)(w + i));
+        __m128i vt = _mm_loadu_si128((const __m128i *)(theta + i));
+        __m128i v = dir > 0 ? _mm_adds_epi8(vw, vt) : _mm_subs_epi8(vw, vt);
+        v = _mm_xor_si128(v, bias);
+        v = _mm_max_epu8(_mm_min_epu8(v, hi), lo);
+        _mm_storeu_si128((__m128i *)(w + i), _mm_xor_si128(v, bias));
+    }
+    update_row_scalar_dir(w + i, theta + i, n - i, L, dir);
+}
+
+__attribute__((target("sse2")))
+static void update_row_sse2_fwd(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_sse2_dir(w, theta, n, L, 1);
+}
+
+__attribute__((target("sse2")))
+static void update_row_sse2_rev(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_sse2_dir(w, theta, n, L, -1);
+}
+
+static const tpm_simd_ops simd_sse2 = {
+    "sse2", dot_sse2, { update_row_sse2_fwd, update_row_sse2_rev }
+};
+
+/* AVX2: psignb 로 w·x 를 한 번에 구하고, signed min/max 로 바로 clamp 한다 */
+__attribute__((target("avx2")))
+static int dot_avx2(const int8_t *w, const int8_t *x, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    __m256i acc = zero;
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i vw = _mm256_loadu_si256((const __m256i *)(w + i));
+        __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i p = _mm256_sign_epi8(vw, vx);
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_xor_si256(p, bias), zero));
+    }
+
+    __m128i a = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    long long sum = _mm_cvtsi128_si64(a) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(a, a));
+    sum -= 128LL * i;
+    for (; i < n; i++)
+        sum += w[i] * x[i];
+    return (int)sum;
+}
+
+static inline __attribute__((always_inline, target("avx2")))
+void update_row_avx2_dir(int8_t *w, const int8_t *theta, int n, int L, const int dir) {
+    const __m256i hi = _mm256_set1_epi8((char)L);
+    const __m256i lo = _mm256_set1_epi8((char)-L);
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i vw = _mm256_loadu_si256((const __m256i *)(w + i));
+        __m256i vt = _mm256_loadu_si256((const __m256i *)(theta + i));
+        __m256i v = dir > 0 ? _mm256_adds_epi8(vw, vt) : _mm256_subs_epi8(vw, vt);
+        v = _mm256_max_epi8(_mm256_min_epi8(v, hi), lo);
+        _mm256_storeu_si256((__m256i *)(w + i), v);
+    }
+    update_row_scalar_dir(w + i, theta + i, n - i, L, dir);
+}
+
+__attribute__((target("avx2")))
+static void update_row_avx2_fwd(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_avx2_dir(w, theta, n, L, 1);
+}
+
+__attribute__((target("avx2")))
+static void update_row_avx2_rev(int8_t *w, const int8_t *theta, int n, int L) {
+    update_row_avx2_dir(w, theta, n, L, -1);
+}
+
+static const tpm_simd_ops simd_avx2 = {
+    "avx2", dot_avx2, { update_row_avx2_fwd, update_row_avx2_rev }
+};
+
+#endif /* TPM_HAVE_X86 */
+
+const tpm_simd_ops *tpm_simd_get(const char *name) {
+    if (strcmp(name, "scalar") == 0) return &tpm_simd_scalar;
+#ifdef TPM_HAVE_X86
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) return &simd_sse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return &simd_avx2;
+#endif
+    return NULL;
+}
+
+/*
+ * 실행 중인 CPU 에서 쓸 수 있는 가장 넓은 커널을 고른다.
+ * TPM_SIMD=scalar|sse2|avx2 로 강제할 수 있다 (검증·비교용).
+ */
+const tpm_simd_ops *tpm_simd_select(void) {
+    static const tpm_simd_ops *selected;    // 여러 워커 스레드가 동시에 불러도 같은 값을 쓴다
+    const tpm_simd_ops *cached = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (cached != NULL) return cached;
+
+    const tpm_simd_ops *ops = NULL;
+    const char *env = getenv("TPM_SIMD");
+    if (env != NULL) ops = tpm_simd_get(env);
+#ifdef TPM_HAVE_X86
+    if (ops == NULL && __builtin_cpu_supports("avx2")) ops = &simd_avx2;
+    if (ops == NULL && __builtin_cpu_supports("sse2")) ops = &simd_sse2;
+#endif
+    if (ops == NULL) ops = &tpm_simd_scalar;
+
+    __atomic_store_n(&selected, ops, __ATOMIC_RELEASE);
+    return ops;
+}
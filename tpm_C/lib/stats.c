@@ -0,0 +1,207 @@
+#include <math.h>
+#include "tpm.h"
+
+/*
+ * 스트리밍 통계. 표본을 저장하지 않고 개수, 최소/최대, 합과 제곱합, 로그-선형 히스토그램만 든다.
+ *
+ * 히스토그램 (HDR 방식)
+ *   - 0 .. 2^P - 1 은 값 하나가 한 칸이다 (정확).
+ *   - 그 위로는 2 의 거듭제곱 구간마다 2^(P-1) 칸. 칸 폭은 값의 1/2^(P-1) 이하라서
+ *     칸 가운데를 돌려주는 분위 값의 상대 오차는 1/2^P 이하다 (P = 8 이면 0.4%).
+ *   - 칸 배열은 쓰인 가장 큰 칸까지만 잡는다. 라운드 수 (~10^5) 는 칸 1000 개 남짓.
+ *
+ * 합과 제곱합은 128 비트 정수라서 넘치지 않고, 합치는 순서와 상관없이 결과가 똑같다.
+ * 스레드마다 자기 인스턴스에 넣고 끝에 tpm_stats_merge 로 합친다 (락 없음).
+ */
+
+#define SUB_BITS TPM_STATS_SUB_BITS
+#define SUB_HALF (1u << (SUB_BITS - 1))
+
+static uint32_t bin_of(uint64_t v) {
+    if (v < (1u << SUB_BITS)) return (uint32_t)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - SUB_BITS + 1;
+    return (1u << SUB_BITS) + (uint32_t)(shift - 1) * SUB_HALF + (uint32_t)((v >> shift) - SUB_HALF);
+}
+
+/* 칸 i 의 [lo, lo + width) */
+static uint64_t bin_lo(uint32_t i, uint64_t *width) {
+    if (i < (1u << SUB_BITS)) {
+        *width = 1;
+        return i;
+    }
+    uint32_t j = i - (1u << SUB_BITS);
+    int shift = (int)(j / SUB_HALF) + 1;
+    *width = 1ULL << shift;
+    return (uint64_t)(j % SUB_HALF + SUB_HALF) << shift;
+}
+
+static int grow(tpm_stats *s, uint32_t nbins) {
+    if (nbins <= s->nbins) return 0;
+    uint32_t cap = s->nbins ? s->nbins : 256;
+    while (cap < nbins) cap *= 2;
+    uint64_t *b = realloc(s->bins, cap * sizeof(*b));
+    if (b == NULL) return -1;
+    memset(b + s->nbins, 0, (cap - s->nbins) * sizeof(*b));
+    s->bins = b;
+    s->nbins = cap;
+    return 0;
+}
+
+int tpm_stats_add(tpm_stats *s, uint64_t v) {
+    uint32_t i = bin_of(v);
+    if (i >= s->nbins && grow(s, i + 1) < 0) return -1;
+    s->bins[i]++;
+    if (s->n == 0 || v < s->min) s->min = v;
+    if (v > s->max) s->max = v;
+    s->n++;
+    s->sum += v;
+    s->sq += (unsigned __int128)v * v;
+    return 0;
+}
+
+int tpm_stats_merge(tpm_stats *dst, const tpm_stats *src) {
+    if (src->n == 0) return 0;
+    if (grow(dst, src->nbins) < 0) return -1;
+    for (uint32_t i = 0; i < src->nbins; i++) dst->bins[i] += src->bins[i];
+    if (dst->n == 0 || src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->n += src->n;
+    dst->sum += src->sum;
+    dst->sq += src->sq;
+    return 0;
+}
+
+/* 칸은 그대로 두고 비운다 */
+void tpm_stats_reset(tpm_stats *s) {
+    if (s->bins != NULL) memset(s->bins, 0, s->nbins * sizeof(*s->bins));
+    s->n = s->min = s->max = 0;
+    s->sum = s->sq = 0;
+}
+
+void tpm_stats_free(tpm_stats *s) {
+    free(s->bins);
+    memset(s, 0, sizeof(*s));
+}
+
+double tpm_stats_mean(const tpm_stats *s) {
+    return s->n ? (double)s->sum / (double)s->n : 0.0;
+}
+
+double tpm_stats_sd(const tpm_stats *s) {
+    if (s->n < 2) return 0.0;
+    // n·Σx² - (Σx)² 를 정수로 계산하고 나서 나눈다 (상쇄 오차 없음)
+    unsigned __int128 d = (unsigned __int128)s->n * s->sq - s->sum * s->sum;
+    return sqrt((double)d / ((double)s->n * (double)(s->n - 1)));
+}
+
+/* q 분위 값 (0 <= q <= 1, tpm_lat_pct 와 같은 순위). 정확하지 않은 칸은 칸 가운데를 min/max 로 자른 값. */
+uint64_t tpm_stats_quantile(const tpm_stats *s, double q) {
+    if (s->n == 0) return 0;
+    if (q <= 0) return s->min;
+    if (q >= 1) return s->max;
+    uint64_t rank = (uint64_t)(q * (double)(s->n - 1) + 0.5), seen = 0;
+    for (uint32_t i = 0; i < s->nbins; i++) {
+        seen += s->bins[i];
+        if (seen <= rank) continue;
+        uint64_t width, v = bin_lo(i, &width) + width / 2;
+        return v < s->min ? s->min : v > s->max ? s->max : v;
+    }
+    return s->max;
+}
+
+/* v 이상인 표본 수. v 가 칸 경계가 아니면 v 가 든 칸은 세지 않는다 (2^P 미만은 항상 정확). */
+uint64_t tpm_stats_count_ge(const tpm_stats *s, uint64_t v) {
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < s->nbins; i++) {
+        uint64_t width;
+        if (bin_lo(i, &width) >= v) n += s->bins[i];
+    }
+    return n;
+}
+
+/* 칸 i 의 표본 수와 범위 [lo, lo + width). 분포를 칸 경계에서 비교할 때 쓴다. */
+uint64_t tpm_stats_bin(const tpm_stats *s, uint32_t i, uint64_t *lo, uint64_t *width) {
+    *lo = bin_lo(i, width);
+    return i < s->nbins ? s->bins[i] : 0;
+}
+
+/* ---- 출력 ---- */
+
+static const double pcts[] = { 0.50, 0.90, 0.99, 0.999 };
+static const char *const pct_names[] = { "p50", "p90", "p99", "p999" };
+
+/* {"n":..,"min":..,..,"tail":{"100":..}} — tail 은 10 의 거듭제곱 이상인 표본 수 (max 까지) */
+void tpm_stats_json(FILE *f, const tpm_stats *s) {
+    fprintf(f, "{\"n\":%llu,\"min\":%llu,\"max\":%llu,\"mean\":%.3f,\"sd\":%.3f", (unsigned long long)s->n,
+            (unsigned long long)s->min, (unsigned long long)s->max, tpm_stats_mean(s), tpm_stats_sd(s));
+    for (int i = 0; i < 4; i++)
+        fprintf(f, ",\"%s\":%llu", pct_names[i], (unsigned long long)tpm_stats_quantile(s, pcts[i]));
+    fprintf(f, ",\"tail\":{");
+    int first = 1;
+    for (uint64_t t = 10; s->n > 0 && t <= s->max; t *= 10) {
+        fprintf(f, "%s\"%llu\":%llu", first ? "" : ",", (unsigned long long)t,
+                (unsigned long long)tpm_stats_count_ge(s, t));
+        first = 0;
+        if (t > UINT64_MAX / 10) break;
+    }
+    fprintf(f, "}}");
+}
+
+/* prefix_n,prefix_min,.. 열 이름 (행은 tpm_stats_csv_row) */
+void tpm_stats_csv_header(FILE *f, const char *prefix) {
+    fprintf(f, "%s_n,%s_min,%s_max,%s_mean,%s_sd", prefix, prefix, prefix, prefix, prefix);
+    for (int i = 0; i < 4; i++) fprintf(f, ",%s_%s", prefix, pct_names[i]);
+}
+
+void tpm_stats_csv_row(FILE *f, const tpm_stats *s) {
+    fprintf(f, "%llu,%llu,%llu,%.3f,%.3f", (unsigned long long)s->n, (unsigned long long)s->min,
+            (unsigned long long)s->max, tpm_stats_mean(s), tpm_stats_sd(s));
+    for (int i = 0; i < 4; i++) fprintf(f, ",%llu", (unsigned long long)tpm_stats_quantile(s, pcts[i]));
+}
+
+/* ---- 직렬화 (체크포인트, 작업 프로세스) ---- */
+
+/*
+ * 한 줄 텍스트: n min max sum_hi sum_lo sq_hi sq_lo k i:c i:c ...  (k 는 빈 칸이 아닌 칸 수, 16 진수 합)
+ * 읽으면 같은 인스턴스가 나온다.
+ */
+void tpm_stats_write(FILE *f, const tpm_stats *s) {
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < s->nbins; i++) k += s->bins[i] != 0;
+    fprintf(f, "%llu %llu %llu %llx %llx %llx %llx %u", (unsigned long long)s->n, (unsigned long long)s->min,
+            (unsigned long long)s->max, (unsigned long long)(s->sum >> 64), (unsigned long long)s->sum,
+            (unsigned long long)(s->sq >> 64), (unsigned long long)s->sq, k);
+    for (uint32_t i = 0; i < s->nbins; i++)
+        if (s->bins[i] != 0) fprintf(f, " %u:%llu", i, (unsigned long long)s->bins[i]);
+}
+
+/* p 에서 tpm_stats_write 한 것 하나를 읽어 s 에 더한다. 읽은 끝을 돌려주고, 형식이 틀리면 NULL. */
+const char *tpm_stats_read(const char *p, tpm_stats *s) {
+    unsigned long long n, mn, mx, sh, sl, qh, ql;
+    unsigned k;
+    int used;
+    tpm_stats t = { 0 };
+
+    if (sscanf(p, "%llu %llu %llu %llx %llx %llx %llx %u%n", &n, &mn, &mx, &sh, &sl, &qh, &ql, &k, &used) != 8)
+        return NULL;
+    p += used;
+    for (unsigned j = 0; j < k; j++) {
+        unsigned i;
+        unsigned long long c;
+        if (sscanf(p, " %u:%llu%n", &i, &c, &used) != 2 || i > bin_of(UINT64_MAX) || grow(&t, i + 1) < 0) {
+            tpm_stats_free(&t);
+            return NULL;
+        }
+        t.bins[i] = c;
+        p += used;
+    }
+    t.n = n;
+    t.min = mn;
+    t.max = mx;
+    t.sum = (unsigned __int128)sh << 64 | sl;
+    t.sq = (unsigned __int128)qh << 64 | ql;
+    int r = tpm_stats_merge(s, &t);
+    tpm_stats_free(&t);
+    return r < 0 ? NULL : p;
+}
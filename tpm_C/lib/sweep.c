@@ -0,0 +1,337 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "tpm.h"
+
+/*
+ * 파라미터 스윕. 격자의 셀 (rule, K, N, L, H) 마다 시행을 unit 개씩 묶은 작업 단위를 워커들이 나눠 돈다.
+ *
+ * 스케줄
+ *   - 처음에 남은 단위를 셀 순서대로 잘라 워커마다 연속된 조각을 덱에 넣는다.
+ *   - 워커는 자기 덱 앞에서 꺼내고, 비면 가장 긴 덱의 뒤에서 하나 훔친다.
+ *     큰 N 이나 query 셀처럼 무거운 조각을 받은 워커의 일을 나머지가 나눠 맡는다.
+ *   - 단위를 돌리지 못한 워커(죽은 작업 프로세스 등)는 그 단위를 자기 덱 앞에 돌려놓고 빠진다.
+ *     남은 워커가 훔쳐 간다.
+ *
+ * 단위의 결과는 셀 seed 와 시행 번호로만 정해지고 (sim.c), 분포 (tpm_sim_stats) 는 정수 합과
+ * 히스토그램이라 어느 워커가 어떤 순서로 돌리든 같은 셀 결과가 나온다.
+ * 체크포인트에는 끝난 단위의 분포를 한 줄씩 덧붙인다.
+ */
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t *q;
+    size_t head, len, cap;
+} sweep_deque;
+
+typedef struct {
+    const tpm_sweep_unit *units;
+    const tpm_sweep_sched *s;
+    sweep_deque *dq;
+    pthread_mutex_t done_lock;
+    atomic_int stop;
+    atomic_ulong steals;
+} sweep_job;
+
+typedef struct {
+    sweep_job *job;
+    int id;
+} sweep_worker;
+
+/* ---- 덱 ---- */
+
+/* owner 는 앞에서, 훔치는 쪽은 뒤에서 꺼낸다 */
+static int deque_pop(sweep_deque *d, int back, size_t *idx) {
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->len > 0) {
+        if (back) {
+            *idx = d->q[(d->head + d->len - 1) % d->cap];
+        } else {
+            *idx = d->q[d->head];
+            d->head = (d->head + 1) % d->cap;
+        }
+        d->len--;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/* 꺼냈던 단위를 앞에 돌려놓는다. 워커는 단위를 하나씩만 들고 있으므로 자리가 항상 있다. */
+static void deque_unpop(sweep_deque *d, size_t idx) {
+    pthread_mutex_lock(&d->lock);
+    d->head = (d->head + d->cap - 1) % d->cap;
+    d->q[d->head] = idx;
+    d->len++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static size_t deque_len(sweep_deque *d) {
+    pthread_mutex_lock(&d->lock);
+    size_t n = d->len;
+    pthread_mutex_unlock(&d->lock);
+    return n;
+}
+
+static int steal(sweep_job *job, int self, size_t *idx) {
+    for (;;) {
+        int victim = -1;
+        size_t best = 0;
+        for (int i = 0; i < job->s->workers; i++) {
+            if (i == self) continue;
+            size_t n = deque_len(&job->dq[i]);
+            if (n > best) {
+                best = n;
+                victim = i;
+            }
+        }
+        if (victim < 0) return 0;
+        // 고른 사이에 owner 가 비웠으면 다시 고른다
+        if (deque_pop(&job->dq[victim], 1, idx)) {
+            atomic_fetch_add(&job->steals, 1);
+            return 1;
+        }
+    }
+}
+
+/* ---- 워커 ---- */
+
+static void *sweep_worker_main(void *arg) {
+    sweep_worker *w = arg;
+    sweep_job *job = w->job;
+    const tpm_sweep_sched *s = job->s;
+
+    while (!atomic_load(&job->stop)) {
+        size_t idx;
+        if (!deque_pop(&job->dq[w->id], 0, &idx) && !steal(job, w->id, &idx)) break;
+
+        tpm_sim_stats st = { 0 };
+        int r = s->exec != NULL ? s->exec(s->ctx, w->id, &job->units[idx], &st)
+                                : tpm_sweep_exec(&job->units[idx], &st);
+        if (r < 0) {
+            tpm_sim_stats_free(&st);
+            deque_unpop(&job->dq[w->id], idx);
+            break;
+        }
+        if (s->done != NULL) {
+            pthread_mutex_lock(&job->done_lock);
+            r = s->done(s->ctx, idx, &st);
+            pthread_mutex_unlock(&job->done_lock);
+            if (r != 0) atomic_store(&job->stop, 1);
+        }
+        tpm_sim_stats_free(&st);
+    }
+    return NULL;
+}
+
+/* 단위 하나를 이 스레드에서 돌려 st 에 더한다 */
+int tpm_sweep_exec(const tpm_sweep_unit *u, tpm_sim_stats *st) {
+    return tpm_sim_run_stats(&u->sim, u->seed, u->first, u->n, 1, st);
+}
+
+/* 셀 seed. 격자를 바꿔도 같은 셀은 같은 seed 를 받는다. */
+uint64_t tpm_sweep_cell_seed(uint64_t seed, const tpm_sim_cfg *sim) {
+    seed = tpm_ctr64(seed, (uint64_t)sim->rule);
+    seed = tpm_ctr64(seed, (uint64_t)sim->shape.K);
+    seed = tpm_ctr64(seed, (uint64_t)sim->shape.N);
+    seed = tpm_ctr64(seed, (uint64_t)sim->shape.L);
+    return tpm_ctr64(seed, (uint64_t)sim->H);
+}
+
+/*
+ * todo[0..n-1] 의 단위를 s->workers 개 워커 스레드로 돌린다.
+ * 반환값은 돌리지 못하고 남은 단위 수 (done 이 멈추라고 했거나 워커가 모두 빠졌을 때), 실패하면 -1.
+ */
+long tpm_sweep_run(const tpm_sweep_unit *units, const size_t *todo, size_t n, const tpm_sweep_sched *s,
+                   unsigned long *steals) {
+    sweep_job job = { .units = units, .s = s };
+    sweep_worker *w = NULL;
+    pthread_t *th = NULL;
+    int started = 0;
+    long left = -1;
+
+    if (s->workers < 1) return -1;
+    job.dq = calloc((size_t)s->workers, sizeof(*job.dq));
+    w = calloc((size_t)s->workers, sizeof(*w));
+    th = calloc((size_t)s->workers, sizeof(*th));
+    if (job.dq == NULL || w == NULL || th == NULL) goto out;
+    pthread_mutex_init(&job.done_lock, NULL);
+
+    // 셀 순서대로 연속된 조각 (조각마다 한 칸 여유: 돌려놓을 자리)
+    for (int i = 0; i < s->workers; i++) {
+        sweep_deque *d = &job.dq[i];
+        size_t lo = n * (size_t)i / (size_t)s->workers, hi = n * (size_t)(i + 1) / (size_t)s->workers;
+        pthread_mutex_init(&d->lock, NULL);
+        d->cap = hi - lo + 1;
+        d->q = malloc(d->cap * sizeof(*d->q));
+        if (d->q == NULL) goto out;
+        memcpy(d->q, todo + lo, (hi - lo) * sizeof(*d->q));
+        d->len = hi - lo;
+    }
+
+    for (int i = 0; i < s->workers; i++) {
+        w[i].job = &job;
+        w[i].id = i;
+        // 뜨지 못한 워커의 조각은 뜬 워커들이 훔쳐 간다
+        if (pthread_create(&th[i], NULL, sweep_worker_main, &w[i]) != 0) w[i].job = NULL;
+        else started++;
+    }
+    for (int i = 0; i < s->workers; i++)
+        if (w[i].job != NULL) pthread_join(th[i], NULL);
+    left = 0;
+    for (int i = 0; i < s->workers; i++) left += (long)job.dq[i].len;
+    if (steals != NULL) *steals = atomic_load(&job.steals);
+
+out:
+    if (job.dq != NULL)
+        for (int i = 0; i < s->workers; i++) free(job.dq[i].q);
+    free(job.dq);
+    free(w);
+    free(th);
+    return started > 0 || n == 0 ? left : -1;
+}
+
+/* ---- 체크포인트 ---- */
+
+/*
+ * 형식 (텍스트, 한 줄에 하나)
+ *   # tpmsweep <header>
+ *   unit <rule> <K> <N> <L> <H> <block> <tpm_sim_stats_write>
+ * header 에는 결과를 바꾸는 설정 (seed, unit, max-rounds) 만 넣는다. 셀이나 시행 수를 늘려
+ * 다시 돌리면 이미 끝난 단위는 그대로 쓴다. 끊긴 마지막 줄은 잘라 낸다.
+ */
+
+/* 단위 키 (rule, K, N, L, H, block) 순서. 체크포인트 줄을 이분 탐색으로 찾는다. */
+static int unit_cmp(const tpm_sweep_unit *a, const tpm_sweep_unit *b) {
+    const int ka[] = { a->sim.rule, a->sim.shape.K, a->sim.shape.N, a->sim.shape.L, a->sim.H };
+    const int kb[] = { b->sim.rule, b->sim.shape.K, b->sim.shape.N, b->sim.shape.L, b->sim.H };
+    for (int i = 0; i < 5; i++)
+        if (ka[i] != kb[i]) return ka[i] < kb[i] ? -1 : 1;
+    return (a->block > b->block) - (a->block < b->block);
+}
+
+static const tpm_sweep_unit *sort_units;
+
+static int cmp_index(const void *a, const void *b) {
+    return unit_cmp(&sort_units[*(const size_t *)a], &sort_units[*(const size_t *)b]);
+}
+
+static size_t find_unit(const tpm_sweep_unit *units, const size_t *idx, size_t n, const tpm_sweep_unit *key) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (unit_cmp(&units[idx[mid]], key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < n && unit_cmp(&units[idx[lo]], key) == 0 ? idx[lo] : n;
+}
+
+static int ckpt_load(FILE *f, const char *header, const tpm_sweep_unit *units, size_t n, uint8_t *done,
+                     tpm_sweep_done_fn load, void *ctx, off_t *good) {
+    char *line = NULL, rule[32];
+    size_t cap = 0;
+    ssize_t len;
+    int have_header = 0, ret = -1;
+    size_t *idx = malloc((n ? n : 1) * sizeof(*idx));
+
+    if (idx == NULL) return -1;
+    for (size_t i = 0; i < n; i++) idx[i] = i;
+    sort_units = units;     // 여는 쪽은 한 스레드다
+    qsort(idx, n, sizeof(*idx), cmp_index);
+    *good = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len - 1] != '\n') break;
+        line[len - 1] = '\0';
+        if (!have_header) {
+            if (strncmp(line, "# tpmsweep ", 11) != 0 || strcmp(line + 11, header) != 0) {
+                fprintf(stderr, "checkpoint was written with different settings: %s\n", line);
+                goto out;
+            }
+            have_header = 1;
+        } else {
+            tpm_sweep_unit key = { 0 };
+            tpm_sim_stats st = { 0 };
+            unsigned long long block;
+            int used;
+            if (sscanf(line, "unit %31s %d %d %d %d %llu %n", rule, &key.sim.shape.K, &key.sim.shape.N,
+                       &key.sim.shape.L, &key.sim.H, &block, &used) != 6 ||
+                tpm_rule_parse(rule, &key.sim.rule) < 0 || tpm_sim_stats_read(line + used, &st) == NULL) {
+                tpm_sim_stats_free(&st);
+                break;
+            }
+            key.block = block;
+            // 격자에서 빠진 셀이나 시행 수가 달라진 마지막 묶음은 건너뛴다
+            size_t i = find_unit(units, idx, n, &key);
+            if (i < n && !done[i] && units[i].n == st.trials) {
+                done[i] = 1;
+                if (load != NULL && load(ctx, i, &st) != 0) {
+                    tpm_sim_stats_free(&st);
+                    goto out;
+                }
+            }
+            tpm_sim_stats_free(&st);
+        }
+        *good += (off_t)len;
+    }
+    ret = have_header;
+out:
+    free(line);
+    free(idx);
+    return ret;
+}
+
+/*
+ * 체크포인트 파일을 열고 끝난 단위마다 done[i] 를 세우고 load(ctx, i, 분포) 를 부른다.
+ * 덧붙일 fd 를 돌려준다. header 가 다르면 (다른 seed 로 돌린 파일) errno = EINVAL 로 -1.
+ */
+int tpm_sweep_ckpt_open(const char *path, const char *header, const tpm_sweep_unit *units, size_t n,
+                        uint8_t *done, tpm_sweep_done_fn load, void *ctx) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    FILE *f = fdopen(dup(fd), "r");
+    if (f == NULL) {
+        close(fd);
+        return -1;
+    }
+    off_t good;
+    int have = ckpt_load(f, header, units, n, done, load, ctx, &good);
+    fclose(f);
+    if (have < 0) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    if (ftruncate(fd, good) < 0 || lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (!have) {
+        char line[256];
+        int len = snprintf(line, sizeof(line), "# tpmsweep %s\n", header);
+        if (write(fd, line, (size_t)len) != len) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/* 끝난 단위 한 줄을 한 번의 write 로 덧붙이고 디스크에 내린다 */
+int tpm_sweep_ckpt_append(int fd, const tpm_sweep_unit *u, const tpm_sim_stats *st) {
+    char *line = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&line, &len);
+    if (f == NULL) return -1;
+    fprintf(f, "unit %s %d %d %d %d %llu ", tpm_rule_get(u->sim.rule)->name, u->sim.shape.K, u->sim.shape.N,
+            u->sim.shape.L, u->sim.H, (unsigned long long)u->block);
+    tpm_sim_stats_write(f, st);
+    fputc('\n', f);
+    if (fclose(f) != 0) {
+        free(line);
+        return -1;
+    }
+    int r = write(fd, line, len) == (ssize_t)len ? fdatasync(fd) : -1;
+    free(line);
+    return r;
+}
@@ -0,0 +1,217 @@
+#include <math.h>
+#include "tpm.h"
+
+#define TPM_MAX_K 64
+#define TPM_MAX_N 65536
+#define TPM_MAX_L 127
+
+int sgn(int x) {
+    return (x >= 0) ? 1 : -1;
+}
+
+int tpm_shape_valid(const tpm_shape *shape) {
+    return shape->K >= 1 && shape->K <= TPM_MAX_K &&
+           shape->N >= 1 && shape->N <= TPM_MAX_N &&
+           shape->L >= 1 && shape->L <= TPM_MAX_L;
+}
+
+size_t tpm_vec_len(const tpm_shape *shape) {
+    return (size_t)shape->K * shape->N;
+}
+
+int8_t *tpm_alloc_vec(const tpm_shape *shape) {
+    return calloc(tpm_vec_len(shape), sizeof(int8_t));
+}
+
+/* 무작위 가중치와 입력일 때 hidden unit 하나의 국소장 표준편차. [-L, L] \ {0} 에서 E[w²] = (L+1)(2L+1)/6 */
+double tpm_field_sd(const tpm_shape *shape) {
+    return sqrt(shape->N * (shape->L + 1) * (2.0 * shape->L + 1) / 6);
+}
+
+/* --H 를 주지 않았을 때의 query H. 국소장의 표준편차를 반올림한다 (3/4/3 에서 4, N=16 에서 9). */
+int tpm_query_H(const tpm_shape *shape) {
+    int H = (int)lround(tpm_field_sd(shape));
+    return H > 1 ? H : 1;
+}
+
+int init_tpm(TPM *tpm, const tpm_shape *shape, tpm_rule rule) {
+    memset(tpm, 0, sizeof(*tpm));
+    if (!tpm_shape_valid(shape)) return -1;
+
+    tpm->shape = *shape;
+    tpm->weights = tpm_alloc_vec(shape);
+    tpm->sigma = calloc(shape->K, sizeof(int));
+    tpm->scratch = tpm_alloc_vec(shape);
+    if (tpm->weights == NULL || tpm->sigma == NULL || tpm->scratch == NULL) {
+        free_tpm(tpm);
+        return -1;
+    }
+
+    tpm_randomize_weights(tpm);
+    tpm->tau = 1;
+    tpm->ops = tpm_rule_get(rule);
+    tpm->kern = tpm_kernel_select(shape);
+    tpm->simd = tpm_simd_select();
+    tpm->update = tpm->kern->update[tpm->ops->dir < 0];
+    return 0;
+}
+
+/*
+ * 가중치를 [-L, L] \ {0} 에서 새로 뽑는다 (스레드별 난수). int8 가중치만 다룬다.
+ * seed 로 다시 만들 수 있어 시뮬레이션용이다. 세션의 가중치는 tpm_secret_weights 로 뽑는다.
+ */
+void tpm_randomize_weights(TPM *tpm) {
+    const int L = tpm->shape.L;
+    for (size_t i = 0; i < tpm_vec_len(&tpm->shape); i++) {
+        int w = 0;
+        while (w == 0) {
+            w = (int)tpm_rand_below(2 * L + 1) - L;
+        }
+        tpm->weights[i] = w;
+    }
+}
+
+/*
+ * 세션의 가중치. tpm_randomize_weights 와 같은 분포를 getrandom 에서 뽑는다.
+ * 스레드별 난수는 공개되는 입력도 만들고 출력 한 워드로 상태가 드러나므로 (rng.c) 비밀에는 쓰지 않는다.
+ * 2L 의 배수 밑의 바이트만 써서 나머지 편향이 없다. getrandom 이 실패하면 -1.
+ */
+int tpm_secret_weights(TPM *tpm) {
+    const int L = tpm->shape.L;
+    const size_t len = tpm_vec_len(&tpm->shape);
+    const unsigned lim = 256 - 256 % (2 * L);
+    uint8_t buf[256];
+
+    for (size_t i = 0; i < len;) {
+        size_t want = len - i + (len - i) / 4 + 8;  // 버려지는 바이트 몫을 조금 더
+        if (want > sizeof(buf)) want = sizeof(buf);
+        if (tpm_random_bytes(buf, want) < 0) return -1;
+        for (size_t j = 0; j < want && i < len; j++) {
+            if (buf[j] >= lim) continue;
+            const int w = buf[j] % (2 * L) - L;
+            tpm->weights[i++] = (int8_t)(w >= 0 ? w + 1 : w);
+        }
+    }
+    return 0;
+}
+
+void free_tpm(TPM *tpm) {
+    tpm_packed_free(tpm->packed);
+    free(tpm->weights);
+    free(tpm->sigma);
+    free(tpm->scratch);
+    tpm->packed = NULL;
+    tpm->weights = NULL;
+    tpm->sigma = NULL;
+    tpm->scratch = NULL;
+}
+
+void generate_inputs(const tpm_shape *shape, int8_t *inputs) {
+    uint64_t r = 0;
+    for (size_t i = 0; i < tpm_vec_len(shape); i++) {
+        if ((i & 63) == 0) r = tpm_rand64();
+        inputs[i] = (int8_t)((int)(r & 1) * 2 - 1);
+        r >>= 1;
+    }
+}
+
+/*
+ * query 입력 (Ruttor, Kinzel, Kanter). hidden unit 마다 고른 x 에서 시작해 목표 ±t 에 h 를 ±1 안으로 맞춘다.
+ * 부호는 고르게, 크기 t 는 1 .. 2H-1 에서 고르게 뽑는다 (평균 H). t 를 H 로 고정하면 작은 N 에서
+ * 0 인 가중치가 많은 unit 은 입력이 거의 정해져, A 와 B 의 부호가 늘 어긋난 채로 갱신이 멈춘다.
+ * H 가 0 이하면 tpm_query_H 로 구조에서 정한다.
+ *   h 를 올리려면 w·x < 0 인 자리를, 내리려면 w·x > 0 인 자리를 뒤집는다. 하나 뒤집으면 h 가 2|w| 움직인다.
+ *   |w| 가 큰 것부터 몇 개 뒤집을지를 |w| 별 후보 수만으로 정하고 (h 는 개수로 바로 따라간다),
+ *   한 번 훑으며 |w| 마다 그 개수만큼을 후보 중에서 고르게 고른다 (selection sampling).
+ * 재시도가 없어 unit 당 O(N) 이고, 위치 순서를 바꿔도 분포가 같다 (markov.c 가 이 성질을 쓴다).
+ * 후보가 모자라 맞출 수 없으면 가장 가깝게 둔다.
+ */
+void generate_query_inputs(const TPM *tpm, int8_t *x, int H) {
+    const int N = tpm->shape.N, L = tpm->shape.L;
+    int cand[TPM_MAX_L + 1], need[TPM_MAX_L + 1];
+
+    if (H <= 0) H = tpm_query_H(&tpm->shape);
+    generate_inputs(&tpm->shape, x);
+    tpm_sync_weights((TPM *)tpm);  // weights 는 비트 평면의 사본일 수 있다
+    for (int k = 0; k < tpm->shape.K; k++) {
+        const int8_t *w = tpm->weights + (size_t)k * N;
+        int8_t *xk = x + (size_t)k * N;
+        int h = 0;
+        for (int n = 0; n < N; n++)
+            h += w[n] * xk[n];
+
+        const int t = 1 + (int)tpm_rand_below((uint32_t)(2 * H - 1));
+        int d = (tpm_rand64() & 1 ? -t : t) - h;
+        if (abs(d) <= 1) continue;
+        const int up = d > 0;
+        memset(cand, 0, (size_t)(L + 1) * sizeof(*cand));
+        for (int n = 0; n < N; n++) {
+            int p = w[n] * xk[n];
+            cand[abs(w[n])] += (p != 0) & ((p < 0) == up);  // 부호가 고르게 섞여 있어 분기 없이 센다
+        }
+        int left = abs(d), total = 0;
+        need[0] = 0;
+        for (int l = L; l >= 1; l--) {
+            int m = left > 1 ? (left + 1) / (2 * l) : 0;
+            need[l] = m < cand[l] ? m : cand[l];
+            left -= 2 * l * need[l];
+            total += need[l];
+        }
+        // 위치마다 난수 하나를 쓰고 (후보가 아니면 버린다) 분기 없이 뒤집는다. 스레드 변수 대신 지역 사본으로 돈다.
+        uint64_t rs = tpm_rand_state();
+        for (int n = 0; n < N && total > 0; n++) {
+            const int p = w[n] * xk[n], l = abs(w[n]);
+            const int c = (p != 0) & ((p < 0) == up);
+            const uint32_t r = (uint32_t)(((tpm_rand_step(&rs) >> 32) * (uint64_t)cand[l]) >> 32);
+            const int f = c & (r < (uint32_t)need[l]);
+            xk[n] = (int8_t)(f ? -xk[n] : xk[n]);
+            need[l] -= f;
+            total -= f;
+            cand[l] -= c;
+        }
+        tpm_rand_seed(rs);
+    }
+}
+
+void make_inputs(const TPM *tpm, int8_t *x, int H) {
+    tpm->ops->make_inputs(tpm, x, H);
+}
+
+void calculate_tau(TPM *tpm, const int8_t *inputs) {
+    if (tpm->packed != NULL) packed_calc_tau_i8(tpm, inputs);
+    else tpm->kern->calc_tau(tpm, inputs);
+}
+
+void update_weights(TPM *tpm, const int8_t *theta) {
+    if (tpm->packed != NULL) packed_update_i8(tpm, theta);
+    else tpm->update(tpm, theta);
+}
+
+void print_weights(const TPM *tpm, const char *name) {
+    const int N = tpm->shape.N;
+    const int shown = N > 16 ? 16 : N;  // 큰 N 은 앞부분만 출력
+
+    tpm_sync_weights((TPM *)tpm);
+    printf("--- %s's Weights (Key) ---\n", name);
+    for (int k = 0; k < tpm->shape.K; k++) {
+        printf("k=%d: [", k);
+        for (int n = 0; n < shown; n++) {
+            printf("%3d", tpm->weights[(size_t)k * N + n]);
+        }
+        if (shown < N) printf(" ... (%d more)", N - shown);
+        printf(" ]\n");
+    }
+    printf("\n");
+}
+
+long long get_weights_checksum(const TPM *tpm) {
+    const int N = tpm->shape.N;
+    long long checksum = 0;
+    tpm_sync_weights((TPM *)tpm);
+    for (int k = 0; k < tpm->shape.K; k++) {
+        for (int n = 0; n < N; n++) {
+            checksum += (long long)(k + 1) * (n + 1) * tpm->weights[(size_t)k * N + n];
+        }
+    }
+    return checksum;
+}
@@ -0,0 +1,583 @@
+#ifndef TPM_COMMON_H
+#define TPM_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// 기본 구조 (논문 예시 값). 실행 시 -K/-N/-L 로 바꿀 수 있다.
+#define DEFAULT_K 3
+#define DEFAULT_N 4
+#define DEFAULT_L 3
+
+#define BUFSIZE 1024
+
+// 학습 규칙: 입력 생성 방식과 가중치 갱신 방향만 다르다
+typedef enum {
+    RULE_RANDOM_WALK = 0,
+    RULE_ANTI_HEBBIAN,
+    RULE_QUERY,
+    RULE_COUNT
+} tpm_rule;
+
+typedef struct {
+    int K;  // hidden unit 수
+    int N;  // hidden unit 당 입력 수
+    int L;  // 가중치 범위 [-L, L]
+} tpm_shape;
+
+struct TPM;
+typedef struct tpm_packed tpm_packed;
+
+/*
+ * 가중치/입력은 int8 로 저장한다 (L <= 127, 입력은 ±1).
+ * 큰 N 에서는 한 명령에 16(SSE2)/32(AVX2)개씩 처리할 수 있다.
+ */
+typedef struct tpm_simd_ops {
+    const char *name;
+    int (*dot)(const int8_t *w, const int8_t *x, int n);                       // Σ w·x
+    void (*update_row[2])(int8_t *w, const int8_t *theta, int n, int L);       // clamp(w ± theta)
+} tpm_simd_ops;
+
+// 규칙별 입력 생성기와 갱신 방향 (+theta / -theta)
+typedef struct tpm_rule_ops {
+    tpm_rule rule;
+    const char *name;
+    int dir;
+    void (*make_inputs)(const struct TPM *tpm, int8_t *x, int H);
+} tpm_rule_ops;
+
+// 구조별 커널. K/N/L 이 상수로 고정된 특수화 버전과 임의 구조용 generic 버전이 있다.
+// 큰 N 용 커널은 hidden unit 한 줄씩 tpm->simd 의 벡터 커널을 호출한다.
+typedef struct tpm_kernel {
+    tpm_shape shape;    // generic 커널은 {0, 0, 0}
+    const char *name;
+    void (*calc_tau)(struct TPM *tpm, const int8_t *x);
+    void (*update[2])(struct TPM *tpm, const int8_t *theta);  // [0]: +theta, [1]: -theta
+} tpm_kernel;
+
+// weights 는 K*N 행 우선 배열 (weights[k * N + n])
+// packed 가 켜져 있으면 가중치 원본은 비트 평면이고 weights 는 tpm_sync_weights 로 갱신되는 사본이다.
+typedef struct TPM {
+    tpm_shape shape;
+    int8_t *weights;
+    int *sigma;
+    int tau;
+    const tpm_rule_ops *ops;
+    const tpm_kernel *kern;
+    const tpm_simd_ops *simd;
+    void (*update)(struct TPM *tpm, const int8_t *theta);  // kern 과 ops->dir 로 결정된 커널
+    tpm_packed *packed;
+    int8_t *scratch;    // 비트 입력을 int8 커널에 넘길 때 쓰는 K*N 버퍼
+} TPM;
+
+/*
+ * 와이어 프로토콜 (proto.c). 한 라운드는 방향마다 프레임 하나다.
+ *   HELLO  S->C  rule, K, N, L, 서버 nonce, 태그 주기
+ *   HELLO  C->S  seeded 모드에서만, 클라이언트 nonce
+ *   ROUND  S->C  inputs/theta 비트, flags 에 서버 tau
+ *                seeded 모드에서는 양쪽이 seed 로 직접 만들므로 본문이 없다 (query 는 inputs 만)
+ *   REPLY  C->S  flags 에 클라이언트 tau, 태그 주기 라운드면 가중치 태그 (keymac.c)
+ *   INPUTS S->C  duplex + 비 seeded 모드, round 부터 여러 라운드의 inputs/theta 비트 (session.c)
+ *   DONE   S->C  동기화 완료 (본문 없음, round 는 마지막으로 갱신한 라운드)
+ */
+#define TPM_PROTO_VERSION 1
+#define TPM_HDR_SIZE      12
+#define TPM_HELLO_SIZE    20
+#define TPM_NONCE_SIZE    8
+#define TPM_SHA256_SIZE   32
+#define TPM_TAG_SIZE      TPM_SHA256_SIZE
+#define TPM_KEY_SIZE      TPM_SHA256_SIZE   // 동기화 뒤 뽑는 세션 키
+
+enum {
+    TPM_MSG_HELLO = 1,
+    TPM_MSG_ROUND,
+    TPM_MSG_REPLY,
+    TPM_MSG_DONE,
+    TPM_MSG_INPUTS,
+};
+
+#define TPM_F_TAU_NEG 0x0001  // tau == -1
+#define TPM_F_SEEDED  0x0002  // HELLO: 공개 입력을 seed 로부터 각자 생성
+#define TPM_F_DUPLEX  0x0004  // HELLO: 양쪽이 tau 를 동시에 보내는 파이프라인 모드
+
+enum {
+    TPM_STREAM_INPUTS = 0,
+    TPM_STREAM_THETA  = 1,
+};
+
+typedef struct {
+    uint8_t type;
+    uint16_t flags;
+    uint32_t round;
+    uint32_t len;
+} tpm_msg_hdr;
+
+// 프레임 단위 연결. 받은 바이트는 rbuf 에, 보낼 프레임은 wbuf 에 모아 둔다.
+// 블로킹/논블로킹 소켓 모두에서 쓸 수 있다 (논블로킹이면 TPM_AGAIN 이 돌아온다).
+typedef struct {
+    int fd;
+    uint8_t *rbuf;
+    size_t rcap, rlen, rpos;
+    uint8_t *wbuf;
+    size_t wcap, wlen, wpos;
+    uint32_t max_payload;   // 이보다 긴 본문을 알리는 헤더는 버퍼를 늘리기 전에 거부한다
+    unsigned long syscalls;
+    unsigned long bytes_out, bytes_in;
+} tpm_conn;
+
+#define TPM_AGAIN (-2)
+
+// HELLO 로 정해지는 세션 파라미터
+typedef struct {
+    tpm_rule rule;
+    tpm_shape shape;
+    uint16_t flags;     // TPM_F_SEEDED | TPM_F_DUPLEX
+    uint32_t check_every;  // 가중치 태그를 비교하는 라운드 주기 (0 이면 1)
+    uint64_t nonce;     // 서버 nonce. 태그의 salt 이자 seed 의 절반
+    uint64_t seed;      // seeded 모드에서 합의된 공개 입력 seed
+} tpm_hello_info;
+
+#define TPM_DEFAULT_WINDOW 8
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t len;
+    uint8_t buf[64];
+    size_t fill;
+} tpm_sha256_ctx;
+
+typedef struct {
+    tpm_sha256_ctx inner, outer;    // 키를 넣은 뒤의 상태
+} tpm_hmac_ctx;
+
+// 가중치 태그 캐시. 행별 digest 와 키를 넣은 HMAC 상태를 들고 있다.
+typedef struct {
+    int K, N;
+    uint8_t *row;       // [K][32]
+    uint8_t *stale;     // [K], 다시 해시해야 하는 행
+    int key_stale;
+    tpm_hmac_ctx mac;
+    unsigned long tags, rehashed;   // 통계: 만든 태그 수, 다시 해시한 행 수
+} tpm_keymac;
+
+// 동기화가 늦은 교환을 끊는 정책 (restart.c). 0 인 항목은 쓰지 않는다.
+typedef struct {
+    uint32_t max_repulsive; // 반발 라운드 (tau 가 달라 갱신하지 않은 라운드) 가 이만큼 쌓이면 실패
+    uint32_t restart;       // 한 시도가 이 라운드 안에 동기화되지 않으면 A 가 새 가중치로 다시 시작한다
+    int luby;               // 1 이면 i 번째 시도의 라운드 예산을 restart × luby(i) 로
+} tpm_restart_policy;
+
+typedef struct {
+    int H;              // query 규칙의 H (0 이면 구조로 정한다, tpm_query_H)
+    int window;         // duplex + 비 seeded: 한 번에 미리 보내는 입력 라운드 수
+    int verbose;        // 라운드별 로그 출력
+    int packed;         // 가중치를 비트 평면으로 (tpm_enable_packed)
+    uint32_t max_rounds;    // 서버: 이 라운드까지 동기화되지 않으면 실패로 끝낸다 (0 이면 무제한)
+    int H_max;          // 0 이 아니면 query 의 H 를 세션 중에 H .. H_max 에서 조절한다 (qctl.c). H 가 0 이면 구조로 정한다.
+    tpm_restart_policy policy;  // 서버: 반발 예산, 재시작 (max_rounds 는 위)
+} tpm_sync_opts;
+
+// query 규칙의 H 조절기 (qctl.c). 입력을 만드는 쪽 (A) 이 라운드마다 두 tau 가 같았는지 알려 주면
+// 창마다 겹침을 추정해 다음 창의 H 를 정한다. h_max 는 보안 상한이다 (공격자도 같은 입력을 본다).
+#define TPM_QCTL_WINDOW 8
+
+typedef struct {
+    int K;
+    int h_min, h_max;
+    int H;                  // 다음 라운드에 쓸 H
+    uint32_t seen, agree;   // 이번 창의 라운드 수, 그중 tau 가 같았던 라운드 수
+    long h_sum;             // 이번 창에 쓴 H 의 합
+    double overlap;         // 마지막 추정 겹침 (A, B 가중치의 정규화 내적, 0 이하는 0)
+} tpm_qctl;
+
+typedef struct {
+    int iterations;
+    int repulsive_steps;
+    long memory_kb;
+    int restarts;               // 서버: 정책에 따라 새 가중치로 다시 시작한 횟수
+    unsigned long tags;         // 계산한 가중치 태그 수
+    unsigned long rows_hashed;  // 그중 다시 해시한 행 수 (나머지는 캐시)
+    uint64_t elapsed_ns;        // 세션 생성부터 동기화 완료까지
+    unsigned long bytes_out, bytes_in;  // 끝날 때까지 보낸(보낼 차례인 것 포함) / 받은 바이트
+} tpm_sync_result;
+
+// 연결 하나의 키 교환 상태 (session.c). 받은 프레임으로만 진행하므로
+// 블로킹 루프와 epoll 루프가 같은 상태 기계를 쓴다.
+typedef struct tpm_session tpm_session;
+
+typedef enum {
+    TPM_SESS_HANDSHAKE = 0,
+    TPM_SESS_SYNCING,
+    TPM_SESS_DONE,
+    TPM_SESS_FAILED,
+} tpm_sess_state;
+
+// 논블로킹 키 교환 클라이언트 (aclient.c). err 가 0 이면 key 에 세션 키, 아니면 errno 값이고 key 는 NULL.
+typedef struct tpm_aclient tpm_aclient;
+typedef void (*tpm_key_cb)(void *arg, int err, const uint8_t *key, const tpm_sync_result *res);
+
+// 소켓 없는 동기화 시뮬레이터 (sim.c)
+#define TPM_SIM_MAX_ROUNDS 100000
+
+typedef struct {
+    tpm_rule rule;
+    tpm_shape shape;
+    int H;                  // query 규칙의 H (0 이면 구조로 정한다, tpm_query_H)
+    uint32_t max_rounds;    // 이 라운드까지 동기화되지 않으면 실패 (0 이면 TPM_SIM_MAX_ROUNDS)
+    int bitslice;           // 1 이면 비트 슬라이스 엔진 (bitslice.c). 시행별 결과는 스칼라와 같다.
+    int H_max;              // 0 이 아니면 H .. H_max 에서 H 를 조절한다 (qctl.c, bitslice 와 함께 쓸 수 없다)
+    tpm_restart_policy policy;  // 반발 예산, 재시작 (bitslice 와 함께 쓸 수 없다, attack.c 는 쓰지 않는다)
+} tpm_sim_cfg;
+
+typedef struct {
+    uint32_t rounds;        // 동기화된 라운드 (실패면 멈춘 라운드)
+    uint32_t repulsive;     // tau 가 달라 갱신하지 않은 라운드 수
+    uint32_t restarts;      // 정책에 따라 A 를 다시 시작한 횟수
+    uint8_t synced;
+} tpm_sim_trial;
+
+// 다음에 돌릴 시행 번호를 *i 에 넣는다. 남은 시행이 없으면 0.
+typedef int (*tpm_sim_take_fn)(void *ctx, uint64_t *i);
+// 끝난 시행 i 의 결과를 받는다
+typedef void (*tpm_sim_put_fn)(void *ctx, uint64_t i, const tpm_sim_trial *t);
+
+// 스트리밍 통계 (stats.c). 표본 없이 합과 로그-선형 히스토그램만 든다. 스레드마다 두고 끝에 합친다.
+#define TPM_STATS_SUB_BITS 8    // 2^8 미만은 정확, 그 위 분위 값은 상대 오차 0.4% 이하
+
+typedef struct {
+    uint64_t n, min, max;
+    unsigned __int128 sum, sq;  // 합, 제곱합 (정수라 합치는 순서와 상관없다)
+    uint64_t *bins;
+    uint32_t nbins;
+} tpm_stats;
+
+// 시뮬레이션 결과 분포 (sim.c 의 tpm_sim_run_stats)
+typedef struct {
+    uint64_t trials, synced;
+    tpm_stats rounds;       // 동기화된 시행의 라운드
+    tpm_stats repulsive;    // 모든 시행의 반발 라운드 수
+} tpm_sim_stats;
+
+// 공격 시뮬레이터 (attack.c). 공개된 것 (입력, theta, 두 tau) 만 보는 기하 공격자를 A-B 옆에서 돌린다.
+typedef struct {
+    tpm_sim_cfg sim;        // A-B 설정 (bitslice 는 쓰지 않는다)
+    int attackers;          // 시행마다 서로 독립인 공격자 수. 하나라도 A 와 같아지면 따라잡은 것이다.
+    uint32_t chase;         // A-B 가 동기화된 뒤에도 A-B 라운드의 chase 배까지 공격자를 돌린다 (1 이면 바로 멈춤)
+    int soa;                // 1 이면 공격자 묶음 엔진 (majority.c). 기하 공격 결과는 TPM 하나씩 돌린 것과 같다.
+    int majority;           // 1 이면 다수결 공격 (soa 를 켠다)
+    int genetic;            // 1 이면 유전 공격 (genetic.c). attackers 는 개체 수 상한 (2^(K-1) 이상)
+} tpm_attack_cfg;
+
+// 공격자 M 개를 한 묶음으로 돌리는 엔진 (majority.c). 가중치는 32 개씩 [K·N][lane] 배치 (structure of arrays).
+typedef struct tpm_majority tpm_majority;
+
+// 유전 공격의 개체 무리 (genetic.c). 상한 개수만큼의 가중치 칸을 한 번 잡아 두고 재사용한다.
+typedef struct tpm_genetic tpm_genetic;
+
+typedef struct {
+    uint64_t trials, synced;    // A-B 가 동기화된 시행
+    uint64_t broken;            // A-B 가 동기화된 라운드에 공격자도 A 와 같았던 시행
+    uint64_t caught;            // chase 안에 공격자가 A 와 같아진 시행 (broken 포함)
+    tpm_stats rounds;           // A-B 동기화 라운드
+    tpm_stats attack;           // 공격자가 A 와 같아진 라운드 (caught 시행)
+    tpm_stats ratio;            // 공격자 라운드 / A-B 라운드 × 1000 (caught 시행)
+} tpm_attack_stats;
+
+// 파라미터 스윕 (sweep.c). 격자의 셀 (rule, K, N, L, H) 마다 시행을 묶은 작업 단위.
+typedef struct {
+    tpm_sim_cfg sim;
+    uint64_t seed;          // 셀 seed (tpm_sweep_cell_seed)
+    uint64_t block;         // 셀 안에서 몇 번째 묶음인지
+    uint64_t first, n;      // 시행 번호 first .. first+n-1
+} tpm_sweep_unit;
+
+typedef int (*tpm_sweep_exec_fn)(void *ctx, int worker, const tpm_sweep_unit *u, tpm_sim_stats *st);
+typedef int (*tpm_sweep_done_fn)(void *ctx, size_t unit, const tpm_sim_stats *st);
+
+typedef struct {
+    int workers;
+    tpm_sweep_exec_fn exec;     // 워커가 단위를 돌리는 방법 (NULL 이면 tpm_sweep_exec). 실패하면 그 워커는 빠진다.
+    tpm_sweep_done_fn done;     // 끝난 단위마다 한 번에 하나씩 불린다. 0 이 아니면 새 단위를 내주지 않는다.
+    void *ctx;
+} tpm_sweep_sched;
+
+// 정확한 동기화 시간 분포 (markov.c). 작은 구조에서 두 TPM 의 결합 상태 마르코프 연쇄를 푼다.
+typedef struct {
+    tpm_rule rule;
+    tpm_shape shape;
+    int H;                  // query 규칙의 H (0 이면 구조로 정한다, tpm_query_H)
+    int threads;            // 0 이면 온라인 CPU 수
+    size_t max_states;      // 대칭으로 줄인 결합 상태가 이보다 많으면 포기 (0 이면 TPM_MARKOV_MAX_STATES)
+    uint32_t max_rounds;    // 이 라운드까지 분포를 낸다 (0 이면 TPM_SIM_MAX_ROUNDS)
+    double eps;             // 남은 확률이 이보다 작아지면 멈춘다
+} tpm_markov_cfg;
+
+#define TPM_MARKOV_MAX_STATES 4000000
+
+typedef struct {
+    uint32_t unit_states;   // hidden unit 하나의 (A 행, B 행) 상태 수 (대칭으로 줄인 것)
+    size_t states, nnz;     // 도달한 결합 상태 수, 전이 행렬의 0 아닌 항 수
+    uint32_t rounds;        // 계산한 라운드 수
+    double *p;              // p[r] = P(r 라운드째에 동기화), r = 0 .. rounds (p[0] = 0)
+    double tail;            // P(rounds 안에 동기화되지 않음), never 포함
+    double never;           // P(영영 동기화되지 않음): 동기화 상태로 갈 수 없는 상태에 갇힌 확률
+} tpm_markov_result;
+
+// 동기화 시간 표본 (report.c). 백분위를 낼 때 정렬한다.
+typedef struct {
+    uint64_t *v;
+    size_t n, cap;
+} tpm_lat;
+
+// 다중 세션 서버 (evserver.c 의 epoll, uring.c 의 io_uring)
+typedef struct {
+    tpm_hello_info params;      // rule, shape, flags, check_every
+    tpm_sync_opts opts;
+    int threads;                // 워커 스레드 수 (0 이면 온라인 CPU 수, io_uring 은 항상 1)
+    int report_ms;              // 주기 보고 간격 (0 이면 보고하지 않음)
+    unsigned long max_sessions; // 이만큼 끝나면 반환 (0 이면 계속)
+} tpm_evserver_cfg;
+
+typedef struct {
+    unsigned long accepted, done, failed;
+    unsigned long active, peak_active;
+    unsigned long steals;       // 다른 워커가 대신 처리한 준비된 세션 수
+    uint64_t syscalls;          // 서버 쪽 시스템 콜 수 (끝난 세션의 send/recv + 루프)
+    uint64_t rounds;            // 완료한 세션의 라운드 합
+    uint64_t restarts;          // 끝난 세션이 정책에 따라 다시 시작한 횟수의 합
+    uint64_t started_ns;
+    tpm_stats lat;              // 직전 보고 이후 완료한 세션의 accept → DONE 시간 (ns, 반환할 때는 전체)
+    tpm_stats sync_ns;          // 처음부터 완료한 세션의 accept → DONE 시간 (ns)
+    tpm_stats iters;            // 처음부터 완료한 세션의 동기화 라운드
+} tpm_evserver_stats;
+
+/* net.c */
+void ErrorHandling(const char *msg);
+int send_all(int sock, const void *buf, size_t len);
+int recv_all(int sock, void *buf, size_t len);
+int tpm_listen_tcp(const struct sockaddr_in *addr, int backlog);
+int tpm_listen_again(int listen_fd, int backlog);
+
+/* tpm.c */
+int tpm_shape_valid(const tpm_shape *shape);
+size_t tpm_vec_len(const tpm_shape *shape);
+int8_t *tpm_alloc_vec(const tpm_shape *shape);
+double tpm_field_sd(const tpm_shape *shape);
+int tpm_query_H(const tpm_shape *shape);
+int init_tpm(TPM *tpm, const tpm_shape *shape, tpm_rule rule);
+void free_tpm(TPM *tpm);
+void tpm_randomize_weights(TPM *tpm);
+int tpm_secret_weights(TPM *tpm);
+void generate_inputs(const tpm_shape *shape, int8_t *inputs);
+void generate_query_inputs(const TPM *tpm, int8_t *x, int H);
+void make_inputs(const TPM *tpm, int8_t *x, int H);
+int sgn(int x);
+void calculate_tau(TPM *tpm, const int8_t *inputs);
+void update_weights(TPM *tpm, const int8_t *theta);
+void print_weights(const TPM *tpm, const char *name);
+long long get_weights_checksum(const TPM *tpm);
+
+/* aclient.c */
+tpm_aclient *tpm_aclient_new(void);
+void tpm_aclient_free(tpm_aclient *ac);
+int tpm_aclient_fd(const tpm_aclient *ac);
+unsigned long tpm_aclient_pending(const tpm_aclient *ac);
+int tpm_aclient_start(tpm_aclient *ac, const struct sockaddr_in *peer, const tpm_sync_opts *opts,
+                      tpm_key_cb cb, void *arg);
+int tpm_aclient_poll(tpm_aclient *ac, int timeout_ms);
+
+/* evserver.c */
+int tpm_evserver_run(int listen_fd, const tpm_evserver_cfg *cfg, tpm_evserver_stats *st);
+void tpm_evserver_report(const char *tag, tpm_evserver_stats *st);
+void tpm_evserver_stats_free(tpm_evserver_stats *st);
+
+/* uring.c */
+int tpm_uring_server_run(int listen_fd, const tpm_evserver_cfg *cfg, tpm_evserver_stats *st);
+
+/* kernels.c */
+const tpm_rule_ops *tpm_rule_get(tpm_rule rule);
+int tpm_rule_parse(const char *name, tpm_rule *rule);
+const tpm_kernel *tpm_kernel_select(const tpm_shape *shape);
+const tpm_kernel *tpm_kernel_get(const char *name);
+
+/* packed.c */
+int tpm_bits_words(int N);
+size_t tpm_bits_len(const tpm_shape *shape);
+uint64_t *tpm_alloc_bits(const tpm_shape *shape);
+void tpm_pack_bits(const tpm_shape *shape, const int8_t *v, uint64_t *bits);
+void tpm_unpack_bits(const tpm_shape *shape, const uint64_t *bits, int8_t *v);
+void generate_input_bits(const tpm_shape *shape, uint64_t *bits);
+int tpm_enable_packed(TPM *tpm);
+void tpm_packed_free(tpm_packed *p);
+void tpm_sync_weights(TPM *tpm);
+void calculate_tau_bits(TPM *tpm, const uint64_t *x);
+void update_weights_bits(TPM *tpm, const uint64_t *theta);
+void packed_calc_tau_i8(TPM *tpm, const int8_t *x);
+void packed_update_i8(TPM *tpm, const int8_t *theta);
+
+/* proto.c */
+int tpm_conn_init(tpm_conn *c, int fd);
+void tpm_conn_free(tpm_conn *c);
+int tpm_conn_queue(tpm_conn *c, const tpm_msg_hdr *h, const void *payload, size_t len);
+int tpm_conn_flush(tpm_conn *c);
+int tpm_conn_fill(tpm_conn *c);
+int tpm_conn_next(tpm_conn *c, tpm_msg_hdr *h, const uint8_t **payload);
+int tpm_send_msg(tpm_conn *c, const tpm_msg_hdr *h, const void *payload, size_t len);
+int tpm_recv_msg(tpm_conn *c, tpm_msg_hdr *h, const uint8_t **payload);
+int tpm_conn_append(tpm_conn *c, const void *data, size_t len);
+ssize_t tpm_conn_read(tpm_conn *c, void *buf, size_t len);
+size_t tpm_wire_bits_len(const tpm_shape *shape);
+void tpm_bits_to_wire(const tpm_shape *shape, const uint64_t *bits, uint8_t *out);
+void tpm_bits_from_wire(const tpm_shape *shape, const uint8_t *in, uint64_t *bits);
+void tpm_encode_hello(uint8_t out[TPM_HELLO_SIZE], const tpm_hello_info *info);
+void tpm_put_u64(uint8_t *p, uint64_t v);
+uint64_t tpm_get_u64(const uint8_t *p);
+int tpm_decode_hello(const uint8_t *in, size_t len, tpm_hello_info *info);
+
+/* rng.c */
+uint64_t tpm_mix64(uint64_t z);
+uint64_t tpm_ctr64(uint64_t key, uint64_t ctr);
+void tpm_stream_bits(uint64_t seed, uint32_t round, int stream, const tpm_shape *shape, uint64_t *bits);
+uint64_t tpm_stream_seed(uint64_t server_nonce, uint64_t client_nonce);
+int tpm_random_bytes(void *buf, size_t len);
+void tpm_rand_seed(uint64_t seed);
+uint64_t tpm_rand64(void);
+uint64_t tpm_rand_step(uint64_t *state);
+uint64_t tpm_rand_state(void);
+uint32_t tpm_rand_below(uint32_t n);
+
+/* sha256.c */
+void tpm_sha256_init(tpm_sha256_ctx *s);
+void tpm_sha256_update(tpm_sha256_ctx *s, const void *data, size_t len);
+void tpm_sha256_final(tpm_sha256_ctx *s, uint8_t out[TPM_SHA256_SIZE]);
+void tpm_sha256(const void *data, size_t len, uint8_t out[TPM_SHA256_SIZE]);
+void tpm_hmac_init(tpm_hmac_ctx *m, const uint8_t *key, size_t key_len);
+void tpm_hmac_tag(const tpm_hmac_ctx *m, const void *msg, size_t len, uint8_t out[TPM_SHA256_SIZE]);
+
+/* keymac.c */
+int tpm_keymac_init(tpm_keymac *m, const tpm_shape *shape);
+void tpm_keymac_free(tpm_keymac *m);
+void tpm_keymac_reset(tpm_keymac *m);
+void tpm_keymac_touch(tpm_keymac *m, const TPM *tpm);
+void tpm_keymac_tag(tpm_keymac *m, TPM *tpm, uint64_t salt, uint32_t round, uint8_t out[TPM_TAG_SIZE]);
+void tpm_keymac_derive(tpm_keymac *m, TPM *tpm, uint64_t salt, uint8_t out[TPM_KEY_SIZE]);
+
+/* session.c */
+tpm_session *tpm_session_server(int fd, const tpm_hello_info *params, const tpm_sync_opts *opts);
+tpm_session *tpm_session_client(int fd, const tpm_sync_opts *opts);
+void tpm_session_free(tpm_session *s);
+tpm_sess_state tpm_session_step(tpm_session *s);
+tpm_sess_state tpm_session_run(tpm_session *s);
+tpm_sess_state tpm_session_on_readable(tpm_session *s);
+tpm_sess_state tpm_session_on_data(tpm_session *s, const void *data, size_t len);
+void tpm_session_on_eof(tpm_session *s);
+int tpm_session_flush(tpm_session *s);
+int tpm_session_want_write(const tpm_session *s);
+tpm_sess_state tpm_session_state(const tpm_session *s);
+TPM *tpm_session_tpm(tpm_session *s);
+tpm_conn *tpm_session_conn(tpm_session *s);
+const tpm_hello_info *tpm_session_info(const tpm_session *s);
+const tpm_sync_result *tpm_session_result(const tpm_session *s);
+int tpm_session_key(tpm_session *s, uint8_t out[TPM_KEY_SIZE]);
+
+/* qctl.c */
+int tpm_qctl_init(tpm_qctl *c, const tpm_shape *shape, int h_min, int h_max);
+int tpm_qctl_observe(tpm_qctl *c, const TPM *a, int agree);
+
+/* restart.c */
+uint32_t tpm_luby(uint32_t i);
+uint32_t tpm_restart_budget(const tpm_restart_policy *p, uint32_t attempt);
+
+/* sim.c */
+int tpm_sim_run(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads, tpm_sim_trial *out);
+int tpm_sim_run_stats(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads,
+                      tpm_sim_stats *st);
+int tpm_sim_stats_add(tpm_sim_stats *st, const tpm_sim_trial *t);
+int tpm_sim_stats_merge(tpm_sim_stats *dst, const tpm_sim_stats *src);
+void tpm_sim_stats_free(tpm_sim_stats *st);
+void tpm_sim_stats_write(FILE *f, const tpm_sim_stats *st);
+const char *tpm_sim_stats_read(const char *p, tpm_sim_stats *st);
+
+/* attack.c */
+int tpm_attack_run(const tpm_attack_cfg *cfg, uint64_t seed, uint64_t first, uint64_t n, int threads,
+                   tpm_attack_stats *st);
+int tpm_attack_stats_merge(tpm_attack_stats *dst, const tpm_attack_stats *src);
+void tpm_attack_stats_free(tpm_attack_stats *st);
+
+/* majority.c */
+tpm_majority *tpm_majority_new(const tpm_shape *shape, tpm_rule rule, int attackers, int majority);
+void tpm_majority_free(tpm_majority *e);
+void tpm_majority_randomize(tpm_majority *e);
+void tpm_majority_round(tpm_majority *e, const int8_t *x, const int8_t *theta, int tau);
+int tpm_majority_match(const tpm_majority *e, const int8_t *weights);
+void tpm_majority_get(const tpm_majority *e, int m, int8_t *weights);
+
+/* genetic.c */
+tpm_genetic *tpm_genetic_new(const tpm_shape *shape, tpm_rule rule, int capacity);
+void tpm_genetic_free(tpm_genetic *g);
+void tpm_genetic_reset(tpm_genetic *g);
+void tpm_genetic_round(tpm_genetic *g, const int8_t *x, const int8_t *theta, int tau);
+int tpm_genetic_size(const tpm_genetic *g);
+int tpm_genetic_match(const tpm_genetic *g, const int8_t *weights);
+
+/* bitslice.c */
+int tpm_bitslice_lanes(void);
+int tpm_bitslice_run(const tpm_sim_cfg *cfg, uint64_t seed, uint64_t first, tpm_sim_take_fn take,
+                     tpm_sim_put_fn put, void *ctx);
+
+/* stats.c */
+int tpm_stats_add(tpm_stats *s, uint64_t v);
+int tpm_stats_merge(tpm_stats *dst, const tpm_stats *src);
+void tpm_stats_reset(tpm_stats *s);
+void tpm_stats_free(tpm_stats *s);
+double tpm_stats_mean(const tpm_stats *s);
+double tpm_stats_sd(const tpm_stats *s);
+uint64_t tpm_stats_quantile(const tpm_stats *s, double q);
+uint64_t tpm_stats_count_ge(const tpm_stats *s, uint64_t v);
+uint64_t tpm_stats_bin(const tpm_stats *s, uint32_t i, uint64_t *lo, uint64_t *width);
+void tpm_stats_json(FILE *f, const tpm_stats *s);
+void tpm_stats_csv_header(FILE *f, const char *prefix);
+void tpm_stats_csv_row(FILE *f, const tpm_stats *s);
+void tpm_stats_write(FILE *f, const tpm_stats *s);
+const char *tpm_stats_read(const char *p, tpm_stats *s);
+
+/* sweep.c */
+uint64_t tpm_sweep_cell_seed(uint64_t seed, const tpm_sim_cfg *sim);
+int tpm_sweep_exec(const tpm_sweep_unit *u, tpm_sim_stats *st);
+long tpm_sweep_run(const tpm_sweep_unit *units, const size_t *todo, size_t n, const tpm_sweep_sched *s,
+                   unsigned long *steals);
+int tpm_sweep_ckpt_open(const char *path, const char *header, const tpm_sweep_unit *units, size_t n,
+                        uint8_t *done, tpm_sweep_done_fn load, void *ctx);
+int tpm_sweep_ckpt_append(int fd, const tpm_sweep_unit *u, const tpm_sim_stats *st);
+
+/* markov.c */
+double tpm_markov_space(const tpm_markov_cfg *cfg);
+int tpm_markov_solve(const tpm_markov_cfg *cfg, tpm_markov_result *res);
+double tpm_markov_mean(const tpm_markov_result *res);
+double tpm_markov_sd(const tpm_markov_result *res);
+uint32_t tpm_markov_quantile(const tpm_markov_result *res, double q);
+void tpm_markov_free(tpm_markov_result *res);
+
+/* simd.c */
+extern const tpm_simd_ops tpm_simd_scalar;
+const tpm_simd_ops *tpm_simd_select(void);
+const tpm_simd_ops *tpm_simd_get(const char *name);
+
+/* report.c */
+uint64_t tpm_now_ns(void);
+int tpm_lat_add(tpm_lat *l, uint64_t ns);
+uint64_t tpm_lat_pct(tpm_lat *l, double q);
+void tpm_lat_free(tpm_lat *l);
+long get_memory_usage_kb(void);
+void print_bar_graph(const char *label, long value, long maxValue);
+void show_result_graph(int sync_iter, int rep_steps, long mem_kb);
+
+#endif
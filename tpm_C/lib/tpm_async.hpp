@@ -0,0 +1,74 @@
+#ifndef TPM_ASYNC_HPP
+#define TPM_ASYNC_HPP
+
+/*
+ * aclient.c 의 C++20 코루틴 포장. 한 스레드에서 여러 코루틴이 키 교환을 co_await 한다.
+ *
+ *   tpm::key_result r = co_await tpm::exchange(ac, peer);
+ *   if (r.ok()) use(r.key);
+ *
+ * 코루틴은 tpm_aclient_poll 안(콜백)에서 재개된다. 교환을 시작하지 못하면 기다리지 않고
+ * 바로 err 를 채워 돌아온다. 어떤 task 타입에서든 co_await 할 수 있다.
+ */
+
+#include <array>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+#include "tpm.h"
+}
+
+namespace tpm {
+
+struct key_result {
+    int err = 0;                                // 0 이면 성공, 아니면 errno 값
+    std::array<std::uint8_t, TPM_KEY_SIZE> key{};
+    tpm_sync_result sync{};
+
+    bool ok() const { return err == 0; }
+};
+
+class exchange_awaiter {
+public:
+    exchange_awaiter(tpm_aclient *ac, const sockaddr_in &peer, const tpm_sync_opts &opts)
+        : ac_(ac), peer_(peer), opts_(opts) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        h_ = h;
+        if (tpm_aclient_start(ac_, &peer_, &opts_, &exchange_awaiter::on_done, this) < 0) {
+            res_.err = errno != 0 ? errno : EIO;
+            return false;
+        }
+        return true;
+    }
+
+    key_result await_resume() const noexcept { return res_; }
+
+private:
+    static void on_done(void *arg, int err, const std::uint8_t *key, const tpm_sync_result *res) {
+        auto *self = static_cast<exchange_awaiter *>(arg);
+        self->res_.err = err;
+        if (key != nullptr) std::memcpy(self->res_.key.data(), key, TPM_KEY_SIZE);
+        self->res_.sync = *res;
+        self->h_.resume();
+    }
+
+    tpm_aclient *ac_;
+    sockaddr_in peer_;
+    tpm_sync_opts opts_;
+    std::coroutine_handle<> h_;
+    key_result res_;
+};
+
+inline exchange_awaiter exchange(tpm_aclient *ac, const sockaddr_in &peer, const tpm_sync_opts &opts = {}) {
+    return exchange_awaiter(ac, peer, opts);
+}
+
+}  // namespace tpm
+
+#endif
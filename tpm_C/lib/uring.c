@@ -0,0 +1,462 @@
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "tpm.h"
+
+/*
+ * io_uring 으로 도는 다중 세션 서버 (evserver.c 의 epoll 루프와 같은 세션 상태 기계).
+ * liburing 없이 시스템 콜 세 개(setup/enter/register)와 mmap 한 링을 직접 쓴다.
+ *
+ *   - accept 는 multishot 하나로 계속 받는다.
+ *   - 연결마다 multishot recv 하나를 걸어 두고, 커널은 등록해 둔 버퍼 링(provided buffers)에서
+ *     버퍼를 골라 채운다. 받은 바이트는 세션의 rbuf 로 옮기고 버퍼는 바로 링에 돌려준다.
+ *   - 세션이 쌓은 프레임은 연결별 송신 버퍼로 옮겨 SEND 로 보낸다. 한 연결에 SEND 는 하나만 걸어 둔다.
+ *   - 완료를 한 번에 모아 처리하는 동안 만든 SQE 는 다음 io_uring_enter 한 번으로 모두 제출하고
+ *     같은 호출에서 다음 완료를 기다린다. 세션 수와 상관없이 루프 한 바퀴에 시스템 콜 하나다.
+ *   - 끝난 연결은 SHUTDOWN 을 걸어 recv 를 끝내고, 마지막 완료가 오면 CLOSE 를 건다.
+ */
+
+#define UR_ENTRIES 4096
+#define UR_BUFS 4096        // 수신 버퍼 수 (2 의 거듭제곱)
+#define UR_BUF_SIZE 2048
+#define UR_BGID 7
+
+enum { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_SHUTDOWN, OP_CLOSE };
+
+typedef struct {
+    tpm_session *sess;
+    uint8_t *sbuf;          // SEND 중인 바이트 (세션 wbuf 는 그 사이 계속 쌓일 수 있다)
+    size_t scap, slen, soff;
+    int sending, receiving, closing, shutting;
+} ur_conn;
+
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_sz, cq_sz, sqes_sz;
+    unsigned sq_local;      // 아직 제출하지 않은 SQE 까지 포함한 tail
+    unsigned to_submit;
+    struct io_uring_buf_ring *br;
+    size_t br_sz;
+    uint8_t *bufs;
+    unsigned br_tail;
+    uint64_t enters;
+} ur_ring;
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned op, void *arg, unsigned n) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+static void ring_free(ur_ring *r) {
+    if (r->br != NULL) munmap(r->br, r->br_sz);
+    free(r->bufs);
+    if (r->sqes != NULL) munmap(r->sqes, r->sqes_sz);
+    if (r->cq_ptr != NULL && r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_sz);
+    if (r->sq_ptr != NULL) munmap(r->sq_ptr, r->sq_sz);
+    if (r->fd >= 0) close(r->fd);
+}
+
+static void buf_recycle(ur_ring *r, unsigned bid) {
+    struct io_uring_buf *b = &r->br->bufs[r->br_tail & (UR_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)(r->bufs + (size_t)bid * UR_BUF_SIZE);
+    b->len = UR_BUF_SIZE;
+    b->bid = (uint16_t)bid;
+    r->br_tail++;
+    __atomic_store_n(&r->br->tail, (uint16_t)r->br_tail, __ATOMIC_RELEASE);
+}
+
+static int ring_init(ur_ring *r) {
+    struct io_uring_params p;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    // 한 스레드만 제출하고, 완료 작업은 enter 할 때 몰아서 돌게 한다 (지원하지 않는 커널이면 기본값)
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    p.cq_entries = UR_ENTRIES * 4;
+    r->fd = sys_setup(UR_ENTRIES, &p);
+    if (r->fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = UR_ENTRIES * 4;
+        r->fd = sys_setup(UR_ENTRIES, &p);
+    }
+    if (r->fd < 0) return -1;
+
+    r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_sz > r->sq_sz) r->sq_sz = r->cq_sz;
+        r->cq_sz = r->sq_sz;
+    }
+    r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        r->sq_ptr = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            r->cq_ptr = NULL;
+            goto fail;
+        }
+    }
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    uint8_t *sq = r->sq_ptr, *cq = r->cq_ptr;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sq_local = *r->sq_tail;
+
+    // 수신 버퍼 링을 커널에 등록한다
+    r->br_sz = UR_BUFS * sizeof(struct io_uring_buf);
+    r->br = mmap(NULL, r->br_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    r->bufs = malloc((size_t)UR_BUFS * UR_BUF_SIZE);
+    if (r->br == MAP_FAILED || r->bufs == NULL) {
+        if (r->br == MAP_FAILED) r->br = NULL;
+        goto fail;
+    }
+    struct io_uring_buf_reg reg = { .ring_addr = (uint64_t)(uintptr_t)r->br, .ring_entries = UR_BUFS, .bgid = UR_BGID };
+    if (sys_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) goto fail;
+    for (unsigned i = 0; i < UR_BUFS; i++) buf_recycle(r, i);
+    return 0;
+
+fail:
+    ring_free(r);
+    return -1;
+}
+
+/* 쌓인 SQE 를 제출하고 wait 개 이상 완료될 때까지 기다린다 */
+static int ring_enter(ur_ring *r, unsigned wait) {
+    __atomic_store_n(r->sq_tail, r->sq_local, __ATOMIC_RELEASE);
+    for (;;) {
+        int n = sys_enter(r->fd, r->to_submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+        r->enters++;
+        if (n >= 0) {
+            r->to_submit -= (unsigned)n < r->to_submit ? (unsigned)n : r->to_submit;
+            return 0;
+        }
+        if (errno == EINTR) continue;
+        // 완료 큐가 차서 못 넣은 것은 다음 enter 에서 다시 낸다
+        if (errno == EBUSY || errno == EAGAIN) return 0;
+        return -1;
+    }
+}
+
+static struct io_uring_sqe *get_sqe(ur_ring *r) {
+    if (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= UR_ENTRIES) {
+        // SQ 가 찼다: 기다리지 않고 지금까지 것을 제출한다
+        if (ring_enter(r, 0) < 0) return NULL;
+        if (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= UR_ENTRIES) return NULL;
+    }
+    unsigned idx = r->sq_local & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    r->sq_local++;
+    r->to_submit++;
+    return sqe;
+}
+
+static uint64_t ud(int fd, int op) {
+    return (uint64_t)(uint32_t)fd << 8 | (uint64_t)op;
+}
+
+/* ---- 서버 ---- */
+
+typedef struct {
+    ur_ring ring;
+    int lfd;
+    const tpm_evserver_cfg *cfg;
+    tpm_evserver_stats *st;
+    ur_conn *conns;         // fd 로 찾는다
+    int nconns;
+    int accept_armed;
+} ur_loop;
+
+static int arm_accept(ur_loop *u) {
+    struct io_uring_sqe *sqe = get_sqe(&u->ring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = u->lfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = ud(u->lfd, OP_ACCEPT);
+    u->accept_armed = 1;
+    return 0;
+}
+
+static int arm_recv(ur_loop *u, int fd) {
+    struct io_uring_sqe *sqe = get_sqe(&u->ring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = UR_BGID;
+    sqe->user_data = ud(fd, OP_RECV);
+    u->conns[fd].receiving = 1;
+    return 0;
+}
+
+static int arm_send(ur_loop *u, int fd) {
+    ur_conn *c = &u->conns[fd];
+    struct io_uring_sqe *sqe = get_sqe(&u->ring);
+    if (sqe == NULL) return -1;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)(c->sbuf + c->soff);
+    sqe->len = (uint32_t)(c->slen - c->soff);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = ud(fd, OP_SEND);
+    c->sending = 1;
+    return 0;
+}
+
+/* 세션 송신 버퍼에 쌓인 프레임을 연결 송신 버퍼로 옮겨 SEND 를 건다 */
+static int start_send(ur_loop *u, int fd) {
+    ur_conn *c = &u->conns[fd];
+    tpm_conn *tc = tpm_session_conn(c->sess);
+    size_t n = tc->wlen - tc->wpos;
+
+    if (c->sending || n == 0) return 0;
+    if (n > c->scap) {
+        uint8_t *nb = realloc(c->sbuf, n);
+        if (nb == NULL) return -1;
+        c->sbuf = nb;
+        c->scap = n;
+    }
+    memcpy(c->sbuf, tc->wbuf + tc->wpos, n);
+    tc->wpos = tc->wlen = 0;
+    tc->bytes_out += n;
+    c->slen = n;
+    c->soff = 0;
+    return arm_send(u, fd);
+}
+
+/*
+ * 끝난 연결: SHUTDOWN 으로 걸린 recv/send 를 끝낸다. SHUTDOWN 까지 포함해 걸린 요청이 다 돌아오면 CLOSE.
+ * SQE 는 순서대로 실행된다는 보장이 없어서, SHUTDOWN 이 CLOSE 뒤에 돌면 같은 fd 번호로 새로 받은 연결을 끊는다.
+ */
+static void begin_close(ur_loop *u, int fd) {
+    ur_conn *c = &u->conns[fd];
+    if (c->closing) return;
+    c->closing = 1;
+    if (!c->sending && !c->receiving) return;
+    struct io_uring_sqe *sqe = get_sqe(&u->ring);
+    if (sqe == NULL) {
+        shutdown(fd, SHUT_RDWR);
+        return;
+    }
+    sqe->opcode = IORING_OP_SHUTDOWN;
+    sqe->fd = fd;
+    sqe->len = SHUT_RDWR;
+    sqe->user_data = ud(fd, OP_SHUTDOWN);
+    c->shutting = 1;
+}
+
+static void finish_close(ur_loop *u, int fd) {
+    ur_conn *c = &u->conns[fd];
+    tpm_session *s = c->sess;
+    const tpm_sync_result *res = tpm_session_result(s);
+
+    u->st->restarts += (uint64_t)res->restarts;
+    if (tpm_session_state(s) == TPM_SESS_DONE) {
+        u->st->done++;
+        u->st->rounds += (uint64_t)res->iterations;
+        tpm_stats_add(&u->st->lat, res->elapsed_ns);
+        tpm_stats_add(&u->st->sync_ns, res->elapsed_ns);
+        tpm_stats_add(&u->st->iters, (uint64_t)res->iterations);
+    } else {
+        u->st->failed++;
+    }
+    u->st->active--;
+    u->st->syscalls += tpm_session_conn(s)->syscalls;   // setsockopt(TCP_NODELAY)
+    tpm_session_free(s);
+    free(c->sbuf);
+    memset(c, 0, sizeof(*c));
+
+    struct io_uring_sqe *sqe = get_sqe(&u->ring);
+    if (sqe == NULL) {
+        close(fd);
+        u->st->syscalls++;
+        return;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = ud(fd, OP_CLOSE);
+}
+
+/* 세션이 진행된 뒤: 보낼 것을 보내고, 끝났으면 닫기 시작한다 */
+static void settle(ur_loop *u, int fd) {
+    ur_conn *c = &u->conns[fd];
+    tpm_sess_state state = tpm_session_state(c->sess);
+
+    if (state != TPM_SESS_FAILED && start_send(u, fd) < 0) {
+        tpm_session_on_eof(c->sess);
+        state = TPM_SESS_FAILED;
+    }
+    if (state == TPM_SESS_FAILED || (state == TPM_SESS_DONE && !c->sending)) begin_close(u, fd);
+    if (c->closing && !c->sending && !c->receiving && !c->shutting) finish_close(u, fd);
+}
+
+static void on_accept(ur_loop *u, const struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) u->accept_armed = 0;
+    if (cqe->res < 0) return;
+
+    int fd = cqe->res;
+    if (fd >= u->nconns) {
+        close(fd);
+        u->st->failed++;
+        return;
+    }
+    tpm_session *s = tpm_session_server(fd, &u->cfg->params, &u->cfg->opts);
+    if (s == NULL) {
+        close(fd);
+        u->st->failed++;
+        return;
+    }
+    u->st->accepted++;
+    if (++u->st->active > u->st->peak_active) u->st->peak_active = u->st->active;
+    u->conns[fd].sess = s;
+    if (arm_recv(u, fd) < 0) tpm_session_on_eof(s);
+    settle(u, fd);
+}
+
+static void on_recv(ur_loop *u, int fd, const struct io_uring_cqe *cqe) {
+    ur_conn *c = &u->conns[fd];
+    if (!(cqe->flags & IORING_CQE_F_MORE)) c->receiving = 0;
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (cqe->res > 0 && !c->closing)
+            tpm_session_on_data(c->sess, u->ring.bufs + (size_t)bid * UR_BUF_SIZE, (size_t)cqe->res);
+        buf_recycle(&u->ring, bid);
+    }
+    if (!c->closing) {
+        if (cqe->res == -ENOBUFS) {
+            // 버퍼 링이 잠깐 비었다: 다시 건다
+            if (!c->receiving && arm_recv(u, fd) < 0) tpm_session_on_eof(c->sess);
+        } else if (cqe->res <= 0) {
+            tpm_session_on_eof(c->sess);
+        } else if (!c->receiving && arm_recv(u, fd) < 0) {
+            tpm_session_on_eof(c->sess);
+        }
+    }
+    settle(u, fd);
+}
+
+static void on_send(ur_loop *u, int fd, const struct io_uring_cqe *cqe) {
+    ur_conn *c = &u->conns[fd];
+    c->sending = 0;
+    if (cqe->res < 0) {
+        tpm_session_on_eof(c->sess);
+    } else {
+        c->soff += (size_t)cqe->res;
+        if (c->soff < c->slen && arm_send(u, fd) < 0) tpm_session_on_eof(c->sess);
+    }
+    settle(u, fd);
+}
+
+/*
+ * tpm_evserver_run 과 같은 일을 io_uring 으로 한다 (워커 하나).
+ * st->syscalls 는 io_uring_enter 횟수에 링 밖에서 부른 시스템 콜을 더한 것이다.
+ */
+int tpm_uring_server_run(int listen_fd, const tpm_evserver_cfg *cfg, tpm_evserver_stats *st) {
+    struct rlimit rl;
+    ur_loop u = { .lfd = listen_fd, .cfg = cfg, .st = st };
+    int ret = -1;
+
+    memset(st, 0, sizeof(*st));
+    st->started_ns = tpm_now_ns();
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) return -1;
+    u.nconns = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (1u << 20) ? (1 << 20) : (int)rl.rlim_cur;
+    u.conns = calloc((size_t)u.nconns, sizeof(*u.conns));
+    if (u.conns == NULL) return -1;
+    if (ring_init(&u.ring) < 0) {
+        free(u.conns);
+        return -1;
+    }
+
+    uint64_t next_report = st->started_ns + (uint64_t)cfg->report_ms * 1000000ULL;
+    while (cfg->max_sessions == 0 || st->done + st->failed < cfg->max_sessions) {
+        if (!u.accept_armed && arm_accept(&u) < 0) goto out;
+        if (ring_enter(&u.ring, 1) < 0) {
+            perror("io_uring_enter");
+            goto out;
+        }
+
+        unsigned head = *u.ring.cq_head;
+        unsigned tail = __atomic_load_n(u.ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe = &u.ring.cqes[head & *u.ring.cq_mask];
+            int fd = (int)(cqe->user_data >> 8);
+            switch (cqe->user_data & 0xff) {
+            case OP_ACCEPT:
+                on_accept(&u, cqe);
+                break;
+            case OP_RECV:
+                if (u.conns[fd].sess != NULL) on_recv(&u, fd, cqe);
+                break;
+            case OP_SEND:
+                if (u.conns[fd].sess != NULL) on_send(&u, fd, cqe);
+                break;
+            case OP_SHUTDOWN:
+                u.conns[fd].shutting = 0;
+                if (u.conns[fd].sess != NULL) settle(&u, fd);
+                break;
+            default:    // CLOSE: 따로 할 일 없다
+                break;
+            }
+        }
+        __atomic_store_n(u.ring.cq_head, head, __ATOMIC_RELEASE);
+
+        if (cfg->report_ms > 0 && tpm_now_ns() >= next_report) {
+            st->syscalls += u.ring.enters;
+            u.ring.enters = 0;
+            tpm_evserver_report("uring", st);
+            tpm_stats_reset(&st->lat);
+            next_report = tpm_now_ns() + (uint64_t)cfg->report_ms * 1000000ULL;
+        }
+    }
+    ret = 0;
+
+out:
+    st->syscalls += u.ring.enters;
+    tpm_stats_reset(&st->lat);      // 반환할 때는 전체 (evserver 와 같다)
+    tpm_stats_merge(&st->lat, &st->sync_ns);
+    for (int fd = 0; fd < u.nconns; fd++) {
+        if (u.conns[fd].sess == NULL) continue;
+        close(fd);
+        tpm_session_free(u.conns[fd].sess);
+        free(u.conns[fd].sbuf);
+    }
+    ring_free(&u.ring);
+    free(u.conns);
+    return ret;
+}
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "tpm.h"
+
+/*
+ * 비대화형 부하 발생기. 한 스레드에서 aclient 로 키 교환을 동시에 여러 개 돌리고
+ * 동기화 시간 백분위, 라운드 수, 주고받은 바이트, 실패를 사람이 읽는 형식이나 JSON 으로 낸다.
+ *
+ *   --rate r 이면 세션 i 를 t0 + i/r 에 연다 (열린 루프). 동시 연결이 --concurrency 에 걸려
+ *   늦게 열리더라도 시간은 예정 시각부터 잰다. 서버가 밀리면 그만큼 동기화 시간에 드러난다.
+ *   --rate 0 이면 동시 연결 수만큼 계속 채운다 (닫힌 루프).
+ *
+ * 규칙과 K/N/L 은 서버가 HELLO 로 정한다. --local 이면 그 설정으로 evserver 를 자식 프로세스로 띄우고
+ * 루프백으로 붙는다.
+ */
+
+typedef struct lg_slot {
+    struct lg_slot *next;
+    uint64_t due_ns;        // 예정 시각
+    struct lg_run *run;
+} lg_slot;
+
+typedef struct lg_run {
+    tpm_aclient *ac;
+    lg_slot *slots, *free_slots;
+    unsigned long total, started, done;
+    unsigned long failed_start, failed_connect, failed_proto;
+    unsigned long active;
+    unsigned long long bytes_out, bytes_in;
+    tpm_lat sync_ns, iters;
+    tpm_lat fail_ns;        // 실패한 세션이 예정 시각부터 실패할 때까지 걸린 시간
+} lg_run;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n|--sessions n] [-C|--concurrency n] [--rate r] [--packed] [--json]\n"
+                    "       [--local [--rule random|anti|query] [--H n] [-K n] [-N n] [-L n] [--seeded] [--duplex] "
+                    "[--check-every n] [--max-rounds n] [--max-repulsive n] [--restart n] [--luby]]\n"
+                    "       [host port]\n", prog);
+    exit(1);
+}
+
+static void on_key(void *arg, int err, const uint8_t *key, const tpm_sync_result *res) {
+    lg_slot *slot = arg;
+    lg_run *run = slot->run;
+    (void)key;
+
+    if (err == 0) {
+        run->done++;
+        tpm_lat_add(&run->sync_ns, tpm_now_ns() - slot->due_ns);
+        tpm_lat_add(&run->iters, (uint64_t)res->iterations);
+    } else {
+        if (err == EPROTO) run->failed_proto++;
+        else run->failed_connect++;
+        tpm_lat_add(&run->fail_ns, tpm_now_ns() - slot->due_ns);
+    }
+    run->bytes_out += res->bytes_out;
+    run->bytes_in += res->bytes_in;
+    run->active--;
+    slot->next = run->free_slots;
+    run->free_slots = slot;
+}
+
+/* --local: 같은 설정의 evserver 를 자식 프로세스로 띄우고 그 주소를 addr 에 넣는다 */
+static pid_t spawn_local(const tpm_evserver_cfg *cfg, struct sockaddr_in *addr) {
+    socklen_t alen = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int lfd = tpm_listen_tcp(addr, SOMAXCONN);
+    if (lfd < 0 || getsockname(lfd, (struct sockaddr *)addr, &alen) < 0) ErrorHandling("listen");
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) ErrorHandling("fork");
+    if (pid == 0) {
+        tpm_evserver_stats st;
+        uint64_t seed;
+        if (tpm_random_bytes(&seed, sizeof(seed)) == 0) tpm_rand_seed(seed);
+        _exit(tpm_evserver_run(lfd, cfg, &st) < 0);
+    }
+    close(lfd);
+    return pid;
+}
+
+static void drive(lg_run *run, const struct sockaddr_in *peer, const tpm_sync_opts *opts, double rate) {
+    uint64_t period = rate > 0 ? (uint64_t)(1e9 / rate) : 0;
+    uint64_t next_due = tpm_now_ns();
+
+    while (run->done + run->failed_start + run->failed_connect + run->failed_proto < run->total) {
+        uint64_t now = tpm_now_ns();
+        while (run->started < run->total && run->free_slots != NULL && (period == 0 || next_due <= now)) {
+            lg_slot *slot = run->free_slots;
+            run->free_slots = slot->next;
+            slot->due_ns = period ? next_due : now;
+            next_due += period;
+            run->started++;
+            if (tpm_aclient_start(run->ac, peer, opts, on_key, slot) < 0) {
+                run->failed_start++;
+                slot->next = run->free_slots;
+                run->free_slots = slot;
+                continue;
+            }
+            run->active++;
+        }
+
+        // 다음 예정 시각까지만 기다린다 (연결 자리가 없으면 끝나는 세션이 깨워 준다)
+        int timeout = -1;
+        if (period && run->started < run->total && run->free_slots != NULL)
+            timeout = next_due > now ? (int)((next_due - now + 999999) / 1000000) : 0;
+        if (run->active == 0 && timeout < 0) continue;
+        if (tpm_aclient_poll(run->ac, timeout) < 0) ErrorHandling("tpm_aclient_poll");
+    }
+}
+
+static double ms(uint64_t ns) {
+    return (double)ns * 1e-6;
+}
+
+static void report_human(lg_run *run, const char *target, int conc, double rate, double sec) {
+    unsigned long failed = run->failed_start + run->failed_connect + run->failed_proto;
+    char rate_s[32] = "unlimited";
+    if (rate > 0) snprintf(rate_s, sizeof(rate_s), "%.0f/s", rate);
+    printf("[loadgen] %s: %lu sessions, concurrency %d, rate %s\n", target, run->total, conc, rate_s);
+    printf("  completed     %lu in %.2f s (%.1f sessions/s)\n", run->done, sec, sec > 0 ? run->done / sec : 0.0);
+    printf("  failed        %lu (start %lu, connect %lu, protocol %lu)\n", failed, run->failed_start,
+           run->failed_connect, run->failed_proto);
+    printf("  time to sync  p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  p999 %.2f ms  max %.2f ms\n",
+           ms(tpm_lat_pct(&run->sync_ns, 0.50)), ms(tpm_lat_pct(&run->sync_ns, 0.90)),
+           ms(tpm_lat_pct(&run->sync_ns, 0.99)), ms(tpm_lat_pct(&run->sync_ns, 0.999)),
+           ms(tpm_lat_pct(&run->sync_ns, 1.0)));
+    printf("  iterations    p50 %llu  p90 %llu  p99 %llu  p999 %llu  max %llu\n",
+           (unsigned long long)tpm_lat_pct(&run->iters, 0.50), (unsigned long long)tpm_lat_pct(&run->iters, 0.90),
+           (unsigned long long)tpm_lat_pct(&run->iters, 0.99), (unsigned long long)tpm_lat_pct(&run->iters, 0.999),
+           (unsigned long long)tpm_lat_pct(&run->iters, 1.0));
+    if (run->fail_ns.n > 0)
+        printf("  time to fail  p50 %.2f ms  max %.2f ms\n", ms(tpm_lat_pct(&run->fail_ns, 0.50)),
+               ms(tpm_lat_pct(&run->fail_ns, 1.0)));
+    unsigned long n = run->done + run->failed_connect + run->failed_proto;
+    printf("  bytes         out %llu, in %llu (%.0f B/session)\n", run->bytes_out, run->bytes_in,
+           n ? (double)(run->bytes_out + run->bytes_in) / n : 0.0);
+}
+
+static void report_json(lg_run *run, const char *target, int conc, double rate, double sec) {
+    printf("{\"target\":\"%s\",\"sessions\":%lu,\"concurrency\":%d,\"rate\":%.3f,\"elapsed_s\":%.3f,"
+           "\"completed\":%lu,\"sessions_per_s\":%.3f,"
+           "\"failed\":{\"start\":%lu,\"connect\":%lu,\"protocol\":%lu},",
+           target, run->total, conc, rate, sec, run->done, sec > 0 ? run->done / sec : 0.0,
+           run->failed_start, run->failed_connect, run->failed_proto);
+    printf("\"time_to_sync_ms\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f},",
+           ms(tpm_lat_pct(&run->sync_ns, 0.50)), ms(tpm_lat_pct(&run->sync_ns, 0.90)),
+           ms(tpm_lat_pct(&run->sync_ns, 0.99)), ms(tpm_lat_pct(&run->sync_ns, 0.999)),
+           ms(tpm_lat_pct(&run->sync_ns, 1.0)));
+    printf("\"iterations\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},",
+           (unsigned long long)tpm_lat_pct(&run->iters, 0.50), (unsigned long long)tpm_lat_pct(&run->iters, 0.90),
+           (unsigned long long)tpm_lat_pct(&run->iters, 0.99), (unsigned long long)tpm_lat_pct(&run->iters, 0.999),
+           (unsigned long long)tpm_lat_pct(&run->iters, 1.0));
+    printf("\"time_to_fail_ms\":{\"p50\":%.3f,\"max\":%.3f},", ms(tpm_lat_pct(&run->fail_ns, 0.50)),
+           ms(tpm_lat_pct(&run->fail_ns, 1.0)));
+    printf("\"bytes\":{\"out\":%llu,\"in\":%llu}}\n", run->bytes_out, run->bytes_in);
+}
+
+int main(int argc, char **argv) {
+    unsigned long total = 1000;
+    int conc = 100, json = 0, local = 0;
+    double rate = 0;
+    tpm_sync_opts opts = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    tpm_evserver_cfg cfg = { .opts = { 0, TPM_DEFAULT_WINDOW, 0, 0, 100000, 0, { 0, 0, 0 } }, .threads = 1 };
+    struct sockaddr_in peer;
+    char target[64];
+    pid_t child = -1;
+    struct rlimit rl;
+
+    cfg.params.rule = RULE_RANDOM_WALK;
+    cfg.params.shape = (tpm_shape){ DEFAULT_K, DEFAULT_N, DEFAULT_L };
+
+    static const struct option long_opts[] = {
+        { "sessions", required_argument, NULL, 'n' },
+        { "concurrency", required_argument, NULL, 'C' },
+        { "rate", required_argument, NULL, 'a' },
+        { "packed", no_argument,     NULL, 'p' },
+        { "json", no_argument,       NULL, 'j' },
+        { "local", no_argument,      NULL, 'l' },
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "seeded", no_argument,     NULL, 's' },
+        { "duplex", no_argument,     NULL, 'd' },
+        { "check-every", required_argument, NULL, 'c' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "max-repulsive", required_argument, NULL, 'E' },
+        { "restart", required_argument, NULL, 'T' },
+        { "luby", no_argument,       NULL, 'Y' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:C:r:H:K:N:L:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n':
+            total = strtoul(optarg, NULL, 10);
+            break;
+        case 'C':
+            conc = atoi(optarg);
+            break;
+        case 'a':
+            rate = atof(optarg);
+            break;
+        case 'p':
+            opts.packed = 1;
+            break;
+        case 'j':
+            json = 1;
+            break;
+        case 'l':
+            local = 1;
+            break;
+        case 'r':
+            if (tpm_rule_parse(optarg, &cfg.params.rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            cfg.opts.H = atoi(optarg);
+            break;
+        case 's':
+            cfg.params.flags |= TPM_F_SEEDED;
+            break;
+        case 'd':
+            cfg.params.flags |= TPM_F_DUPLEX;
+            break;
+        case 'c':
+            cfg.params.check_every = (uint32_t)atoi(optarg);
+            break;
+        case 'm':
+            cfg.opts.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'E':
+            cfg.opts.policy.max_repulsive = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            cfg.opts.policy.restart = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'Y':
+            cfg.opts.policy.luby = 1;
+            break;
+        case 'K':
+            cfg.params.shape.K = atoi(optarg);
+            break;
+        case 'N':
+            cfg.params.shape.N = atoi(optarg);
+            break;
+        case 'L':
+            cfg.params.shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (conc <= 0 || total == 0 || (!local && optind + 2 != argc)) usage(argv[0]);
+
+    // 동시 연결만큼 fd 가 필요하다
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (local) {
+        if (!tpm_shape_valid(&cfg.params.shape)) {
+            fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", cfg.params.shape.K, cfg.params.shape.N, cfg.params.shape.L);
+            return 1;
+        }
+        child = spawn_local(&cfg, &peer);
+        snprintf(target, sizeof(target), "local %s %d/%d/%d%s%s", tpm_rule_get(cfg.params.rule)->name,
+                 cfg.params.shape.K, cfg.params.shape.N, cfg.params.shape.L,
+                 (cfg.params.flags & TPM_F_DUPLEX) ? " duplex" : "", (cfg.params.flags & TPM_F_SEEDED) ? " seeded" : "");
+    } else {
+        memset(&peer, 0, sizeof(peer));
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(atoi(argv[optind + 1]));
+        if (inet_pton(AF_INET, argv[optind], &peer.sin_addr) <= 0) ErrorHandling("inet_pton");
+        snprintf(target, sizeof(target), "%s:%s", argv[optind], argv[optind + 1]);
+    }
+
+    lg_run run = { .total = total };
+    run.ac = tpm_aclient_new();
+    run.slots = calloc((size_t)conc, sizeof(*run.slots));
+    if (run.ac == NULL || run.slots == NULL) ErrorHandling("tpm_aclient_new");
+    for (int i = conc - 1; i >= 0; i--) {
+        run.slots[i].run = &run;
+        run.slots[i].next = run.free_slots;
+        run.free_slots = &run.slots[i];
+    }
+
+    uint64_t t0 = tpm_now_ns();
+    drive(&run, &peer, &opts, rate);
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+
+    if (json) report_json(&run, target, conc, rate, sec);
+    else report_human(&run, target, conc, rate, sec);
+
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    tpm_aclient_free(run.ac);
+    tpm_lat_free(&run.sync_ns);
+    tpm_lat_free(&run.iters);
+    tpm_lat_free(&run.fail_ns);
+    free(run.slots);
+    return run.done == total ? 0 : 2;
+}
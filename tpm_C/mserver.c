@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "tpm.h"
+
+/*
+ * 다중 세션 키 교환 서버. server 와 같은 프로토콜로 여러 클라이언트와 동시에 동기화하고,
+ * 동기화가 끝난 연결은 닫는다 (채팅 없음). 주기적으로 sessions/s 와 p50/p99 동기화 시간을 찍는다.
+ * --stats json|csv 면 끝날 때 전체 세션의 동기화 시간과 라운드 분포를 낸다.
+ * --uring 이면 epoll 워커 대신 io_uring 루프 하나로 돈다.
+ */
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule random|anti|query] [--H n] [--H-max n] [-K n] [-N n] [-L n] [--packed] [--seeded] [--duplex] "
+                    "[--window n] [--check-every n] [--max-rounds n] [--max-repulsive n] [--restart n] [--luby] "
+                    "[--threads n] [--uring] [--report-ms n] [--max-sessions n] [--stats json|csv] port\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int servSock;
+    struct sockaddr_in servAddr;
+    tpm_evserver_cfg cfg = { .opts = { 0, TPM_DEFAULT_WINDOW, 0, 0, 100000, 0, { 0, 0, 0 } }, .report_ms = 1000 };
+    tpm_evserver_stats st;
+    int uring = 0;
+    const char *stats = NULL;
+
+    cfg.params.rule = RULE_RANDOM_WALK;
+    cfg.params.shape = (tpm_shape){ DEFAULT_K, DEFAULT_N, DEFAULT_L };
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "H-max", required_argument, NULL, 'X' },
+        { "packed", no_argument,     NULL, 'p' },
+        { "seeded", no_argument,     NULL, 's' },
+        { "duplex", no_argument,     NULL, 'd' },
+        { "window", required_argument, NULL, 'w' },
+        { "check-every", required_argument, NULL, 'c' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "max-repulsive", required_argument, NULL, 'E' },
+        { "restart", required_argument, NULL, 'T' },
+        { "luby", no_argument,       NULL, 'Y' },
+        { "threads", required_argument, NULL, 't' },
+        { "uring", no_argument,      NULL, 'u' },
+        { "report-ms", required_argument, NULL, 'R' },
+        { "max-sessions", required_argument, NULL, 'M' },
+        { "stats", required_argument, NULL, 'S' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            if (tpm_rule_parse(optarg, &cfg.params.rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            cfg.opts.H = atoi(optarg);
+            break;
+        case 'X':
+            cfg.opts.H_max = atoi(optarg);
+            break;
+        case 'p':
+            cfg.opts.packed = 1;
+            break;
+        case 's':
+            cfg.params.flags |= TPM_F_SEEDED;
+            break;
+        case 'd':
+            cfg.params.flags |= TPM_F_DUPLEX;
+            break;
+        case 'w':
+            cfg.opts.window = atoi(optarg);
+            if (cfg.opts.window < 2) usage(argv[0]);     // 한 번에 두 라운드 이상 미리 보낸다
+            break;
+        case 'c':
+            cfg.params.check_every = (uint32_t)atoi(optarg);
+            break;
+        case 'm':
+            cfg.opts.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'E':
+            cfg.opts.policy.max_repulsive = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            cfg.opts.policy.restart = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'Y':
+            cfg.opts.policy.luby = 1;
+            break;
+        case 't':
+            cfg.threads = atoi(optarg);
+            break;
+        case 'u':
+            uring = 1;
+            break;
+        case 'R':
+            cfg.report_ms = atoi(optarg);
+            break;
+        case 'M':
+            cfg.max_sessions = strtoul(optarg, NULL, 10);
+            break;
+        case 'S':
+            if (strcmp(optarg, "json") != 0 && strcmp(optarg, "csv") != 0) usage(argv[0]);
+            stats = optarg;
+            break;
+        case 'K':
+            cfg.params.shape.K = atoi(optarg);
+            break;
+        case 'N':
+            cfg.params.shape.N = atoi(optarg);
+            break;
+        case 'L':
+            cfg.params.shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc) usage(argv[0]);
+
+    if (!tpm_shape_valid(&cfg.params.shape)) {
+        fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", cfg.params.shape.K, cfg.params.shape.N, cfg.params.shape.L);
+        return 1;
+    }
+    // --H-max 가 H 의 하한보다 낮으면 조절할 폭이 없어 고정 H 가 된다
+    tpm_qctl qc;
+    if (cfg.opts.H_max > 0 && tpm_qctl_init(&qc, &cfg.params.shape, cfg.opts.H, cfg.opts.H_max) < 0) {
+        fprintf(stderr, "--H-max %d is below the lower end of H (%d)\n", cfg.opts.H_max, qc.h_min);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&servAddr, 0, sizeof(servAddr));
+    servAddr.sin_family = AF_INET;
+    servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servAddr.sin_port = htons(atoi(argv[optind]));
+
+    // 워커마다 같은 포트에 SO_REUSEPORT 소켓을 하나씩 연다 (첫 번째가 이것)
+    servSock = tpm_listen_tcp(&servAddr, SOMAXCONN);
+    if (servSock < 0) ErrorHandling("listen");
+
+    if (uring) cfg.threads = 1;
+    printf("[mserver] rule %s, K=%d N=%d L=%d, %s%s, %s, %d worker(s), listening on port %s\n",
+           tpm_rule_get(cfg.params.rule)->name, cfg.params.shape.K, cfg.params.shape.N, cfg.params.shape.L,
+           (cfg.params.flags & TPM_F_DUPLEX) ? "duplex" : "lockstep",
+           (cfg.params.flags & TPM_F_SEEDED) ? "+seeded" : "", uring ? "io_uring" : "epoll",
+           cfg.threads > 0 ? cfg.threads : (int)sysconf(_SC_NPROCESSORS_ONLN), argv[optind]);
+
+    if (uring) {
+        if (tpm_uring_server_run(servSock, &cfg, &st) < 0) ErrorHandling("tpm_uring_server_run");
+    } else if (tpm_evserver_run(servSock, &cfg, &st) < 0) {
+        ErrorHandling("tpm_evserver_run");
+    }
+    tpm_evserver_report("mserver", &st);
+
+    // --stats: 처음부터 끝까지의 동기화 시간 (ns) 과 라운드 분포
+    if (stats != NULL && strcmp(stats, "json") == 0) {
+        printf("{\"done\":%lu,\"failed\":%lu,\"restarts\":%llu,\"sync_ns\":", st.done, st.failed,
+               (unsigned long long)st.restarts);
+        tpm_stats_json(stdout, &st.sync_ns);
+        printf(",\"iters\":");
+        tpm_stats_json(stdout, &st.iters);
+        printf("}\n");
+    } else if (stats != NULL) {
+        printf("done,failed,restarts,");
+        tpm_stats_csv_header(stdout, "sync_ns");
+        printf(",");
+        tpm_stats_csv_header(stdout, "iters");
+        printf("\n%lu,%lu,%llu,", st.done, st.failed, (unsigned long long)st.restarts);
+        tpm_stats_csv_row(stdout, &st.sync_ns);
+        printf(",");
+        tpm_stats_csv_row(stdout, &st.iters);
+        printf("\n");
+    }
+
+    tpm_evserver_stats_free(&st);
+    close(servSock);
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "tpm.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule random|anti|query] [--H n] [--H-max n] [-K n] [-N n] [-L n] [--packed] [--seeded] [--duplex] [--window n] "
+                    "[--check-every n] [--max-rounds n] [--max-repulsive n] [--restart n] [--luby] [port]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int servSock = -1, clntSock = -1;
+    struct sockaddr_in servAddr, clntAddr;
+    char message[BUFSIZE];
+    socklen_t clntAddrLen;
+    int nRcv;
+    int port = 0;
+    tpm_rule rule = RULE_RANDOM_WALK;
+    tpm_shape shape = { DEFAULT_K, DEFAULT_N, DEFAULT_L };
+    tpm_hello_info info = { 0 };
+    tpm_sync_opts sync_opts = { 0, TPM_DEFAULT_WINDOW, 1, 0, 0, 0, { 0, 0, 0 } };
+
+    tpm_session *sess;
+    TPM *tpm_A;
+    tpm_conn *conn;
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "H-max", required_argument, NULL, 'X' },
+        { "packed", no_argument,     NULL, 'p' },
+        { "seeded", no_argument,     NULL, 's' },
+        { "duplex", no_argument,     NULL, 'd' },
+        { "window", required_argument, NULL, 'w' },
+        { "check-every", required_argument, NULL, 'c' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "max-repulsive", required_argument, NULL, 'E' },
+        { "restart", required_argument, NULL, 'T' },
+        { "luby", no_argument,       NULL, 'Y' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            if (tpm_rule_parse(optarg, &rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            sync_opts.H = atoi(optarg);
+            break;
+        case 'X':
+            sync_opts.H_max = atoi(optarg);
+            break;
+        case 'p':
+            sync_opts.packed = 1;
+            break;
+        case 's':
+            info.flags |= TPM_F_SEEDED;
+            break;
+        case 'd':
+            info.flags |= TPM_F_DUPLEX;
+            break;
+        case 'w':
+            sync_opts.window = atoi(optarg);
+            if (sync_opts.window < 2) usage(argv[0]);     // 한 번에 두 라운드 이상 미리 보낸다
+            break;
+        case 'c':
+            info.check_every = (uint32_t)atoi(optarg);
+            break;
+        case 'm':
+            sync_opts.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'E':
+            sync_opts.policy.max_repulsive = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            sync_opts.policy.restart = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'Y':
+            sync_opts.policy.luby = 1;
+            break;
+        case 'K':
+            shape.K = atoi(optarg);
+            break;
+        case 'N':
+            shape.N = atoi(optarg);
+            break;
+        case 'L':
+            shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        port = atoi(argv[optind]);
+    } else {
+        printf("Port Number : ");
+        if (scanf("%d", &port) != 1) {
+            fprintf(stderr, "Invalid port\n");
+            return 1;
+        }
+        getchar();
+    }
+
+    if (!tpm_shape_valid(&shape)) {
+        fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", shape.K, shape.N, shape.L);
+        return 1;
+    }
+    // --H-max 가 H 의 하한보다 낮으면 조절할 폭이 없어 고정 H 가 된다
+    tpm_qctl qc;
+    if (sync_opts.H_max > 0 && tpm_qctl_init(&qc, &shape, sync_opts.H, sync_opts.H_max) < 0) {
+        fprintf(stderr, "--H-max %d is below the lower end of H (%d)\n", sync_opts.H_max, qc.h_min);
+        return 1;
+    }
+
+    servSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (servSock < 0) ErrorHandling("socket");
+
+    int on = 1;
+    setsockopt(servSock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&servAddr, 0, sizeof(servAddr));
+    servAddr.sin_family = AF_INET;
+    servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servAddr.sin_port = htons(port);
+
+    if (bind(servSock, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0)
+        ErrorHandling("bind");
+
+    if (listen(servSock, 5) < 0)
+        ErrorHandling("listen");
+
+    printf("Waiting for connection on port %d...\n", port);
+
+    clntAddrLen = sizeof(clntAddr);
+    clntSock = accept(servSock, (struct sockaddr *)&clntAddr, &clntAddrLen);
+    if (clntSock < 0)
+        ErrorHandling("accept");
+
+    printf("Client %s connected!\n", inet_ntoa(clntAddr.sin_addr));
+
+    // 클라이언트가 같은 구조·갱신 커널을 고르도록 규칙과 K/N/L 을 먼저 알려준다 (HELLO)
+    info.rule = rule;
+    info.shape = shape;
+    sess = tpm_session_server(clntSock, &info, &sync_opts);
+    if (sess == NULL) ErrorHandling("tpm_session_server");
+    tpm_A = tpm_session_tpm(sess);
+    conn = tpm_session_conn(sess);
+
+    printf("[Server] Initialization complete. (rule: %s, K=%d N=%d L=%d, kernel: %s/%s)\n",
+           tpm_A->ops->name, shape.K, shape.N, shape.L, tpm_A->kern->name,
+           sync_opts.packed ? "packed" : tpm_A->simd->name);
+    print_weights(tpm_A, "Server Initial");
+
+    printf("\n Synchronization Start (%s)\n", (info.flags & TPM_F_DUPLEX) ? "duplex" : "lockstep");
+    if (tpm_session_run(sess) != TPM_SESS_DONE) {
+        // --max-rounds, --max-repulsive 로 끊었거나 연결이 끊겼다
+        const tpm_sync_result *result = tpm_session_result(sess);
+        printf("\n Synchronization failed (iter: %d, repulsive: %d, restarts: %d)\n", result->iterations,
+               result->repulsive_steps, result->restarts);
+        tpm_session_free(sess);
+        close(servSock);
+        return 1;
+    } else {
+        const tpm_sync_result *result = tpm_session_result(sess);
+        printf("\n Synchronization Achieved! (iter: %d, restarts: %d) \n", result->iterations, result->restarts);
+        show_result_graph(result->iterations, result->repulsive_steps, result->memory_kb);
+        printf("Wire: %.1f B/round out, %.1f B/round in, %.2f syscalls/round\n",
+               (double)conn->bytes_out / result->iterations, (double)conn->bytes_in / result->iterations,
+               (double)conn->syscalls / result->iterations);
+        printf("Sync tags: %lu computed, %lu rows rehashed (of %lu)\n\n",
+               result->tags, result->rows_hashed, result->tags * (unsigned long)shape.K);
+        uint8_t key[TPM_KEY_SIZE];
+        if (tpm_session_key(sess, key) == 0)
+            printf("Session key: %02x%02x%02x%02x%02x%02x%02x%02x...\n\n", key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7]);
+    }
+
+    print_weights(tpm_A, "Server Synced");
+
+    printf("\n Chat Started \n");
+
+    while (1) {
+        printf("Waiting for client's message...\n");
+        nRcv = (int)tpm_conn_read(conn, message, BUFSIZE - 1);
+        if (nRcv <= 0) {
+            printf("Client closed connection.\n");
+            break;
+        }
+        message[nRcv] = '\0';
+
+        if (strcmp(message, "exit") == 0) {
+            printf("Client requested exit.\n");
+            break;
+        }
+        printf("Received: %s\n", message);
+
+        printf("Send (type message, 'exit' to quit): ");
+        if (fgets(message, BUFSIZE, stdin) == NULL) {
+            strncpy(message, "exit", BUFSIZE);
+        }
+        message[strcspn(message, "\n")] = '\0';
+
+        if (send(clntSock, message, (int)strlen(message), 0) < 0) {
+            perror("send");
+            break;
+        }
+
+        if (strcmp(message, "exit") == 0) {
+            printf("Server exit requested.\n");
+            break;
+        }
+    }
+
+    close(clntSock);
+    close(servSock);
+    tpm_session_free(sess);
+    printf("Server finished.\n");
+    return 0;
+}
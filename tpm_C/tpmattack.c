@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tpm.h"
+
+/*
+ * 파라미터마다 도청자가 얼마나 따라오는지 잰다. A-B 동기화 옆에서 기하, 다수결, 유전 공격자
+ * (attack.c, majority.c, genetic.c) 를 돌리고
+ *   - A-B 가 동기화된 라운드에 공격자도 A 와 같았던 비율 (공격 성공)
+ *   - 공격자가 A 와 같아진 라운드 / A-B 라운드 (1 보다 작거나 같으면 성공, 클수록 여유가 크다)
+ * 를 낸다. 같은 --seed 면 A-B 라운드는 tpmsim 과 같다.
+ * --genetic 이면 --attackers 는 개체 수 상한이다 (기본 256).
+ */
+
+#define GENETIC_DEFAULT_CAP 256
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule random|anti|query] [--H n] [--H-max n] [-K n] [-N n] [-L n] [--attackers n] [--chase n] "
+                    "[--soa] [--majority] [--genetic] "
+                    "[--trials n] [--seed n] [--threads n] [--max-rounds n] [--json|--csv]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    tpm_attack_cfg cfg = { { RULE_RANDOM_WALK, { DEFAULT_K, DEFAULT_N, DEFAULT_L }, 0, 0, 0, 0, { 0, 0, 0 } }, 0, 10, 0, 0, 0 };
+    uint64_t trials = 10000, seed = 1;
+    int threads = 0, format = 't';
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "H-max", required_argument, NULL, 'X' },
+        { "attackers", required_argument, NULL, 'a' },
+        { "chase", required_argument, NULL, 'c' },
+        { "soa",  no_argument,       NULL, 'S' },
+        { "majority", no_argument,   NULL, 'M' },
+        { "genetic", no_argument,    NULL, 'G' },
+        { "trials", required_argument, NULL, 'n' },
+        { "seed", required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 't' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "json", no_argument,       NULL, 'j' },
+        { "csv",  no_argument,       NULL, 'C' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:n:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            if (tpm_rule_parse(optarg, &cfg.sim.rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            cfg.sim.H = atoi(optarg);
+            break;
+        case 'X':
+            cfg.sim.H_max = atoi(optarg);
+            break;
+        case 'a':
+            cfg.attackers = atoi(optarg);
+            break;
+        case 'c':
+            cfg.chase = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'S':
+            cfg.soa = 1;
+            break;
+        case 'M':
+            cfg.majority = 1;
+            break;
+        case 'G':
+            cfg.genetic = 1;
+            break;
+        case 'n':
+            trials = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'm':
+            cfg.sim.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            format = 'j';
+            break;
+        case 'C':
+            format = 'c';
+            break;
+        case 'K':
+            cfg.sim.shape.K = atoi(optarg);
+            break;
+        case 'N':
+            cfg.sim.shape.N = atoi(optarg);
+            break;
+        case 'L':
+            cfg.sim.shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc || trials == 0 || cfg.attackers < 0 || cfg.sim.H_max < 0 || cfg.majority + cfg.genetic > 1) usage(argv[0]);
+    if (!tpm_shape_valid(&cfg.sim.shape)) {
+        fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", cfg.sim.shape.K, cfg.sim.shape.N, cfg.sim.shape.L);
+        return 1;
+    }
+    // --H 를 주지 않으면 H 는 구조로 정한다 (--H-max 가 있으면 qctl.c 의 하한, 없으면 tpm_query_H)
+    if (cfg.sim.H <= 0 && cfg.sim.H_max == 0) cfg.sim.H = tpm_query_H(&cfg.sim.shape);
+    // --H-max 가 H 의 하한보다 낮으면 조절할 폭이 없어 고정 H 가 된다
+    tpm_qctl qc;
+    if (cfg.sim.H_max > 0 && tpm_qctl_init(&qc, &cfg.sim.shape, cfg.sim.H, cfg.sim.H_max) < 0) {
+        fprintf(stderr, "--H-max %d is below the lower end of H (%d)\n", cfg.sim.H_max, qc.h_min);
+        return 1;
+    }
+    if (cfg.attackers == 0) cfg.attackers = cfg.genetic ? GENETIC_DEFAULT_CAP : 1;
+    if (cfg.genetic && (cfg.sim.shape.K > 30 || cfg.attackers < 1 << (cfg.sim.shape.K - 1))) {
+        fprintf(stderr, "--genetic needs --attackers >= 2^(K-1)\n");
+        return 1;
+    }
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cfg.chase < 1) cfg.chase = 1;
+
+    tpm_attack_stats st = { 0 };
+    uint64_t t0 = tpm_now_ns();
+    if (tpm_attack_run(&cfg, seed, 0, trials, threads, &st) < 0) ErrorHandling("tpm_attack_run");
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+
+    const tpm_shape *sh = &cfg.sim.shape;
+    const char *rule = tpm_rule_get(cfg.sim.rule)->name;
+    const char *kind = cfg.genetic ? "genetic" : cfg.majority ? "majority" : "geometric";
+    double p_broken = st.synced ? (double)st.broken / (double)st.synced : 0.0;
+    double p_caught = st.synced ? (double)st.caught / (double)st.synced : 0.0;
+
+    if (format == 'j') {
+        printf("{\"rule\":\"%s\",\"K\":%d,\"N\":%d,\"L\":%d,\"H\":%d,\"H_max\":%d,\"attack\":\"%s\",\"attackers\":%d,"
+               "\"chase\":%u,\"trials\":%llu,\"seed\":%llu,\"threads\":%d,\"elapsed_s\":%.3f,\"synced\":%llu,"
+               "\"broken\":%llu,\"caught\":%llu,\"p_broken\":%.6f,\"p_caught\":%.6f,\"rounds\":", rule, sh->K, sh->N,
+               sh->L, cfg.sim.H, cfg.sim.H_max, kind, cfg.attackers, cfg.chase, (unsigned long long)trials, (unsigned long long)seed,
+               threads, sec, (unsigned long long)st.synced, (unsigned long long)st.broken, (unsigned long long)st.caught, p_broken,
+               p_caught);
+        tpm_stats_json(stdout, &st.rounds);
+        printf(",\"attack_rounds\":");
+        tpm_stats_json(stdout, &st.attack);
+        printf(",\"ratio_permille\":");
+        tpm_stats_json(stdout, &st.ratio);
+        printf("}\n");
+    } else if (format == 'c') {
+        printf("rule,K,N,L,H,H_max,attack,attackers,chase,trials,seed,synced,broken,caught,p_broken,p_caught,");
+        tpm_stats_csv_header(stdout, "rounds");
+        printf(",");
+        tpm_stats_csv_header(stdout, "attack");
+        printf(",");
+        tpm_stats_csv_header(stdout, "ratio_permille");
+        printf("\n%s,%d,%d,%d,%d,%d,%s,%d,%u,%llu,%llu,%llu,%llu,%llu,%.6f,%.6f,", rule, sh->K, sh->N, sh->L,
+               cfg.sim.H, cfg.sim.H_max, kind, cfg.attackers, cfg.chase, (unsigned long long)trials, (unsigned long long)seed,
+               (unsigned long long)st.synced, (unsigned long long)st.broken, (unsigned long long)st.caught, p_broken,
+               p_caught);
+        tpm_stats_csv_row(stdout, &st.rounds);
+        printf(",");
+        tpm_stats_csv_row(stdout, &st.attack);
+        printf(",");
+        tpm_stats_csv_row(stdout, &st.ratio);
+        printf("\n");
+    } else {
+        const tpm_stats *r = &st.rounds, *q = &st.ratio;
+        printf("[tpmattack] rule %s, K=%d N=%d L=%d, %d %s attacker(s), %llu trials, seed %llu, %d thread(s)\n",
+               rule, sh->K, sh->N, sh->L, cfg.attackers, kind, (unsigned long long)trials, (unsigned long long)seed,
+               threads);
+        if (cfg.sim.rule == RULE_QUERY && cfg.sim.H_max > 0) printf("  adaptive H %d..%d\n", qc.h_min, qc.h_max);
+        printf("  %.2f s (%.0f trials/s), A-B synced %llu\n", sec, trials / sec, (unsigned long long)st.synced);
+        printf("  A-B rounds       mean %.1f  p50 %llu  p90 %llu  p99 %llu\n", tpm_stats_mean(r),
+               (unsigned long long)tpm_stats_quantile(r, 0.50), (unsigned long long)tpm_stats_quantile(r, 0.90),
+               (unsigned long long)tpm_stats_quantile(r, 0.99));
+        printf("  attacker equal to A when A-B synced: %llu (%.2f%%)\n", (unsigned long long)st.broken, 100 * p_broken);
+        printf("  caught up within %ux A-B rounds: %llu (%.2f%%)\n", cfg.chase, (unsigned long long)st.caught,
+               100 * p_caught);
+        if (st.caught > 0)
+            printf("  attacker/A-B rounds  mean %.2f  p10 %.2f  p50 %.2f  p90 %.2f\n", tpm_stats_mean(q) / 1000,
+                   tpm_stats_quantile(q, 0.10) / 1000.0, tpm_stats_quantile(q, 0.50) / 1000.0,
+                   tpm_stats_quantile(q, 0.90) / 1000.0);
+    }
+
+    tpm_attack_stats_free(&st);
+    return 0;
+}
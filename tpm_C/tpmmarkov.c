@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tpm.h"
+
+/*
+ * 작은 구조의 동기화 라운드 분포를 마르코프 연쇄로 정확히 구하고 (markov.c),
+ * 같은 구조의 몬테카를로 (tpm_sim_run_stats) 와 비교한다.
+ *   동기화 비율과 평균: 정확한 값과의 차를 표준 오차로 나눈 z (|z| < 3.3 이면 0.1% 수준에서 같다)
+ *   분포: 히스토그램 칸 끝마다 누적 분포 차의 최대 (KS D). 1% 유의 수준의 임계값은 1.63 / sqrt(n).
+ * 둘 다 동기화된 시행만 본다 (tpmsim 의 rounds 와 같다).
+ */
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule random|anti|query] [--H n] [-K n] [-N n] [-L n] [--threads n] "
+                    "[--max-states n] [--max-rounds n] [--eps x] [--check trials] [--seed n] [--dist]\n", prog);
+    exit(1);
+}
+
+/* 몬테카를로 분포와 정확한 누적 분포 cdf (동기화 조건부) 의 차이가 가장 큰 칸 끝 */
+static double ks_distance(const tpm_stats *s, const double *cdf, uint32_t rounds) {
+    uint64_t seen = 0;
+    double d = 0;
+    for (uint32_t i = 0; i < s->nbins; i++) {
+        uint64_t lo, width;
+        seen += tpm_stats_bin(s, i, &lo, &width);
+        if (lo + width - 1 < 1) continue;
+        uint64_t hi = lo + width - 1;
+        double exact = hi >= rounds ? 1.0 : cdf[hi];
+        double diff = fabs((double)seen / (double)s->n - exact);
+        if (diff > d) d = diff;
+        if (seen == s->n) break;
+    }
+    return d;
+}
+
+int main(int argc, char **argv) {
+    tpm_markov_cfg cfg = { RULE_RANDOM_WALK, { 3, 2, 2 }, 0, 0, 0, 0, 1e-12 };
+    uint64_t check = 200000, seed = 1;
+    int dist = 0;
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "threads", required_argument, NULL, 't' },
+        { "max-states", required_argument, NULL, 'S' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "eps",  required_argument, NULL, 'e' },
+        { "check", required_argument, NULL, 'c' },
+        { "seed", required_argument, NULL, 's' },
+        { "dist", no_argument,       NULL, 'd' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            if (tpm_rule_parse(optarg, &cfg.rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            cfg.H = atoi(optarg);
+            break;
+        case 't':
+            cfg.threads = atoi(optarg);
+            break;
+        case 'S':
+            cfg.max_states = strtoull(optarg, NULL, 10);
+            break;
+        case 'm':
+            cfg.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            cfg.eps = strtod(optarg, NULL);
+            break;
+        case 'c':
+            check = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'd':
+            dist = 1;
+            break;
+        case 'K':
+            cfg.shape.K = atoi(optarg);
+            break;
+        case 'N':
+            cfg.shape.N = atoi(optarg);
+            break;
+        case 'L':
+            cfg.shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc) usage(argv[0]);
+    if (!tpm_shape_valid(&cfg.shape)) {
+        fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", cfg.shape.K, cfg.shape.N, cfg.shape.L);
+        return 1;
+    }
+    if (cfg.H <= 0) cfg.H = tpm_query_H(&cfg.shape);
+    if (cfg.threads <= 0) cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const uint32_t max_rounds = cfg.max_rounds ? cfg.max_rounds : TPM_SIM_MAX_ROUNDS;
+
+    printf("[tpmmarkov] rule %s, K=%d N=%d L=%d", tpm_rule_get(cfg.rule)->name, cfg.shape.K, cfg.shape.N, cfg.shape.L);
+    if (cfg.rule == RULE_QUERY) printf(" H=%d", cfg.H);
+    printf(", %d thread(s), state space <= %.3g\n", cfg.threads, tpm_markov_space(&cfg));
+    fflush(stdout);
+
+    tpm_markov_result res;
+    uint64_t t0 = tpm_now_ns();
+    if (tpm_markov_solve(&cfg, &res) < 0) {
+        if (errno == E2BIG)
+            fprintf(stderr, "state space too large: gave up at %zu states (--max-states %zu)\n", res.states,
+                    cfg.max_states ? cfg.max_states : (size_t)TPM_MARKOV_MAX_STATES);
+        else
+            perror("tpm_markov_solve");
+        return 1;
+    }
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+
+    double *cdf = malloc(((size_t)res.rounds + 1) * sizeof(*cdf)), synced = 1.0 - res.tail;
+    if (cdf == NULL) ErrorHandling("malloc");
+    cdf[0] = 0;
+    for (uint32_t r = 1; r <= res.rounds; r++) cdf[r] = cdf[r - 1] + res.p[r] / synced;
+
+    printf("  unit states %u, joint states %zu, transitions %zu, %.2f s\n", res.unit_states, res.states, res.nnz, sec);
+    printf("  exact   P(never) %.4g, P(no sync in %u rounds) %.4g, mean %.2f  sd %.2f  p50 %u  p90 %u  p99 %u  "
+           "p999 %u\n", res.never, res.rounds, res.tail, tpm_markov_mean(&res), tpm_markov_sd(&res), tpm_markov_quantile(&res, 0.50),
+           tpm_markov_quantile(&res, 0.90), tpm_markov_quantile(&res, 0.99), tpm_markov_quantile(&res, 0.999));
+
+    if (check > 0) {
+        // 정확한 분포가 끝난 라운드까지만 돌려야 같은 조건부가 된다
+        tpm_sim_cfg sim = { cfg.rule, cfg.shape, cfg.H, res.tail > 0 ? res.rounds : max_rounds, 0, 0,
+                            { 0, 0, 0 } };
+        tpm_sim_stats st = { 0 };
+        if (tpm_sim_run_stats(&sim, seed, 0, check, cfg.threads, &st) < 0) ErrorHandling("tpm_sim_run_stats");
+        const tpm_stats *r = &st.rounds;
+        double z = (tpm_stats_mean(r) - tpm_markov_mean(&res)) / (tpm_markov_sd(&res) / sqrt((double)r->n));
+        double zs = ((double)st.synced / (double)check - synced) / sqrt(synced * res.tail / (double)check + 1e-300);
+        double ks = ks_distance(r, cdf, res.rounds), crit = 1.63 / sqrt((double)r->n);
+        printf("  monte-carlo %llu trials (seed %llu): synced %llu, mean %.2f  sd %.2f  p50 %llu  p90 %llu  p99 %llu  "
+               "p999 %llu\n", (unsigned long long)check, (unsigned long long)seed, (unsigned long long)st.synced,
+               tpm_stats_mean(r), tpm_stats_sd(r), (unsigned long long)tpm_stats_quantile(r, 0.50),
+               (unsigned long long)tpm_stats_quantile(r, 0.90), (unsigned long long)tpm_stats_quantile(r, 0.99),
+               (unsigned long long)tpm_stats_quantile(r, 0.999));
+        printf("  synced z %.2f, mean z %.2f, KS D %.4f (1%% critical %.4f): %s\n", zs, z, ks, crit,
+               fabs(zs) < 3.3 && fabs(z) < 3.3 && ks < crit ? "agree" : "DISAGREE");
+        tpm_sim_stats_free(&st);
+    }
+
+    // --dist: round,p,cdf (동기화 조건부 누적)
+    if (dist) {
+        printf("round,p,cdf\n");
+        for (uint32_t r = 1; r <= res.rounds; r++)
+            if (res.p[r] > 0) printf("%u,%.6e,%.9f\n", r, res.p[r], cdf[r]);
+    }
+
+    free(cdf);
+    tpm_markov_free(&res);
+    return 0;
+}
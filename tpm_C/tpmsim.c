@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "tpm.h"
+
+/*
+ * 소켓 없이 두 TPM 을 메모리에서 동기화시키는 시행을 여러 코어로 돌리고 라운드 분포를 낸다.
+ * 같은 --seed 면 스레드 수와 상관없이 같은 결과가 나온다 (시행 i 는 seed 와 i 로만 정해진다).
+ * 결과는 스레드별 스트리밍 통계로 모으므로 시행 수가 많아도 메모리는 늘지 않는다.
+ */
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule random|anti|query] [--H n] [--H-max n] [-K n] [-N n] [-L n] "
+                    "[--trials n] [--seed n] [--threads n] [--max-rounds n] [--max-repulsive n] "
+                    "[--restart n] [--luby] [--bitslice] [--hist n] [--json|--csv]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    tpm_sim_cfg cfg = { RULE_RANDOM_WALK, { DEFAULT_K, DEFAULT_N, DEFAULT_L }, 0, 0, 0, 0, { 0, 0, 0 } };
+    uint64_t trials = 100000, seed = 1;
+    int threads = 0, format = 't', hist = 0;
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "H-max", required_argument, NULL, 'X' },
+        { "trials", required_argument, NULL, 'n' },
+        { "seed", required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 't' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "max-repulsive", required_argument, NULL, 'E' },
+        { "restart", required_argument, NULL, 'T' },
+        { "luby", no_argument,       NULL, 'Y' },
+        { "hist", required_argument, NULL, 'b' },
+        { "json", no_argument,       NULL, 'j' },
+        { "csv",  no_argument,       NULL, 'C' },
+        { "bitslice", no_argument,   NULL, 'B' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:n:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r':
+            if (tpm_rule_parse(optarg, &cfg.rule) < 0) usage(argv[0]);
+            break;
+        case 'H':
+            cfg.H = atoi(optarg);
+            break;
+        case 'X':
+            cfg.H_max = atoi(optarg);
+            break;
+        case 'n':
+            trials = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'm':
+            cfg.max_rounds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'E':
+            cfg.policy.max_repulsive = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            cfg.policy.restart = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'Y':
+            cfg.policy.luby = 1;
+            break;
+        case 'b':
+            hist = atoi(optarg);
+            break;
+        case 'j':
+            format = 'j';
+            break;
+        case 'C':
+            format = 'c';
+            break;
+        case 'B':
+            cfg.bitslice = 1;
+            break;
+        case 'K':
+            cfg.shape.K = atoi(optarg);
+            break;
+        case 'N':
+            cfg.shape.N = atoi(optarg);
+            break;
+        case 'L':
+            cfg.shape.L = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc || trials == 0 || cfg.H_max < 0 || (cfg.bitslice && (cfg.H_max > 0 || cfg.policy.max_repulsive > 0 || cfg.policy.restart > 0)))
+        usage(argv[0]);
+    if (!tpm_shape_valid(&cfg.shape)) {
+        fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", cfg.shape.K, cfg.shape.N, cfg.shape.L);
+        return 1;
+    }
+    // --H 를 주지 않으면 H 는 구조로 정한다 (--H-max 가 있으면 qctl.c 의 하한, 없으면 tpm_query_H)
+    if (cfg.H <= 0 && cfg.H_max == 0) cfg.H = tpm_query_H(&cfg.shape);
+    // --H-max 가 H 의 하한보다 낮으면 조절할 폭이 없어 고정 H 가 된다
+    tpm_qctl qc;
+    if (cfg.H_max > 0 && tpm_qctl_init(&qc, &cfg.shape, cfg.H, cfg.H_max) < 0) {
+        fprintf(stderr, "--H-max %d is below the lower end of H (%d)\n", cfg.H_max, qc.h_min);
+        return 1;
+    }
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    tpm_sim_stats st = { 0 };
+    uint64_t t0 = tpm_now_ns();
+    if (tpm_sim_run_stats(&cfg, seed, 0, trials, threads, &st) < 0) ErrorHandling("tpm_sim_run_stats");
+    double sec = (double)(tpm_now_ns() - t0) * 1e-9;
+
+    // 동기화된 시행의 라운드 분포 (stats.c, 표본을 저장하지 않는다)
+    const tpm_stats *r = &st.rounds;
+    uint64_t ok = st.synced, failed = trials - ok;
+
+    if (format == 'j') {
+        printf("{\"rule\":\"%s\",\"K\":%d,\"N\":%d,\"L\":%d,\"H\":%d,\"H_max\":%d,\"trials\":%llu,\"seed\":%llu,\"threads\":%d,"
+               "\"elapsed_s\":%.3f,\"trials_per_s\":%.1f,\"synced\":%llu,\"failed\":%llu,\"rounds\":",
+               tpm_rule_get(cfg.rule)->name, cfg.shape.K, cfg.shape.N, cfg.shape.L, cfg.H,
+               cfg.H_max, (unsigned long long)trials, (unsigned long long)seed, threads, sec, trials / sec,
+               (unsigned long long)ok, (unsigned long long)failed);
+        tpm_stats_json(stdout, r);
+        printf(",\"repulsive\":");
+        tpm_stats_json(stdout, &st.repulsive);
+        printf("}\n");
+    } else if (format == 'c') {
+        printf("rule,K,N,L,H,H_max,trials,seed,synced,failed,");
+        tpm_stats_csv_header(stdout, "rounds");
+        printf(",");
+        tpm_stats_csv_header(stdout, "repulsive");
+        printf("\n%s,%d,%d,%d,%d,%d,%llu,%llu,%llu,%llu,", tpm_rule_get(cfg.rule)->name, cfg.shape.K,
+               cfg.shape.N, cfg.shape.L, cfg.H, cfg.H_max, (unsigned long long)trials, (unsigned long long)seed,
+               (unsigned long long)ok, (unsigned long long)failed);
+        tpm_stats_csv_row(stdout, r);
+        printf(",");
+        tpm_stats_csv_row(stdout, &st.repulsive);
+        printf("\n");
+    } else {
+        printf("[tpmsim] rule %s, K=%d N=%d L=%d, %llu trials, seed %llu, %d thread(s)\n",
+               tpm_rule_get(cfg.rule)->name, cfg.shape.K, cfg.shape.N, cfg.shape.L,
+               (unsigned long long)trials, (unsigned long long)seed, threads);
+        if (cfg.rule == RULE_QUERY && cfg.H_max > 0) printf("  adaptive H %d..%d\n", qc.h_min, qc.h_max);
+        printf("  %.2f s (%.0f trials/s), synced %llu, failed %llu (max-rounds %u)\n", sec, trials / sec,
+               (unsigned long long)ok, (unsigned long long)failed, cfg.max_rounds ? cfg.max_rounds : TPM_SIM_MAX_ROUNDS);
+        printf("  rounds  mean %.1f  sd %.1f  p50 %llu  p90 %llu  p99 %llu  p999 %llu  max %llu\n", tpm_stats_mean(r),
+               tpm_stats_sd(r), (unsigned long long)tpm_stats_quantile(r, 0.50),
+               (unsigned long long)tpm_stats_quantile(r, 0.90), (unsigned long long)tpm_stats_quantile(r, 0.99),
+               (unsigned long long)tpm_stats_quantile(r, 0.999), (unsigned long long)r->max);
+        printf("  repulsive steps per trial  mean %.1f\n", tpm_stats_mean(&st.repulsive));
+    }
+
+    // --hist n: 라운드를 n 칸으로 나눈 막대 (히스토그램 칸 경계에 맞춰 센다)
+    if (hist > 0 && ok > 0 && format == 't') {
+        uint64_t width = (r->max + (uint64_t)hist - 1) / (uint64_t)hist, peak = 0;
+        uint64_t *bins = calloc((size_t)hist, sizeof(*bins));
+        if (bins == NULL) ErrorHandling("calloc");
+        if (width == 0) width = 1;
+        for (int b = 0; b < hist; b++) {
+            bins[b] = tpm_stats_count_ge(r, b * width + 1) - (b + 1 < hist ? tpm_stats_count_ge(r, (b + 1) * width + 1) : 0);
+            if (bins[b] > peak) peak = bins[b];
+        }
+        for (int b = 0; b < hist; b++) {
+            char label[32];
+            snprintf(label, sizeof(label), "%llu-%llu", (unsigned long long)(b * width + 1),
+                     (unsigned long long)((b + 1) * width));
+            print_bar_graph(label, (long)bins[b], (long)peak);
+        }
+        free(bins);
+    }
+
+    tpm_sim_stats_free(&st);
+    return 0;
+}
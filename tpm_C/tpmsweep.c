@@ -0,0 +1,342 @@
+#include <signal.h>
+#include <getopt.h>
+#include <sys/wait.h>
+#include "tpm.h"
+
+/*
+ * K/N/L/H/rule 격자를 훑으며 셀마다 동기화 라운드와 반발 라운드를 낸다 (sweep.c 의 스케줄러).
+ * --checkpoint 파일에 끝난 작업 단위를 적어 두므로 끊긴 스윕은 같은 명령으로 이어서 돌린다.
+ * --workers n 이면 단위를 작업 프로세스 n 개에 나눠 준다. 프로세스가 죽으면 그 단위는 다른 워커가 돈다.
+ * H 는 query 규칙에서만 쓰므로 다른 규칙의 셀은 H 를 0 으로 하나만 만든다. --H 가 없으면 셀마다 tpm_query_H.
+ */
+
+#define MAX_LIST 64
+#define REPORT_NS 10000000000ULL    // 진행 보고 간격
+
+typedef struct {
+    int v[MAX_LIST];
+    int n;
+} int_list;
+
+typedef struct {
+    tpm_sweep_unit *units;
+    uint8_t *done;
+    tpm_sim_stats *cell_st;     // 셀별 분포 (단위 i 는 셀 i / per_cell)
+    uint64_t per_cell;
+    size_t n_units, n_done;
+    int ckpt_fd;
+    int *child_fd;              // 워커 w < n_child 는 작업 프로세스 w 에 맡긴다
+    int n_child;
+    uint64_t t0, last_report;
+} sweep_state;
+
+static volatile sig_atomic_t interrupted;
+
+static void on_sigint(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--rule r1,r2,..] [-K list] [-N list] [-L list] [--H list] [--trials n] [--unit n] "
+                    "[--seed n] [--max-rounds n] [--threads n] [--workers n] [--checkpoint file] [--bitslice] "
+                    "[--json|--csv]\n  list: comma-separated, e.g. -N 4,8,16\n", prog);
+    exit(1);
+}
+
+static void parse_list(const char *s, int_list *l, const char *prog) {
+    char buf[256], *save = NULL;
+    snprintf(buf, sizeof(buf), "%s", s);
+    l->n = 0;
+    for (char *t = strtok_r(buf, ",", &save); t != NULL; t = strtok_r(NULL, ",", &save)) {
+        if (l->n == MAX_LIST) usage(prog);
+        l->v[l->n++] = atoi(t);
+    }
+    if (l->n == 0) usage(prog);
+}
+
+static void parse_rules(const char *s, int_list *l, const char *prog) {
+    char buf[256], *save = NULL;
+    snprintf(buf, sizeof(buf), "%s", s);
+    l->n = 0;
+    for (char *t = strtok_r(buf, ",", &save); t != NULL; t = strtok_r(NULL, ",", &save)) {
+        tpm_rule r;
+        if (l->n == MAX_LIST || tpm_rule_parse(t, &r) < 0) usage(prog);
+        l->v[l->n++] = (int)r;
+    }
+    if (l->n == 0) usage(prog);
+}
+
+/* ---- 작업 프로세스 ---- */
+
+/* 부모가 보낸 단위를 돌려 상태와 누적값을 돌려준다. 부모가 소켓을 닫으면 끝난다. */
+static void child_main(int fd) {
+    tpm_sweep_unit u;
+    signal(SIGINT, SIG_IGN);    // 중단은 부모가 새 단위를 주지 않는 것으로 한다
+    while (recv_all(fd, &u, sizeof(u)) == 1) {
+        tpm_sim_stats st = { 0 };
+        char *text = NULL;
+        size_t len = 0;
+        int32_t status = tpm_sweep_exec(&u, &st);
+        FILE *f = open_memstream(&text, &len);
+        if (f == NULL) break;
+        tpm_sim_stats_write(f, &st);
+        fclose(f);
+        tpm_sim_stats_free(&st);
+        uint32_t n = (uint32_t)len;
+        int ok = send_all(fd, &status, sizeof(status)) == 1 && send_all(fd, &n, sizeof(n)) == 1 &&
+                 send_all(fd, text, len) == 1;
+        free(text);
+        if (!ok) break;
+    }
+    _exit(0);
+}
+
+/* 작업 프로세스가 돌려준 분포 텍스트 (tpm_sim_stats_write) 를 받는다 */
+static int recv_stats(int fd, int32_t *status, tpm_sim_stats *out) {
+    uint32_t len;
+    if (recv_all(fd, status, sizeof(*status)) != 1 || recv_all(fd, &len, sizeof(len)) != 1) return -1;
+    char *text = malloc((size_t)len + 1);
+    if (text == NULL) return -1;
+    int ok = recv_all(fd, text, len) == 1;
+    text[len] = '\0';
+    ok = ok && tpm_sim_stats_read(text, out) != NULL;
+    free(text);
+    return ok ? 0 : -1;
+}
+
+static int exec_unit(void *ctx, int worker, const tpm_sweep_unit *u, tpm_sim_stats *out) {
+    sweep_state *st = ctx;
+    if (worker >= st->n_child) return tpm_sweep_exec(u, out);
+
+    int fd = st->child_fd[worker];
+    int32_t status;
+    if (send_all(fd, u, sizeof(*u)) != 1 || recv_stats(fd, &status, out) < 0) {
+        fprintf(stderr, "[tpmsweep] worker process %d is gone, its units go to the others\n", worker);
+        return -1;
+    }
+    return status;
+}
+
+/* 체크포인트에서 읽었거나 방금 끝난 단위를 셀 분포에 더한다 */
+static int merge_unit(void *ctx, size_t i, const tpm_sim_stats *us) {
+    sweep_state *st = ctx;
+    return tpm_sim_stats_merge(&st->cell_st[i / st->per_cell], us) < 0;
+}
+
+static int unit_done(void *ctx, size_t i, const tpm_sim_stats *us) {
+    sweep_state *st = ctx;
+    if (merge_unit(ctx, i, us) != 0) return 1;
+    st->done[i] = 1;
+    st->n_done++;
+    if (st->ckpt_fd >= 0 && tpm_sweep_ckpt_append(st->ckpt_fd, &st->units[i], us) < 0) {
+        perror("checkpoint");
+        return 1;
+    }
+    uint64_t now = tpm_now_ns();
+    if (now - st->last_report >= REPORT_NS) {
+        st->last_report = now;
+        fprintf(stderr, "[tpmsweep] %zu/%zu units, %.0f s\n", st->n_done, st->n_units, (now - st->t0) * 1e-9);
+    }
+    return interrupted;
+}
+
+static void print_cell(const tpm_sim_cfg *s, const tpm_sim_stats *a, int format) {
+    const tpm_stats *r = &a->rounds;
+
+    if (format == 'j') {
+        printf("{\"rule\":\"%s\",\"K\":%d,\"N\":%d,\"L\":%d,\"H\":%d,\"trials\":%llu,\"synced\":%llu,"
+               "\"failed\":%llu,\"rounds\":", tpm_rule_get(s->rule)->name, s->shape.K, s->shape.N, s->shape.L, s->H,
+               (unsigned long long)a->trials, (unsigned long long)a->synced,
+               (unsigned long long)(a->trials - a->synced));
+        tpm_stats_json(stdout, r);
+        printf(",\"repulsive\":");
+        tpm_stats_json(stdout, &a->repulsive);
+        printf("}\n");
+        return;
+    }
+    if (format == 'c') {
+        printf("%s,%d,%d,%d,%d,%llu,%llu,%llu,", tpm_rule_get(s->rule)->name, s->shape.K, s->shape.N, s->shape.L,
+               s->H, (unsigned long long)a->trials, (unsigned long long)a->synced,
+               (unsigned long long)(a->trials - a->synced));
+        tpm_stats_csv_row(stdout, r);
+        printf(",");
+        tpm_stats_csv_row(stdout, &a->repulsive);
+        printf("\n");
+        return;
+    }
+    char h[16] = "-";
+    if (s->rule == RULE_QUERY) snprintf(h, sizeof(h), "%d", s->H);
+    printf("  %-6s %3d %5d %3d %3s %9llu %7llu %9.1f %8.1f %6llu %6llu %6llu %7llu %9.1f\n",
+           tpm_rule_get(s->rule)->name, s->shape.K, s->shape.N, s->shape.L, h, (unsigned long long)a->trials,
+           (unsigned long long)(a->trials - a->synced), tpm_stats_mean(r), tpm_stats_sd(r),
+           (unsigned long long)tpm_stats_quantile(r, 0.50), (unsigned long long)tpm_stats_quantile(r, 0.90),
+           (unsigned long long)tpm_stats_quantile(r, 0.99), (unsigned long long)r->max,
+           tpm_stats_mean(&a->repulsive));
+}
+
+int main(int argc, char **argv) {
+    int_list rules = { { RULE_RANDOM_WALK }, 1 }, Ks = { { DEFAULT_K }, 1 }, Ns = { { DEFAULT_N }, 1 };
+    int_list Ls = { { DEFAULT_L }, 1 }, Hs = { { 0 }, 1 };
+    uint64_t trials = 10000, unit = 1000, seed = 1;
+    uint32_t max_rounds = 0;
+    int threads = -1, nproc = 0, bitslice = 0, format = 't';
+    const char *ckpt = NULL;
+
+    static const struct option long_opts[] = {
+        { "rule", required_argument, NULL, 'r' },
+        { "H",    required_argument, NULL, 'H' },
+        { "trials", required_argument, NULL, 'n' },
+        { "unit", required_argument, NULL, 'u' },
+        { "seed", required_argument, NULL, 's' },
+        { "max-rounds", required_argument, NULL, 'm' },
+        { "threads", required_argument, NULL, 't' },
+        { "workers", required_argument, NULL, 'w' },
+        { "checkpoint", required_argument, NULL, 'c' },
+        { "bitslice", no_argument,   NULL, 'B' },
+        { "json", no_argument,       NULL, 'j' },
+        { "csv",  no_argument,       NULL, 'C' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:H:K:N:L:n:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'r': parse_rules(optarg, &rules, argv[0]); break;
+        case 'H': parse_list(optarg, &Hs, argv[0]); break;
+        case 'K': parse_list(optarg, &Ks, argv[0]); break;
+        case 'N': parse_list(optarg, &Ns, argv[0]); break;
+        case 'L': parse_list(optarg, &Ls, argv[0]); break;
+        case 'n': trials = strtoull(optarg, NULL, 10); break;
+        case 'u': unit = strtoull(optarg, NULL, 10); break;
+        case 's': seed = strtoull(optarg, NULL, 0); break;
+        case 'm': max_rounds = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 't': threads = atoi(optarg); break;
+        case 'w': nproc = atoi(optarg); break;
+        case 'c': ckpt = optarg; break;
+        case 'B': bitslice = 1; break;
+        case 'j': format = 'j'; break;
+        case 'C': format = 'c'; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || trials == 0 || unit == 0 || nproc < 0) usage(argv[0]);
+    if (threads < 0) threads = nproc > 0 ? 0 : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads + nproc < 1) threads = 1;
+
+    // 격자 → 셀 → 작업 단위
+    size_t max_cells = (size_t)rules.n * Ks.n * Ns.n * Ls.n * Hs.n, n_cells = 0;
+    tpm_sim_cfg *cells = calloc(max_cells, sizeof(*cells));
+    if (cells == NULL) ErrorHandling("calloc");
+    for (int r = 0; r < rules.n; r++)
+        for (int k = 0; k < Ks.n; k++)
+            for (int n = 0; n < Ns.n; n++)
+                for (int l = 0; l < Ls.n; l++)
+                    for (int h = 0; h < (rules.v[r] == RULE_QUERY ? Hs.n : 1); h++) {
+                        tpm_sim_cfg sim = { (tpm_rule)rules.v[r], { Ks.v[k], Ns.v[n], Ls.v[l] },
+                                            rules.v[r] == RULE_QUERY ? Hs.v[h] : 0, max_rounds, bitslice, 0,
+                                            { 0, 0, 0 } };
+                        if (!tpm_shape_valid(&sim.shape)) {
+                            fprintf(stderr, "Invalid shape K=%d N=%d L=%d\n", sim.shape.K, sim.shape.N, sim.shape.L);
+                            return 1;
+                        }
+                        if (sim.rule == RULE_QUERY && sim.H <= 0) sim.H = tpm_query_H(&sim.shape);
+                        cells[n_cells++] = sim;
+                    }
+
+    uint64_t per_cell = (trials + unit - 1) / unit;
+    sweep_state st = { .n_units = n_cells * per_cell, .per_cell = per_cell, .ckpt_fd = -1 };
+    st.units = calloc(st.n_units, sizeof(*st.units));
+    st.cell_st = calloc(n_cells, sizeof(*st.cell_st));
+    st.done = calloc(st.n_units, 1);
+    size_t *todo = calloc(st.n_units, sizeof(*todo));
+    if (st.units == NULL || st.cell_st == NULL || st.done == NULL || todo == NULL) ErrorHandling("calloc");
+    for (size_t c = 0, i = 0; c < n_cells; c++) {
+        uint64_t cs = tpm_sweep_cell_seed(seed, &cells[c]);
+        for (uint64_t b = 0; b < per_cell; b++, i++) {
+            tpm_sweep_unit *u = &st.units[i];
+            u->sim = cells[c];
+            u->seed = cs;
+            u->block = b;
+            u->first = b * unit;
+            u->n = u->first + unit <= trials ? unit : trials - u->first;
+        }
+    }
+
+    if (ckpt != NULL) {
+        char header[128];
+        snprintf(header, sizeof(header), "seed %llu unit %llu max-rounds %u", (unsigned long long)seed,
+                 (unsigned long long)unit, max_rounds ? max_rounds : TPM_SIM_MAX_ROUNDS);
+        st.ckpt_fd = tpm_sweep_ckpt_open(ckpt, header, st.units, st.n_units, st.done, merge_unit, &st);
+        if (st.ckpt_fd < 0) ErrorHandling(ckpt);
+    }
+    size_t n_todo = 0;
+    for (size_t i = 0; i < st.n_units; i++) {
+        if (st.done[i]) st.n_done++;
+        else todo[n_todo++] = i;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    st.n_child = nproc;
+    st.child_fd = calloc((size_t)(nproc > 0 ? nproc : 1), sizeof(int));
+    pid_t *pids = calloc((size_t)(nproc > 0 ? nproc : 1), sizeof(pid_t));
+    if (st.child_fd == NULL || pids == NULL) ErrorHandling("calloc");
+    for (int i = 0; i < nproc; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) ErrorHandling("socketpair");
+        fflush(stdout);
+        pids[i] = fork();
+        if (pids[i] < 0) ErrorHandling("fork");
+        if (pids[i] == 0) {
+            close(sv[0]);
+            for (int j = 0; j < i; j++) close(st.child_fd[j]);
+            if (st.ckpt_fd >= 0) close(st.ckpt_fd);
+            child_main(sv[1]);
+        }
+        close(sv[1]);
+        st.child_fd[i] = sv[0];
+    }
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = on_sigint;
+    sa.sa_flags = SA_RESETHAND;     // 두 번째 Ctrl-C 는 바로 끝낸다
+    sigaction(SIGINT, &sa, NULL);
+
+    fprintf(stderr, "[tpmsweep] %zu cells, %zu units (%zu done, %zu to run), %d thread(s), %d process(es)\n",
+            n_cells, st.n_units, st.n_done, n_todo, threads, nproc);
+    tpm_sweep_sched sched = { threads + nproc, exec_unit, unit_done, &st };
+    unsigned long steals = 0;
+    st.t0 = st.last_report = tpm_now_ns();
+    long left = tpm_sweep_run(st.units, todo, n_todo, &sched, &steals);
+    double sec = (tpm_now_ns() - st.t0) * 1e-9;
+
+    for (int i = 0; i < nproc; i++) close(st.child_fd[i]);
+    for (int i = 0; i < nproc; i++) waitpid(pids[i], NULL, 0);
+    if (left < 0) ErrorHandling("tpm_sweep_run");
+    fprintf(stderr, "[tpmsweep] ran %zu units in %.1f s, steals %lu\n", n_todo - (size_t)left, sec, steals);
+
+    if (format == 't') {
+        printf("  %-6s %3s %5s %3s %3s %9s %7s %9s %8s %6s %6s %6s %7s %9s\n", "rule", "K", "N", "L", "H", "trials",
+               "failed", "mean", "sd", "p50", "p90", "p99", "max", "repulsive");
+    } else if (format == 'c') {
+        printf("rule,K,N,L,H,trials,synced,failed,");
+        tpm_stats_csv_header(stdout, "rounds");
+        printf(",");
+        tpm_stats_csv_header(stdout, "repulsive");
+        printf("\n");
+    }
+    for (size_t c = 0; c < n_cells; c++) print_cell(&cells[c], &st.cell_st[c], format);
+    if (left > 0)
+        fprintf(stderr, "[tpmsweep] incomplete: %ld units left%s\n", left,
+                ckpt != NULL ? ", run the same command again to resume" : "");
+
+    if (st.ckpt_fd >= 0) close(st.ckpt_fd);
+    free(st.child_fd);
+    free(pids);
+    free(todo);
+    free(st.units);
+    for (size_t c = 0; c < n_cells; c++) tpm_sim_stats_free(&st.cell_st[c]);
+    free(st.cell_st);
+    free(st.done);
+    free(cells);
+    return left > 0;
+}